@@ -57,6 +57,7 @@ in this Software without prior written authorization from The Open Group.
 #include <sys/mman.h>
 #include "protocol-versions.h"
 #include "busfault.h"
+#include "damage.h"
 
 /* Needed for Solaris cross-zone shared memory extension */
 #ifdef HAVE_SHMCTL64
@@ -484,6 +485,16 @@ doShmPutImage(DrawablePtr dst, GCPtr pGC,
                            dy);
         FreeScratchPixmapHeader(pPixmap);
     }
+    else if (format == XYBitmap) {
+        pPixmap = GetScratchPixmapHeader(dst->pScreen, w, h, 1,
+                                         BitsPerPixel(1),
+                                         PixmapBytePad(w, 1), data);
+        if (!pPixmap)
+            return;
+        (void) (*pGC->ops->CopyPlane) ((DrawablePtr) pPixmap, dst, pGC,
+                                       sx, sy, sw, sh, dx, dy, 1L);
+        FreeScratchPixmapHeader(pPixmap);
+    }
     else {
         GCPtr putGC = GetScratchGC(depth, dst->pScreen);
 
@@ -498,20 +509,62 @@ doShmPutImage(DrawablePtr dst, GCPtr pGC,
         }
         ValidateGC(&pPixmap->drawable, putGC);
         (*putGC->ops->PutImage) (&pPixmap->drawable, putGC, depth, -sx, -sy, w,
-                                 h, 0,
-                                 (format == XYPixmap) ? XYPixmap : ZPixmap,
-                                 data);
+                                 h, 0, XYPixmap, data);
         FreeScratchGC(putGC);
-        if (format == XYBitmap)
-            (void) (*pGC->ops->CopyPlane) (&pPixmap->drawable, dst, pGC, 0, 0,
-                                           sw, sh, dx, dy, 1L);
-        else
-            (void) (*pGC->ops->CopyArea) (&pPixmap->drawable, dst, pGC, 0, 0,
-                                          sw, sh, dx, dy);
+        (void) (*pGC->ops->CopyArea) (&pPixmap->drawable, dst, pGC, 0, 0,
+                                      sw, sh, dx, dy);
         (*pPixmap->drawable.pScreen->DestroyPixmap) (pPixmap);
     }
 }
 
+/*
+ * A ZPixmap put from a segment into a pixmap created on that very
+ * segment, at the same location, is a copy onto itself: the client has
+ * already written the pixels.  All that's left is to tell damage.
+ */
+static Bool
+shmPutImageInPlace(DrawablePtr pDraw, GCPtr pGC, ShmDescPtr shmdesc,
+                   xShmPutImageReq *stuff, long length)
+{
+    PixmapPtr pPixmap;
+    unsigned long mask;
+    char *src, *dst;
+    int bpp;
+    BoxRec box;
+    RegionRec region;
+
+    if (pDraw->type != DRAWABLE_PIXMAP || stuff->format != ZPixmap)
+        return FALSE;
+    mask = pDraw->depth >= 32 ? ~0UL : (1UL << pDraw->depth) - 1;
+    if (pGC->alu != GXcopy || (pGC->planemask & mask) != mask)
+        return FALSE;
+
+    pPixmap = (PixmapPtr) pDraw;
+    if (dixLookupPrivate(&pPixmap->devPrivates, shmPixmapPrivateKey) != shmdesc)
+        return FALSE;
+    if (pPixmap->devKind != length)
+        return FALSE;
+
+    bpp = pDraw->bitsPerPixel;
+    src = shmdesc->addr + stuff->offset +
+        stuff->srcY * length + (stuff->srcX * bpp) / 8;
+    dst = (char *) pPixmap->devPrivate.ptr +
+        stuff->dstY * length + (stuff->dstX * bpp) / 8;
+    if (src != dst)
+        return FALSE;
+
+    box.x1 = max(stuff->dstX, 0);
+    box.y1 = max(stuff->dstY, 0);
+    box.x2 = min(stuff->dstX + stuff->srcWidth, pDraw->width);
+    box.y2 = min(stuff->dstY + stuff->srcHeight, pDraw->height);
+    if (box.x1 < box.x2 && box.y1 < box.y2) {
+        RegionInit(&region, &box, 1);
+        DamageDamageRegion(pDraw, &region);
+        RegionUninit(&region);
+    }
+    return TRUE;
+}
+
 static int
 ProcShmPutImage(ClientPtr client)
 {
@@ -576,7 +629,10 @@ ProcShmPutImage(ClientPtr client)
         return BadValue;
     }
 
-    if ((((stuff->format == ZPixmap) && (stuff->srcX == 0)) ||
+    if (shmPutImageInPlace(pDraw, pGC, shmdesc, stuff, length)) {
+        /* nothing to copy */
+    }
+    else if ((((stuff->format == ZPixmap) && (stuff->srcX == 0)) ||
          ((stuff->format != ZPixmap) &&
           (stuff->srcX < screenInfo.bitmapScanlinePad) &&
           ((stuff->format == XYBitmap) ||
@@ -1081,8 +1137,8 @@ ProcShmCreatePixmap(ClientPtr client)
                                                    shmdesc->addr +
                                                    stuff->offset);
     if (pMap) {
-        rc = XaceHook(XACE_RESOURCE_ACCESS, client, stuff->pid, RT_PIXMAP,
-                      pMap, RT_NONE, NULL, DixCreateAccess);
+        rc = XaceHookResourceAccess(client, stuff->pid, RT_PIXMAP,
+                                    pMap, RT_NONE, NULL, DixCreateAccess);
         if (rc != Success) {
             pDraw->pScreen->DestroyPixmap(pMap);
             return rc;
@@ -1112,6 +1168,22 @@ ShmBusfaultNotify(void *context)
     FreeResource (shmdesc->resource, RT_NONE);
 }
 
+/*
+ * A segment which can't shrink can't be truncated underneath us by the
+ * client, so there's no need to watch it for SIGBUS
+ */
+static Bool
+shm_fd_sealed(int fd)
+{
+#if defined(F_GET_SEALS) && defined(F_SEAL_SHRINK)
+    int seals = fcntl(fd, F_GET_SEALS);
+
+    return seals >= 0 && (seals & F_SEAL_SHRINK);
+#else
+    return FALSE;
+#endif
+}
+
 static int
 ProcShmAttachFd(ClientPtr client)
 {
@@ -1119,6 +1191,7 @@ ProcShmAttachFd(ClientPtr client)
     ShmDescPtr shmdesc;
     REQUEST(xShmAttachFdReq);
     struct stat statb;
+    Bool sealed;
 
     SetReqFds(client, 1);
     REQUEST_SIZE_MATCH(xShmAttachFdReq);
@@ -1147,6 +1220,7 @@ ProcShmAttachFd(ClientPtr client)
                          MAP_SHARED,
                          fd, 0);
 
+    sealed = shm_fd_sealed(fd);
     close(fd);
     if ((shmdesc->addr == ((char *) -1))) {
         free(shmdesc);
@@ -1158,11 +1232,14 @@ ProcShmAttachFd(ClientPtr client)
     shmdesc->size = statb.st_size;
     shmdesc->resource = stuff->shmseg;
 
-    shmdesc->busfault = busfault_register_mmap(shmdesc->addr, shmdesc->size, ShmBusfaultNotify, shmdesc);
-    if (!shmdesc->busfault) {
-        munmap(shmdesc->addr, shmdesc->size);
-        free(shmdesc);
-        return BadAlloc;
+    shmdesc->busfault = NULL;
+    if (!sealed) {
+        shmdesc->busfault = busfault_register_mmap(shmdesc->addr, shmdesc->size, ShmBusfaultNotify, shmdesc);
+        if (!shmdesc->busfault) {
+            munmap(shmdesc->addr, shmdesc->size);
+            free(shmdesc);
+            return BadAlloc;
+        }
     }
 
     shmdesc->next = Shmsegs;
@@ -1176,10 +1253,25 @@ ProcShmAttachFd(ClientPtr client)
 static int
 shm_tmpfile(void)
 {
-#ifdef SHMDIR
+#if defined(HAVE_MEMFD_CREATE) || defined(SHMDIR)
 	int	fd;
+#endif
+#ifdef SHMDIR
 	int	flags;
 	char	template[] = SHMDIR "/shmfd-XXXXXX";
+#endif
+
+#ifdef HAVE_MEMFD_CREATE
+	fd = memfd_create("xorg-shm", MFD_CLOEXEC|MFD_ALLOW_SEALING);
+	if (fd >= 0) {
+#ifdef F_ADD_SEALS
+		/* Growing is fine, but the client may not truncate it */
+		(void) fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK|F_SEAL_SEAL);
+#endif
+		return fd;
+	}
+#endif
+#ifdef SHMDIR
 #ifdef O_TMPFILE
 	fd = open(SHMDIR, O_TMPFILE|O_RDWR|O_CLOEXEC|O_EXCL, 0666);
 	if (fd >= 0) {
@@ -1248,12 +1340,15 @@ ProcShmCreateSegment(ClientPtr client)
     shmdesc->writable = !stuff->readOnly;
     shmdesc->size = stuff->size;
 
-    shmdesc->busfault = busfault_register_mmap(shmdesc->addr, shmdesc->size, ShmBusfaultNotify, shmdesc);
-    if (!shmdesc->busfault) {
-        close(fd);
-        munmap(shmdesc->addr, shmdesc->size);
-        free(shmdesc);
-        return BadAlloc;
+    shmdesc->busfault = NULL;
+    if (!shm_fd_sealed(fd)) {
+        shmdesc->busfault = busfault_register_mmap(shmdesc->addr, shmdesc->size, ShmBusfaultNotify, shmdesc);
+        if (!shmdesc->busfault) {
+            close(fd);
+            munmap(shmdesc->addr, shmdesc->size);
+            free(shmdesc);
+            return BadAlloc;
+        }
     }
 
     shmdesc->next = Shmsegs;
@@ -89,6 +89,7 @@ static RESTYPE RTAlarm;
 static RESTYPE RTAlarmClient;
 static RESTYPE RTFence;
 static struct xorg_list SysCounterList;
+static SyncCounter *IdleTimeCounter;
 static int SyncNumInvalidCounterWarnings = 0;
 
 #define MAX_INVALID_COUNTER_WARNINGS	   5
@@ -137,10 +138,206 @@ SyncCheckWarnIsCounter(const SyncObject * pSync, const char *warning)
     return TRUE;
 }
 
-/*  Each counter maintains a simple linked list of triggers that are
- *  interested in the counter.  The two functions below are used to
- *  delete and add triggers on this list.
+/*  Counters keep their triggers in one SyncTriggerSet per test type,
+ *  sorted by test value, so that the triggers a change of the counter
+ *  fires and the bracket values of system counters can be found with a
+ *  binary search.  Each trigger remembers the test type and value it is
+ *  filed under, as the trigger's own may be changed before it is refiled.
+ *  Fences keep a simple linked list of triggers.
  */
+
+/*  Triggers being fired by SyncChangeCounter.  Each trigger in one knows
+ *  its entry, so that removing a trigger clears it there and a trigger
+ *  deleted by an earlier one isn't fired.  Firings nest when firing a
+ *  trigger changes a counter, so each entry also remembers where the
+ *  trigger is in the enclosing firing.
+ */
+typedef struct _SyncFiringEntry {
+    SyncTrigger *pTrigger;
+    struct _SyncFiring *prev;
+    int prev_index;
+} SyncFiringEntry;
+
+typedef struct _SyncFiring {
+    SyncFiringEntry *entries;
+    int num;
+} SyncFiring;
+
+/* Counts counter changes, see SyncChangeCounter */
+static unsigned int SyncFireGeneration;
+
+static void
+SyncFiringAdd(SyncFiring *pFiring, SyncTrigger *pTrigger)
+{
+    SyncFiringEntry *pEntry = &pFiring->entries[pFiring->num];
+
+    pEntry->pTrigger = pTrigger;
+    pEntry->prev = pTrigger->firing;
+    pEntry->prev_index = pTrigger->firing_index;
+    pTrigger->firing = pFiring;
+    pTrigger->firing_index = pFiring->num++;
+}
+
+/* Clears pTrigger from every firing it is in. */
+static void
+SyncFiringClear(SyncTrigger *pTrigger)
+{
+    SyncFiring *pFiring = pTrigger->firing;
+    int i = pTrigger->firing_index;
+
+    while (pFiring) {
+        SyncFiringEntry *pEntry = &pFiring->entries[i];
+
+        pEntry->pTrigger = NULL;
+        pFiring = pEntry->prev;
+        i = pEntry->prev_index;
+    }
+    pTrigger->firing = NULL;
+}
+
+/* Hands the triggers left in pFiring back to the enclosing firing. */
+static void
+SyncFiringDone(SyncFiring *pFiring)
+{
+    int i;
+
+    for (i = 0; i < pFiring->num; i++) {
+        SyncFiringEntry *pEntry = &pFiring->entries[i];
+
+        if (pEntry->pTrigger) {
+            pEntry->pTrigger->firing = pEntry->prev;
+            pEntry->pTrigger->firing_index = pEntry->prev_index;
+        }
+    }
+}
+
+/* Returns the index of the first trigger in pSet with a test value greater
+ * than value if after is TRUE, greater or equal if it is FALSE.
+ */
+static int
+SyncTriggerSetSearch(SyncTriggerSet *pSet, CARD64 value, Bool after)
+{
+    int lo = 0, hi = pSet->num;
+
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        CARD64 test_value = pSet->triggers[mid]->set_value;
+
+        if (after ? XSyncValueLessOrEqual(test_value, value)
+                  : XSyncValueLessThan(test_value, value))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* Returns the index of pTrigger in pSet, filed under value, or -1. */
+static int
+SyncTriggerSetFind(SyncTriggerSet *pSet, SyncTrigger *pTrigger, CARD64 value)
+{
+    int i;
+
+    for (i = SyncTriggerSetSearch(pSet, value, FALSE);
+         i < pSet->num && XSyncValueEqual(pSet->triggers[i]->set_value, value);
+         i++) {
+        if (pSet->triggers[i] == pTrigger)
+            return i;
+    }
+    return -1;
+}
+
+/* Makes room for one more trigger in pSet. */
+static Bool
+SyncTriggerSetReserve(SyncTriggerSet *pSet)
+{
+    if (pSet->num == pSet->size) {
+        int size = pSet->size ? pSet->size * 2 : 8;
+        SyncTrigger **triggers = realloc(pSet->triggers,
+                                         size * sizeof(SyncTrigger *));
+
+        if (!triggers)
+            return FALSE;
+        pSet->triggers = triggers;
+        pSet->size = size;
+    }
+    return TRUE;
+}
+
+static Bool
+SyncTriggerSetInsert(SyncCounter *pCounter, SyncTrigger *pTrigger)
+{
+    SyncTriggerSet *pSet = &pCounter->triggers[pTrigger->test_type];
+    int i;
+
+    if (!SyncTriggerSetReserve(pSet))
+        return FALSE;
+
+    pTrigger->set_type = pTrigger->test_type;
+    pTrigger->set_value = pTrigger->test_value;
+    pTrigger->firing = NULL;
+    /* not fired by a counter change already under way */
+    pTrigger->fire_generation = SyncFireGeneration;
+    i = SyncTriggerSetSearch(pSet, pTrigger->set_value, TRUE);
+    memmove(&pSet->triggers[i + 1], &pSet->triggers[i],
+            (pSet->num - i) * sizeof(SyncTrigger *));
+    pSet->triggers[i] = pTrigger;
+    pSet->num++;
+    return TRUE;
+}
+
+static Bool
+SyncTriggerSetRemove(SyncCounter *pCounter, SyncTrigger *pTrigger,
+                     unsigned int type, CARD64 value)
+{
+    SyncTriggerSet *pSet;
+    int i;
+
+    if (type >= SYNC_NUM_TEST_TYPES)
+        return FALSE;
+    pSet = &pCounter->triggers[type];
+    i = SyncTriggerSetFind(pSet, pTrigger, value);
+    if (i < 0)
+        return FALSE;
+
+    pSet->num--;
+    memmove(&pSet->triggers[i], &pSet->triggers[i + 1],
+            (pSet->num - i) * sizeof(SyncTrigger *));
+    if (pTrigger->set_type == type &&
+        XSyncValueEqual(pTrigger->set_value, value))
+        pTrigger->set_type = SYNC_NUM_TEST_TYPES;
+
+    SyncFiringClear(pTrigger);
+    return TRUE;
+}
+
+/*  Files a trigger already on pCounter under its current test type and
+ *  value.  This must be called whenever either changes.
+ */
+static int
+SyncRefileTrigger(SyncCounter *pCounter, SyncTrigger *pTrigger)
+{
+    unsigned int type = pTrigger->set_type;
+    CARD64 value = pTrigger->set_value;
+
+    if (type == pTrigger->test_type &&
+        XSyncValueEqual(value, pTrigger->test_value))
+        return Success;
+    if (pTrigger->test_type >= SYNC_NUM_TEST_TYPES)
+        return BadValue;
+    if (type >= SYNC_NUM_TEST_TYPES ||
+        SyncTriggerSetFind(&pCounter->triggers[type], pTrigger, value) < 0)
+        return Success;         /* not on the counter */
+
+    /* Inserting overwrites set_type and set_value, which the removal
+     * needs to find the old entry, so make room first and move it after */
+    if (!SyncTriggerSetReserve(&pCounter->triggers[pTrigger->test_type]))
+        return BadAlloc;
+    SyncTriggerSetRemove(pCounter, pTrigger, type, value);
+    SyncTriggerSetInsert(pCounter, pTrigger);
+    return Success;
+}
+
 void
 SyncDeleteTriggerFromSyncObject(SyncTrigger * pTrigger)
 {
@@ -153,6 +350,16 @@ SyncDeleteTriggerFromSyncObject(SyncTrigger * pTrigger)
     if (!pTrigger->pSync)
         return;
 
+    if (SYNC_COUNTER == pTrigger->pSync->type) {
+        pCounter = (SyncCounter *) pTrigger->pSync;
+
+        SyncTriggerSetRemove(pCounter, pTrigger, pTrigger->set_type,
+                             pTrigger->set_value);
+        if (IsSystemCounter(pCounter))
+            SyncComputeBracketValues(pCounter);
+        return;
+    }
+
     pPrev = NULL;
     pCur = pTrigger->pSync->pTriglist;
 
@@ -171,13 +378,7 @@ SyncDeleteTriggerFromSyncObject(SyncTrigger * pTrigger)
         pCur = pCur->next;
     }
 
-    if (SYNC_COUNTER == pTrigger->pSync->type) {
-        pCounter = (SyncCounter *) pTrigger->pSync;
-
-        if (IsSystemCounter(pCounter))
-            SyncComputeBracketValues(pCounter);
-    }
-    else if (SYNC_FENCE == pTrigger->pSync->type) {
+    if (SYNC_FENCE == pTrigger->pSync->type) {
         SyncFence *pFence = (SyncFence *) pTrigger->pSync;
 
         pFence->funcs.DeleteTrigger(pTrigger);
@@ -193,6 +394,25 @@ SyncAddTriggerToSyncObject(SyncTrigger * pTrigger)
     if (!pTrigger->pSync)
         return Success;
 
+    if (SYNC_COUNTER == pTrigger->pSync->type) {
+        pCounter = (SyncCounter *) pTrigger->pSync;
+
+        /* don't do anything if it's already there */
+        if (pTrigger->set_type < SYNC_NUM_TEST_TYPES &&
+            SyncTriggerSetFind(&pCounter->triggers[pTrigger->set_type],
+                               pTrigger, pTrigger->set_value) >= 0)
+            return SyncRefileTrigger(pCounter, pTrigger);
+
+        if (pTrigger->test_type >= SYNC_NUM_TEST_TYPES)
+            return BadValue;
+        if (!SyncTriggerSetInsert(pCounter, pTrigger))
+            return BadAlloc;
+
+        if (IsSystemCounter(pCounter))
+            SyncComputeBracketValues(pCounter);
+        return Success;
+    }
+
     /* don't do anything if it's already there */
     for (pCur = pTrigger->pSync->pTriglist; pCur; pCur = pCur->next) {
         if (pCur->pTrigger == pTrigger)
@@ -206,13 +426,7 @@ SyncAddTriggerToSyncObject(SyncTrigger * pTrigger)
     pCur->next = pTrigger->pSync->pTriglist;
     pTrigger->pSync->pTriglist = pCur;
 
-    if (SYNC_COUNTER == pTrigger->pSync->type) {
-        pCounter = (SyncCounter *) pTrigger->pSync;
-
-        if (IsSystemCounter(pCounter))
-            SyncComputeBracketValues(pCounter);
-    }
-    else if (SYNC_FENCE == pTrigger->pSync->type) {
+    if (SYNC_FENCE == pTrigger->pSync->type) {
         SyncFence *pFence = (SyncFence *) pTrigger->pSync;
 
         pFence->funcs.AddTrigger(pTrigger);
@@ -221,6 +435,47 @@ SyncAddTriggerToSyncObject(SyncTrigger * pTrigger)
     return Success;
 }
 
+/*  Finds the triggers of pCounter that may have become true with the
+ *  change of its value from oldval to newval: start[type] to end[type]
+ *  in each of its trigger sets.  Returns how many there are.
+ */
+static int
+SyncCounterChangedRanges(SyncCounter *pCounter, CARD64 oldval, CARD64 newval,
+                         int *start, int *end)
+{
+    SyncTriggerSet *sets = pCounter->triggers;
+    int type, num = 0;
+
+    /* newval >= test value */
+    start[XSyncPositiveComparison] = 0;
+    end[XSyncPositiveComparison] =
+        SyncTriggerSetSearch(&sets[XSyncPositiveComparison], newval, TRUE);
+
+    /* newval <= test value */
+    start[XSyncNegativeComparison] =
+        SyncTriggerSetSearch(&sets[XSyncNegativeComparison], newval, FALSE);
+    end[XSyncNegativeComparison] = sets[XSyncNegativeComparison].num;
+
+    /* oldval < test value <= newval */
+    start[XSyncPositiveTransition] =
+        SyncTriggerSetSearch(&sets[XSyncPositiveTransition], oldval, TRUE);
+    end[XSyncPositiveTransition] =
+        SyncTriggerSetSearch(&sets[XSyncPositiveTransition], newval, TRUE);
+
+    /* newval <= test value < oldval */
+    start[XSyncNegativeTransition] =
+        SyncTriggerSetSearch(&sets[XSyncNegativeTransition], newval, FALSE);
+    end[XSyncNegativeTransition] =
+        SyncTriggerSetSearch(&sets[XSyncNegativeTransition], oldval, FALSE);
+
+    for (type = 0; type < SYNC_NUM_TEST_TYPES; type++) {
+        if (end[type] < start[type])
+            end[type] = start[type];
+        num += end[type] - start[type];
+    }
+    return num;
+}
+
 /*  Below are five possible functions that can be plugged into
  *  pTrigger->CheckTrigger for counter sync objects, corresponding to
  *  the four possible test-types, and the one possible function that
@@ -334,6 +589,7 @@ SyncInitTrigger(ClientPtr client, SyncTrigger * pTrigger, XID syncObject,
         if (pSync != pTrigger->pSync) { /* new counter for trigger */
             SyncDeleteTriggerFromSyncObject(pTrigger);
             pTrigger->pSync = pSync;
+            pTrigger->set_type = SYNC_NUM_TEST_TYPES;   /* not filed */
             newSyncObject = TRUE;
         }
     }
@@ -411,8 +667,11 @@ SyncInitTrigger(ClientPtr client, SyncTrigger * pTrigger, XID syncObject,
         if ((rc = SyncAddTriggerToSyncObject(pTrigger)) != Success)
             return rc;
     }
-    else if (pCounter && IsSystemCounter(pCounter)) {
-        SyncComputeBracketValues(pCounter);
+    else if (pCounter) {
+        if ((rc = SyncRefileTrigger(pCounter, pTrigger)) != Success)
+            return rc;
+        if (IsSystemCounter(pCounter))
+            SyncComputeBracketValues(pCounter);
     }
 
     return Success;
@@ -602,6 +861,8 @@ SyncAlarmTriggerFired(SyncTrigger * pTrigger)
      */
     SyncSendAlarmNotifyEvents(pAlarm);
     pTrigger->test_value = new_test_value;
+    if (pTrigger->pSync && SYNC_COUNTER == pTrigger->pSync->type)
+        SyncRefileTrigger((SyncCounter *) pTrigger->pSync, pTrigger);
 }
 
 /*  This function is called when an Await unblocks, either as a result
@@ -713,16 +974,69 @@ SyncUpdateCounter(SyncCounter *pCounter, CARD64 newval)
 void
 SyncChangeCounter(SyncCounter * pCounter, CARD64 newval)
 {
-    SyncTriggerList *ptl, *pnext;
+    SyncFiringEntry stack_entries[32];
+    SyncFiring firing;
+    int start[SYNC_NUM_TEST_TYPES], end[SYNC_NUM_TEST_TYPES];
+    int type, i, num, size;
+    unsigned int generation;
+    Bool chunked;
     CARD64 oldval;
 
     oldval = SyncUpdateCounter(pCounter, newval);
 
-    /* run through triggers to see if any become true */
-    for (ptl = pCounter->sync.pTriglist; ptl; ptl = pnext) {
-        pnext = ptl->next;
-        if ((*ptl->pTrigger->CheckTrigger) (ptl->pTrigger, oldval))
-            (*ptl->pTrigger->TriggerFired) (ptl->pTrigger);
+    /*  Only the triggers in the changed ranges can become true.  Copy them
+     *  out first, as firing one may add, move or delete others.  If there
+     *  is no memory for all of them, take 32 at a time, finding the ranges
+     *  again for each lot.  Triggers are stamped with the generation of
+     *  the change once copied, so no trigger is fired twice, and ones
+     *  added or moved while firing aren't fired at all, as when copied in
+     *  one go.
+     */
+    num = SyncCounterChangedRanges(pCounter, oldval, newval, start, end);
+    if (num) {
+        generation = ++SyncFireGeneration;
+        firing.entries = stack_entries;
+        size = ARRAY_SIZE(stack_entries);
+        if (num > size) {
+            SyncFiringEntry *entries = malloc(num * sizeof(SyncFiringEntry));
+
+            if (entries) {
+                firing.entries = entries;
+                size = num;
+            }
+        }
+        chunked = size < num;
+
+        do {
+            firing.num = 0;
+            for (type = 0; type < SYNC_NUM_TEST_TYPES; type++) {
+                SyncTriggerSet *pSet = &pCounter->triggers[type];
+
+                for (i = start[type]; i < end[type] && firing.num < size;
+                     i++) {
+                    SyncTrigger *pTrigger = pSet->triggers[i];
+
+                    if ((int) (pTrigger->fire_generation - generation) >= 0)
+                        continue;       /* copied already */
+                    pTrigger->fire_generation = generation;
+                    SyncFiringAdd(&firing, pTrigger);
+                }
+            }
+
+            /* run through triggers to see if any become true */
+            for (i = 0; i < firing.num; i++) {
+                SyncTrigger *pTrigger = firing.entries[i].pTrigger;
+
+                if (pTrigger && (*pTrigger->CheckTrigger) (pTrigger, oldval))
+                    (*pTrigger->TriggerFired) (pTrigger);
+            }
+            SyncFiringDone(&firing);
+        } while (chunked && firing.num == size &&
+                 SyncCounterChangedRanges(pCounter, oldval, newval,
+                                          start, end));
+
+        if (firing.entries != stack_entries)
+            free(firing.entries);
     }
 
     if (IsSystemCounter(pCounter)) {
@@ -962,6 +1276,7 @@ SyncCreateCounter(ClientPtr client, XSyncCounter id, CARD64 initialvalue)
 
     pCounter->value = initialvalue;
     pCounter->pSysCounterInfo = NULL;
+    memset(pCounter->triggers, 0, sizeof(pCounter->triggers));
 
     if (!AddResource(id, RTCounter, (void *) pCounter))
         return NULL;
@@ -1030,11 +1345,47 @@ SyncDestroySystemCounter(void *pSysCounter)
     FreeResource(pCounter->sync.id, RT_NONE);
 }
 
+/*  Lowers the greater bracket of pCounter to the smallest test value above
+ *  (or, if inclusive, at) the counter value in its set of type.
+ */
+static void
+SyncBracketGreater(SyncCounter *pCounter, int type, Bool inclusive,
+                   CARD64 **ppnewgtval)
+{
+    SyncTriggerSet *pSet = &pCounter->triggers[type];
+    SysCounterInfo *psci = pCounter->pSysCounterInfo;
+    int i = SyncTriggerSetSearch(pSet, pCounter->value, !inclusive);
+
+    if (i < pSet->num &&
+        XSyncValueLessThan(pSet->triggers[i]->set_value,
+                           psci->bracket_greater)) {
+        psci->bracket_greater = pSet->triggers[i]->set_value;
+        *ppnewgtval = &psci->bracket_greater;
+    }
+}
+
+/*  Raises the less bracket of pCounter to the largest test value below
+ *  (or, if inclusive, at) the counter value in its set of type.
+ */
+static void
+SyncBracketLess(SyncCounter *pCounter, int type, Bool inclusive,
+                CARD64 **ppnewltval)
+{
+    SyncTriggerSet *pSet = &pCounter->triggers[type];
+    SysCounterInfo *psci = pCounter->pSysCounterInfo;
+    int i = SyncTriggerSetSearch(pSet, pCounter->value, inclusive) - 1;
+
+    if (i >= 0 &&
+        XSyncValueGreaterThan(pSet->triggers[i]->set_value,
+                              psci->bracket_less)) {
+        psci->bracket_less = pSet->triggers[i]->set_value;
+        *ppnewltval = &psci->bracket_less;
+    }
+}
+
 static void
 SyncComputeBracketValues(SyncCounter * pCounter)
 {
-    SyncTriggerList *pCur;
-    SyncTrigger *pTrigger;
     SysCounterInfo *psci;
     CARD64 *pnewgtval = NULL;
     CARD64 *pnewltval = NULL;
@@ -1051,75 +1402,31 @@ SyncComputeBracketValues(SyncCounter * pCounter)
     XSyncMaxValue(&psci->bracket_greater);
     XSyncMinValue(&psci->bracket_less);
 
-    for (pCur = pCounter->sync.pTriglist; pCur; pCur = pCur->next) {
-        pTrigger = pCur->pTrigger;
-
-        if (pTrigger->test_type == XSyncPositiveComparison &&
-            ct != XSyncCounterNeverIncreases) {
-            if (XSyncValueLessThan(pCounter->value, pTrigger->test_value) &&
-                XSyncValueLessThan(pTrigger->test_value,
-                                   psci->bracket_greater)) {
-                psci->bracket_greater = pTrigger->test_value;
-                pnewgtval = &psci->bracket_greater;
-            }
-            else if (XSyncValueGreaterThan(pCounter->value, pTrigger->test_value) &&
-                     XSyncValueGreaterThan(pTrigger->test_value, psci->bracket_less)) {
-                    psci->bracket_less = pTrigger->test_value;
-                    pnewltval = &psci->bracket_less;
-            }
-        }
-        else if (pTrigger->test_type == XSyncNegativeComparison &&
-                 ct != XSyncCounterNeverDecreases) {
-            if (XSyncValueGreaterThan(pCounter->value, pTrigger->test_value) &&
-                XSyncValueGreaterThan(pTrigger->test_value,
-                                      psci->bracket_less)) {
-                psci->bracket_less = pTrigger->test_value;
-                pnewltval = &psci->bracket_less;
-            }
-            else if (XSyncValueLessThan(pCounter->value, pTrigger->test_value) &&
-                     XSyncValueLessThan(pTrigger->test_value, psci->bracket_greater)) {
-                    psci->bracket_greater = pTrigger->test_value;
-                    pnewgtval = &psci->bracket_greater;
-            }
-        }
-        else if (pTrigger->test_type == XSyncNegativeTransition &&
-                 ct != XSyncCounterNeverIncreases) {
-            if (XSyncValueGreaterOrEqual(pCounter->value, pTrigger->test_value) &&
-                XSyncValueGreaterThan(pTrigger->test_value, psci->bracket_less)) {
-                    /*
-                     * If the value is exactly equal to our threshold, we want one
-                     * more event in the negative direction to ensure we pick up
-                     * when the value is less than this threshold.
-                     */
-                    psci->bracket_less = pTrigger->test_value;
-                    pnewltval = &psci->bracket_less;
-            }
-            else if (XSyncValueLessThan(pCounter->value, pTrigger->test_value) &&
-                     XSyncValueLessThan(pTrigger->test_value, psci->bracket_greater)) {
-                    psci->bracket_greater = pTrigger->test_value;
-                    pnewgtval = &psci->bracket_greater;
-            }
-        }
-        else if (pTrigger->test_type == XSyncPositiveTransition &&
-                 ct != XSyncCounterNeverDecreases) {
-            if (XSyncValueLessOrEqual(pCounter->value, pTrigger->test_value) &&
-                XSyncValueLessThan(pTrigger->test_value, psci->bracket_greater)) {
-                    /*
-                     * If the value is exactly equal to our threshold, we
-                     * want one more event in the positive direction to
-                     * ensure we pick up when the value *exceeds* this
-                     * threshold.
-                     */
-                    psci->bracket_greater = pTrigger->test_value;
-                    pnewgtval = &psci->bracket_greater;
-            }
-            else if (XSyncValueGreaterThan(pCounter->value, pTrigger->test_value) &&
-                     XSyncValueGreaterThan(pTrigger->test_value, psci->bracket_less)) {
-                    psci->bracket_less = pTrigger->test_value;
-                    pnewltval = &psci->bracket_less;
-            }
-        }
-    }                           /* end for each trigger */
+    /*
+     * Transition triggers exactly at the counter value bracket it on the
+     * side they are waiting to be crossed from, as one more change in that
+     * direction is needed to pick up when the value passes the threshold.
+     */
+    if (ct != XSyncCounterNeverIncreases) {
+        SyncBracketGreater(pCounter, XSyncPositiveComparison, FALSE,
+                           &pnewgtval);
+        SyncBracketLess(pCounter, XSyncPositiveComparison, FALSE,
+                        &pnewltval);
+        SyncBracketGreater(pCounter, XSyncNegativeTransition, FALSE,
+                           &pnewgtval);
+        SyncBracketLess(pCounter, XSyncNegativeTransition, TRUE,
+                        &pnewltval);
+    }
+    if (ct != XSyncCounterNeverDecreases) {
+        SyncBracketGreater(pCounter, XSyncNegativeComparison, FALSE,
+                           &pnewgtval);
+        SyncBracketLess(pCounter, XSyncNegativeComparison, FALSE,
+                        &pnewltval);
+        SyncBracketGreater(pCounter, XSyncPositiveTransition, TRUE,
+                           &pnewgtval);
+        SyncBracketLess(pCounter, XSyncPositiveTransition, FALSE,
+                        &pnewltval);
+    }
 
     (*psci->BracketValues) ((void *) pCounter, pnewltval, pnewgtval);
 
@@ -1158,14 +1465,19 @@ static int
 FreeCounter(void *env, XID id)
 {
     SyncCounter *pCounter = (SyncCounter *) env;
-    SyncTriggerList *ptl, *pnext;
+    int type, i;
 
     pCounter->sync.beingDestroyed = TRUE;
+    /* let a system counter stop watching for its brackets */
+    if (IsSystemCounter(pCounter))
+        (*pCounter->pSysCounterInfo->BracketValues) (pCounter, NULL, NULL);
     /* tell all the counter's triggers that the counter has been destroyed */
-    for (ptl = pCounter->sync.pTriglist; ptl; ptl = pnext) {
-        (*ptl->pTrigger->CounterDestroyed) (ptl->pTrigger);
-        pnext = ptl->next;
-        free(ptl);              /* destroy the trigger list as we go */
+    for (type = 0; type < SYNC_NUM_TEST_TYPES; type++) {
+        SyncTriggerSet *pSet = &pCounter->triggers[type];
+
+        for (i = 0; i < pSet->num; i++)
+            (*pSet->triggers[i]->CounterDestroyed) (pSet->triggers[i]);
+        free(pSet->triggers);
     }
     if (IsSystemCounter(pCounter)) {
         xorg_list_del(&pCounter->pSysCounterInfo->entry);
@@ -2487,6 +2799,7 @@ static void
 SyncResetProc(ExtensionEntry * extEntry)
 {
     RTCounter = 0;
+    IdleTimeCounter = NULL;
 }
 
 /*
@@ -2558,6 +2871,7 @@ SyncExtensionInit(void)
 static void *ServertimeCounter;
 static XSyncValue Now;
 static XSyncValue *pnext_time;
+static OsTimerPtr ServertimeTimer;
 
 #define GetTime()\
 {\
@@ -2568,45 +2882,57 @@ static XSyncValue *pnext_time;
 }
 
 /*
-*** Server Block Handler
-*** code inspired by multibuffer extension (now deprecated)
+ * System counters are driven by OsTimers armed for the next bracket
+ * crossing rather than by block and wakeup handlers, so they cost nothing
+ * while no threshold is near.  Returns the timer delay from now to then.
+ * The timer never fires from within TimerSet, which would re-enter the
+ * counter from its BracketValues, and is kept within the range the timer
+ * list compares correctly; a timer that fires early simply rearms.
  */
- /*ARGSUSED*/ static void
-ServertimeBlockHandler(void *env, struct timeval **wt, void *LastSelectMask)
+static CARD32
+SyncTimerDelay(XSyncValue then, XSyncValue now)
 {
     XSyncValue delay;
-    unsigned long timeout;
+    Bool overflow;
 
-    if (pnext_time) {
-        GetTime();
+    if (XSyncValueLessOrEqual(then, now))
+        return 1;
+    XSyncValueSubtract(&delay, then, now, &overflow);
+    if (overflow || XSyncValueHigh32(delay) ||
+        XSyncValueLow32(delay) > INT32_MAX)
+        return INT32_MAX;
+    return XSyncValueLow32(delay);
+}
 
-        if (XSyncValueGreaterOrEqual(Now, *pnext_time)) {
-            timeout = 0;
-        }
-        else {
-            Bool overflow;
+static CARD32 ServertimeTimerNotify(OsTimerPtr timer, CARD32 now,
+                                    void *arg);
 
-            XSyncValueSubtract(&delay, *pnext_time, Now, &overflow);
-            (void) overflow;
-            timeout = XSyncValueLow32(delay);
-        }
-        AdjustWaitForDelay(wt, timeout);        /* os/utils.c */
+static void
+ServertimeArm(void)
+{
+    if (!pnext_time) {
+        TimerFree(ServertimeTimer);
+        ServertimeTimer = NULL;
+        return;
     }
+    GetTime();
+    ServertimeTimer = TimerSet(ServertimeTimer, 0,
+                               SyncTimerDelay(*pnext_time, Now),
+                               ServertimeTimerNotify, NULL);
 }
 
-/*
-*** Wakeup Handler
- */
- /*ARGSUSED*/ static void
-ServertimeWakeupHandler(void *env, int rc, void *LastSelectMask)
+ /*ARGSUSED*/ static CARD32
+ServertimeTimerNotify(OsTimerPtr timer, CARD32 now, void *arg)
 {
     if (pnext_time) {
         GetTime();
 
-        if (XSyncValueGreaterOrEqual(Now, *pnext_time)) {
+        if (XSyncValueGreaterOrEqual(Now, *pnext_time))
             SyncChangeCounter(ServertimeCounter, Now);
-        }
+        else
+            ServertimeArm();
     }
+    return 0;
 }
 
 static void
@@ -2620,15 +2946,8 @@ static void
 ServertimeBracketValues(void *pCounter, CARD64 * pbracket_less,
                         CARD64 * pbracket_greater)
 {
-    if (!pnext_time && pbracket_greater) {
-        RegisterBlockAndWakeupHandlers(ServertimeBlockHandler,
-                                       ServertimeWakeupHandler, NULL);
-    }
-    else if (pnext_time && !pbracket_greater) {
-        RemoveBlockAndWakeupHandlers(ServertimeBlockHandler,
-                                     ServertimeWakeupHandler, NULL);
-    }
     pnext_time = pbracket_greater;
+    ServertimeArm();
 }
 
 static void
@@ -2653,6 +2972,8 @@ typedef struct {
     XSyncValue *value_less;
     XSyncValue *value_greater;
     int deviceid;
+    OsTimerPtr timer;
+    Bool input_pending;         /* timer armed by SyncNoticeInputActivity */
 } IdleCounterPriv;
 
 static void
@@ -2672,86 +2993,54 @@ IdleTimeQueryValue(void *pCounter, CARD64 * pValue_return)
     XSyncIntsToValue(pValue_return, idle, 0);
 }
 
+static CARD32 IdleTimeTimerNotify(OsTimerPtr timer, CARD32 now, void *arg);
+
+/*
+ * The idle time only grows by itself, so the timer is armed for it to
+ * reach the greater bracket.  It drops only on input, which arms the
+ * timer through SyncNoticeInputActivity.
+ */
 static void
-IdleTimeBlockHandler(void *pCounter, struct timeval **wt, void *LastSelectMask)
+IdleTimeArm(SyncCounter *counter)
 {
-    SyncCounter *counter = pCounter;
     IdleCounterPriv *priv = SysCounterGetPrivate(counter);
     XSyncValue *less = priv->value_less,
                *greater = priv->value_greater;
-    XSyncValue idle, old_idle;
-    SyncTriggerList *list = counter->sync.pTriglist;
-    SyncTrigger *trig;
+    XSyncValue idle, next;
+    CARD32 delay = 0, next_delay;
+    Bool overflow;
 
-    if (!less && !greater)
+    if (!less && !greater) {
+        TimerFree(priv->timer);
+        priv->timer = NULL;
+        priv->input_pending = FALSE;
+        return;
+    }
+    if (priv->input_pending)
         return;
 
-    old_idle = counter->value;
     IdleTimeQueryValue(counter, &idle);
-    counter->value = idle;      /* push, so CheckTrigger works */
-
-    /**
-     * There's an indefinite amount of time between ProcessInputEvents()
-     * where the idle time is reset and the time we actually get here. idle
-     * may be past the lower bracket if we dawdled with the events, so
-     * check for whether we did reset and bomb out of select immediately.
-     */
-    if (less && XSyncValueGreaterThan(idle, *less) &&
-        LastEventTimeWasReset(priv->deviceid)) {
-        AdjustWaitForDelay(wt, 0);
-    } else if (less && XSyncValueLessOrEqual(idle, *less)) {
+    if (greater)
+        delay = SyncTimerDelay(*greater, idle);
+    if (less && XSyncValueLessOrEqual(idle, *less)) {
         /*
-         * We've been idle for less than the threshold value, and someone
-         * wants to know about that, but now we need to know whether they
-         * want level or edge trigger.  Check the trigger list against the
-         * current idle time, and if any succeed, bomb out of select()
-         * immediately so we can reschedule.
+         * We're at or below the less bracket, but a NegativeTransition
+         * trigger there requires a transition from an idle time greater
+         * than it.  Update the counter once the idle time passes it so we
+         * won't miss a transition.
          */
-
-        for (list = counter->sync.pTriglist; list; list = list->next) {
-            trig = list->pTrigger;
-            if (trig->CheckTrigger(trig, old_idle)) {
-                AdjustWaitForDelay(wt, 0);
-                break;
-            }
-        }
-        /* 
-         * We've been called exactly on the idle time, but we have a
-         * NegativeTransition trigger which requires a transition from an
-         * idle time greater than this.  Schedule a wakeup for the next
-         * millisecond so we won't miss a transition.
-         */
-        if (XSyncValueEqual(idle, *less))
-            AdjustWaitForDelay(wt, 1);
+        XSyncIntToValue(&next, 1);
+        XSyncValueAdd(&next, *less, next, &overflow);
+        next_delay = SyncTimerDelay(next, idle);
+        if (!delay || next_delay < delay)
+            delay = next_delay;
     }
-    else if (greater) {
-        /*
-         * There's a threshold in the positive direction.  If we've been
-         * idle less than it, schedule a wakeup for sometime in the future.
-         * If we've been idle more than it, and someone wants to know about
-         * that level-triggered, schedule an immediate wakeup.
-         */
-
-        if (XSyncValueLessThan(idle, *greater)) {
-            XSyncValue value;
-            Bool overflow;
 
-            XSyncValueSubtract(&value, *greater, idle, &overflow);
-            AdjustWaitForDelay(wt, XSyncValueLow32(value));
-        }
-        else {
-            for (list = counter->sync.pTriglist; list;
-                 list = list->next) {
-                trig = list->pTrigger;
-                if (trig->CheckTrigger(trig, old_idle)) {
-                    AdjustWaitForDelay(wt, 0);
-                    break;
-                }
-            }
-        }
-    }
-
-    counter->value = old_idle;  /* pop */
+    if (delay)
+        priv->timer = TimerSet(priv->timer, 0, delay, IdleTimeTimerNotify,
+                               counter);
+    else
+        TimerCancel(priv->timer);
 }
 
 static void
@@ -2765,22 +3054,23 @@ IdleTimeCheckBrackets(SyncCounter *counter, XSyncValue idle, XSyncValue *less, X
         SyncUpdateCounter(counter, idle);
 }
 
-static void
-IdleTimeWakeupHandler(void *pCounter, int rc, void *LastSelectMask)
+static CARD32
+IdleTimeTimerNotify(OsTimerPtr timer, CARD32 now, void *arg)
 {
-    SyncCounter *counter = pCounter;
+    SyncCounter *counter = arg;
     IdleCounterPriv *priv = SysCounterGetPrivate(counter);
     XSyncValue *less = priv->value_less,
                *greater = priv->value_greater;
     XSyncValue idle;
 
+    priv->input_pending = FALSE;
     if (!less && !greater)
-        return;
+        return 0;
 
-    IdleTimeQueryValue(pCounter, &idle);
+    IdleTimeQueryValue(counter, &idle);
 
     /*
-      There is no guarantee for the WakeupHandler to be called within a specific
+      There is no guarantee for the timer to be called within a specific
       timeframe. Idletime may go to 0, but by the time we get here, it may be
       non-zero and alarms for a pos. transition on 0 won't get triggered.
       https://bugs.freedesktop.org/show_bug.cgi?id=70476
@@ -2797,6 +3087,8 @@ IdleTimeWakeupHandler(void *pCounter, int rc, void *LastSelectMask)
     }
 
     IdleTimeCheckBrackets(counter, idle, less, greater);
+    IdleTimeArm(counter);
+    return 0;
 }
 
 static void
@@ -2805,24 +3097,46 @@ IdleTimeBracketValues(void *pCounter, CARD64 * pbracket_less,
 {
     SyncCounter *counter = pCounter;
     IdleCounterPriv *priv = SysCounterGetPrivate(counter);
-    XSyncValue *less = priv->value_less,
-               *greater = priv->value_greater;
-    Bool registered = (less || greater);
+    Bool registered = (priv->value_less || priv->value_greater);
 
-    if (registered && !pbracket_less && !pbracket_greater) {
-        RemoveBlockAndWakeupHandlers(IdleTimeBlockHandler,
-                                     IdleTimeWakeupHandler, pCounter);
-    }
-    else if (!registered && (pbracket_less || pbracket_greater)) {
+    if (!registered && (pbracket_less || pbracket_greater)) {
         /* Reset flag must be zero so we don't force a idle timer reset on
-           the first wakeup */
+           the first check */
         LastEventTimeToggleResetAll(FALSE);
-        RegisterBlockAndWakeupHandlers(IdleTimeBlockHandler,
-                                       IdleTimeWakeupHandler, pCounter);
     }
 
     priv->value_greater = pbracket_greater;
     priv->value_less = pbracket_less;
+    IdleTimeArm(counter);
+}
+
+static void
+IdleTimeNoticeInput(SyncCounter *counter)
+{
+    IdleCounterPriv *priv;
+
+    if (!counter)
+        return;
+    priv = SysCounterGetPrivate(counter);
+
+    /* only a less bracket can be crossed by the idle time dropping */
+    if (priv->value_less && !priv->input_pending) {
+        priv->timer = TimerSet(priv->timer, 0, 1, IdleTimeTimerNotify,
+                               counter);
+        priv->input_pending = priv->timer != NULL;
+    }
+}
+
+/*
+ * Called from the input path whenever dev's last event time is reset.
+ * Devices without an idle counter of their own, such as the placeholders
+ * InitEvents resets the times with, only move IDLETIME.
+ */
+void
+SyncNoticeInputActivity(DeviceIntPtr dev)
+{
+    IdleTimeNoticeInput(IdleTimeCounter);
+    IdleTimeNoticeInput(dev->idle_counter);
 }
 
 static SyncCounter*
@@ -2845,6 +3159,8 @@ init_system_idle_counter(const char *name, int deviceid)
 
         priv->value_less = priv->value_greater = NULL;
         priv->deviceid = deviceid;
+        priv->timer = NULL;
+        priv->input_pending = FALSE;
 
         idle_time_counter->pSysCounterInfo->private = priv;
     }
@@ -2855,7 +3171,7 @@ init_system_idle_counter(const char *name, int deviceid)
 static void
 SyncInitIdleTime(void)
 {
-    init_system_idle_counter("IDLETIME", XIAllDevices);
+    IdleTimeCounter = init_system_idle_counter("IDLETIME", XIAllDevices);
 }
 
 SyncCounter*
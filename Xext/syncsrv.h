@@ -136,6 +136,7 @@ extern void SyncDestroySystemCounter(void *pCounter);
 
 extern SyncCounter *SyncInitDeviceIdleTime(DeviceIntPtr dev);
 extern void SyncRemoveDeviceIdleTime(SyncCounter *counter);
+extern void SyncNoticeInputActivity(DeviceIntPtr dev);
 
 int
 SyncCreateFenceFromFD(ClientPtr client, DrawablePtr pDraw, XID id, int fd, BOOL initially_triggered);
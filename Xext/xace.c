@@ -36,10 +36,11 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 _X_EXPORT CallbackListPtr XaceHooks[XACE_NUM_HOOKS] = { 0 };
 
-/* Special-cased hook functions.  Called by Xserver.
+/* Out-of-line halves of the typed hook functions in xace.h.  These are
+ * only reached once a callback has been registered on the hook.
  */
 int
-XaceHookDispatch(ClientPtr client, int major)
+_XaceHookDispatch(ClientPtr client, int major)
 {
     /* Call the audit begin callback, there is no return value. */
     XaceAuditRec rec = { client, 0 };
@@ -62,9 +63,36 @@ XaceHookDispatch(ClientPtr client, int major)
     }
 }
 
+void
+_XaceHookAuditEnd(ClientPtr ptr, int result)
+{
+    XaceAuditRec rec = { ptr, result };
+    /* call callbacks, there is no return value. */
+    CallCallbacks(&XaceHooks[XACE_AUDIT_END], &rec);
+}
+
 int
-XaceHookPropertyAccess(ClientPtr client, WindowPtr pWin,
-                       PropertyPtr *ppProp, Mask access_mode)
+_XaceHookResourceAccess(ClientPtr client, XID id, RESTYPE rtype, void *res,
+                        RESTYPE ptype, void *parent, Mask access_mode)
+{
+    XaceResourceAccessRec rec = {
+        client, id, rtype, res, ptype, parent, access_mode, Success
+    };
+    CallCallbacks(&XaceHooks[XACE_RESOURCE_ACCESS], &rec);
+    return rec.status;
+}
+
+int
+_XaceHookDeviceAccess(ClientPtr client, DeviceIntPtr dev, Mask access_mode)
+{
+    XaceDeviceAccessRec rec = { client, dev, access_mode, Success };
+    CallCallbacks(&XaceHooks[XACE_DEVICE_ACCESS], &rec);
+    return rec.status;
+}
+
+int
+_XaceHookPropertyAccess(ClientPtr client, WindowPtr pWin,
+                        PropertyPtr *ppProp, Mask access_mode)
 {
     XacePropertyAccessRec rec = { client, pWin, ppProp, access_mode, Success };
     CallCallbacks(&XaceHooks[XACE_PROPERTY_ACCESS], &rec);
@@ -72,145 +100,198 @@ XaceHookPropertyAccess(ClientPtr client, WindowPtr pWin,
 }
 
 int
-XaceHookSelectionAccess(ClientPtr client, Selection ** ppSel, Mask access_mode)
+_XaceHookSendAccess(ClientPtr client, DeviceIntPtr dev, WindowPtr pWin,
+                    xEventPtr events, int count)
+{
+    XaceSendAccessRec rec = { client, dev, pWin, events, count, Success };
+    CallCallbacks(&XaceHooks[XACE_SEND_ACCESS], &rec);
+    return rec.status;
+}
+
+int
+_XaceHookReceiveAccess(ClientPtr client, WindowPtr pWin,
+                       xEventPtr events, int count)
+{
+    XaceReceiveAccessRec rec = { client, pWin, events, count, Success };
+    CallCallbacks(&XaceHooks[XACE_RECEIVE_ACCESS], &rec);
+    return rec.status;
+}
+
+int
+_XaceHookClientAccess(ClientPtr client, ClientPtr target, Mask access_mode)
+{
+    XaceClientAccessRec rec = { client, target, access_mode, Success };
+    CallCallbacks(&XaceHooks[XACE_CLIENT_ACCESS], &rec);
+    return rec.status;
+}
+
+int
+_XaceHookExtAccess(ClientPtr client, ExtensionEntry *ext)
+{
+    XaceExtAccessRec rec = { client, ext, DixGetAttrAccess, Success };
+    CallCallbacks(&XaceHooks[XACE_EXT_ACCESS], &rec);
+    return rec.status;
+}
+
+int
+_XaceHookServerAccess(ClientPtr client, Mask access_mode)
+{
+    XaceServerAccessRec rec = { client, access_mode, Success };
+    CallCallbacks(&XaceHooks[XACE_SERVER_ACCESS], &rec);
+    return rec.status;
+}
+
+int
+_XaceHookSelectionAccess(ClientPtr client, Selection ** ppSel,
+                         Mask access_mode)
 {
     XaceSelectionAccessRec rec = { client, ppSel, access_mode, Success };
     CallCallbacks(&XaceHooks[XACE_SELECTION_ACCESS], &rec);
     return rec.status;
 }
 
+/* XACE_SCREEN_ACCESS and XACE_SCREENSAVER_ACCESS share a record */
+int
+_XaceHookScreenAccess(int hook, ClientPtr client, ScreenPtr screen,
+                      Mask access_mode)
+{
+    XaceScreenAccessRec rec = { client, screen, access_mode, Success };
+    CallCallbacks(&XaceHooks[hook], &rec);
+    return rec.status;
+}
+
 void
-XaceHookAuditEnd(ClientPtr ptr, int result)
+_XaceHookAuthAvail(ClientPtr client, XID authId)
 {
-    XaceAuditRec rec = { ptr, result };
-    /* call callbacks, there is no return value. */
-    CallCallbacks(&XaceHooks[XACE_AUDIT_END], &rec);
+    XaceAuthAvailRec rec = { client, authId };
+    CallCallbacks(&XaceHooks[XACE_AUTH_AVAIL], &rec);
 }
 
-/* Entry point for hook functions.  Called by Xserver.
+void
+_XaceHookKeyAvail(xEventPtr event, DeviceIntPtr keybd, int count)
+{
+    XaceKeyAvailRec rec = { event, keybd, count };
+    CallCallbacks(&XaceHooks[XACE_KEY_AVAIL], &rec);
+}
+
+/* Generic entry point for hook functions.  The server uses the typed
+ * hooks; this unpacks the arguments for modules still calling it.
  */
 int
 XaceHook(int hook, ...)
 {
-    union {
-        XaceResourceAccessRec res;
-        XaceDeviceAccessRec dev;
-        XaceSendAccessRec send;
-        XaceReceiveAccessRec recv;
-        XaceClientAccessRec client;
-        XaceExtAccessRec ext;
-        XaceServerAccessRec server;
-        XaceScreenAccessRec screen;
-        XaceAuthAvailRec auth;
-        XaceKeyAvailRec key;
-    } u;
-    int *prv = NULL;            /* points to return value from callback */
     va_list ap;                 /* argument list */
+    int rc = Success;
 
     if (!XaceHooks[hook])
         return Success;
 
     va_start(ap, hook);
 
-    /* Marshal arguments for passing to callback.
-     * Each callback has its own case, which sets up a structure to hold
-     * the arguments and integer return parameter, or in some cases just
-     * sets calldata directly to a single argument (with no return result)
-     */
     switch (hook) {
     case XACE_RESOURCE_ACCESS:
-        u.res.client = va_arg(ap, ClientPtr);
-        u.res.id = va_arg(ap, XID);
-        u.res.rtype = va_arg(ap, RESTYPE);
-        u.res.res = va_arg(ap, void *);
-        u.res.ptype = va_arg(ap, RESTYPE);
-        u.res.parent = va_arg(ap, void *);
-        u.res.access_mode = va_arg(ap, Mask);
-
-        u.res.status = Success; /* default allow */
-        prv = &u.res.status;
+    {
+        ClientPtr client = va_arg(ap, ClientPtr);
+        XID id = va_arg(ap, XID);
+        RESTYPE rtype = va_arg(ap, RESTYPE);
+        void *res = va_arg(ap, void *);
+        RESTYPE ptype = va_arg(ap, RESTYPE);
+        void *parent = va_arg(ap, void *);
+        Mask access_mode = va_arg(ap, Mask);
+
+        rc = _XaceHookResourceAccess(client, id, rtype, res, ptype, parent,
+                                     access_mode);
         break;
+    }
     case XACE_DEVICE_ACCESS:
-        u.dev.client = va_arg(ap, ClientPtr);
-        u.dev.dev = va_arg(ap, DeviceIntPtr);
-        u.dev.access_mode = va_arg(ap, Mask);
+    {
+        ClientPtr client = va_arg(ap, ClientPtr);
+        DeviceIntPtr dev = va_arg(ap, DeviceIntPtr);
+        Mask access_mode = va_arg(ap, Mask);
 
-        u.dev.status = Success; /* default allow */
-        prv = &u.dev.status;
+        rc = _XaceHookDeviceAccess(client, dev, access_mode);
         break;
+    }
     case XACE_SEND_ACCESS:
-        u.send.client = va_arg(ap, ClientPtr);
-        u.send.dev = va_arg(ap, DeviceIntPtr);
-        u.send.pWin = va_arg(ap, WindowPtr);
-
-        u.send.events = va_arg(ap, xEventPtr);
-        u.send.count = va_arg(ap, int);
-
-        u.send.status = Success;        /* default allow */
-        prv = &u.send.status;
+    {
+        ClientPtr client = va_arg(ap, ClientPtr);
+        DeviceIntPtr dev = va_arg(ap, DeviceIntPtr);
+        WindowPtr pWin = va_arg(ap, WindowPtr);
+        xEventPtr events = va_arg(ap, xEventPtr);
+        int count = va_arg(ap, int);
+
+        rc = _XaceHookSendAccess(client, dev, pWin, events, count);
         break;
+    }
     case XACE_RECEIVE_ACCESS:
-        u.recv.client = va_arg(ap, ClientPtr);
-        u.recv.pWin = va_arg(ap, WindowPtr);
+    {
+        ClientPtr client = va_arg(ap, ClientPtr);
+        WindowPtr pWin = va_arg(ap, WindowPtr);
+        xEventPtr events = va_arg(ap, xEventPtr);
+        int count = va_arg(ap, int);
 
-        u.recv.events = va_arg(ap, xEventPtr);
-        u.recv.count = va_arg(ap, int);
-
-        u.recv.status = Success;        /* default allow */
-        prv = &u.recv.status;
+        rc = _XaceHookReceiveAccess(client, pWin, events, count);
         break;
+    }
     case XACE_CLIENT_ACCESS:
-        u.client.client = va_arg(ap, ClientPtr);
-        u.client.target = va_arg(ap, ClientPtr);
-        u.client.access_mode = va_arg(ap, Mask);
+    {
+        ClientPtr client = va_arg(ap, ClientPtr);
+        ClientPtr target = va_arg(ap, ClientPtr);
+        Mask access_mode = va_arg(ap, Mask);
 
-        u.client.status = Success;      /* default allow */
-        prv = &u.client.status;
+        rc = _XaceHookClientAccess(client, target, access_mode);
         break;
+    }
     case XACE_EXT_ACCESS:
-        u.ext.client = va_arg(ap, ClientPtr);
+    {
+        ClientPtr client = va_arg(ap, ClientPtr);
+        ExtensionEntry *ext = va_arg(ap, ExtensionEntry *);
 
-        u.ext.ext = va_arg(ap, ExtensionEntry *);
-        u.ext.access_mode = DixGetAttrAccess;
-        u.ext.status = Success; /* default allow */
-        prv = &u.ext.status;
+        rc = _XaceHookExtAccess(client, ext);
         break;
+    }
     case XACE_SERVER_ACCESS:
-        u.server.client = va_arg(ap, ClientPtr);
-        u.server.access_mode = va_arg(ap, Mask);
+    {
+        ClientPtr client = va_arg(ap, ClientPtr);
+        Mask access_mode = va_arg(ap, Mask);
 
-        u.server.status = Success;      /* default allow */
-        prv = &u.server.status;
+        rc = _XaceHookServerAccess(client, access_mode);
         break;
+    }
     case XACE_SCREEN_ACCESS:
     case XACE_SCREENSAVER_ACCESS:
-        u.screen.client = va_arg(ap, ClientPtr);
-        u.screen.screen = va_arg(ap, ScreenPtr);
-        u.screen.access_mode = va_arg(ap, Mask);
+    {
+        ClientPtr client = va_arg(ap, ClientPtr);
+        ScreenPtr screen = va_arg(ap, ScreenPtr);
+        Mask access_mode = va_arg(ap, Mask);
 
-        u.screen.status = Success;      /* default allow */
-        prv = &u.screen.status;
+        rc = _XaceHookScreenAccess(hook, client, screen, access_mode);
         break;
+    }
     case XACE_AUTH_AVAIL:
-        u.auth.client = va_arg(ap, ClientPtr);
-        u.auth.authId = va_arg(ap, XID);
+    {
+        ClientPtr client = va_arg(ap, ClientPtr);
+        XID authId = va_arg(ap, XID);
 
+        _XaceHookAuthAvail(client, authId);
         break;
+    }
     case XACE_KEY_AVAIL:
-        u.key.event = va_arg(ap, xEventPtr);
-        u.key.keybd = va_arg(ap, DeviceIntPtr);
-        u.key.count = va_arg(ap, int);
+    {
+        xEventPtr event = va_arg(ap, xEventPtr);
+        DeviceIntPtr keybd = va_arg(ap, DeviceIntPtr);
+        int count = va_arg(ap, int);
 
+        _XaceHookKeyAvail(event, keybd, count);
         break;
+    }
     default:
-        va_end(ap);
-        return 0;               /* unimplemented hook number */
+        rc = 0;                 /* unimplemented hook number */
+        break;
     }
     va_end(ap);
 
-    /* call callbacks and return result, if any. */
-    CallCallbacks(&XaceHooks[hook], &u);
-    return prv ? *prv : Success;
+    return rc;
 }
 
 /* XaceCensorImage
@@ -321,6 +402,41 @@ XaceCensorImage(ClientPtr client,
     RegionUninit(&censorRegion);
 }                               /* XaceCensorImage */
 
+/*
+ * Exported versions of the hooks that used to be out-of-line, for modules
+ * built against older servers.
+ */
+#undef XaceHookDispatch
+#undef XaceHookAuditEnd
+#undef XaceHookPropertyAccess
+#undef XaceHookSelectionAccess
+
+int
+XaceHookDispatch(ClientPtr client, int major)
+{
+    return XaceHookDispatchInline(client, major);
+}
+
+void
+XaceHookAuditEnd(ClientPtr client, int result)
+{
+    XaceHookAuditEndInline(client, result);
+}
+
+int
+XaceHookPropertyAccess(ClientPtr client, WindowPtr pWin,
+                       PropertyPtr *ppProp, Mask access_mode)
+{
+    return XaceHookPropertyAccessInline(client, pWin, ppProp, access_mode);
+}
+
+int
+XaceHookSelectionAccess(ClientPtr client, Selection ** ppSel,
+                        Mask access_mode)
+{
+    return XaceHookSelectionAccessInline(client, ppSel, access_mode);
+}
+
 /*
  * Xtrans wrappers for use by modules
  */
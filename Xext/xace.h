@@ -23,11 +23,13 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #ifdef XACE
 
 #define XACE_MAJOR_VERSION		2
-#define XACE_MINOR_VERSION		0
+#define XACE_MINOR_VERSION		1
 
 #include "pixmap.h"
 #include "region.h"
 #include "window.h"
+#include "input.h"
+#include "resource.h"
 #include "property.h"
 #include "selection.h"
 
@@ -58,22 +60,202 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 extern _X_EXPORT CallbackListPtr XaceHooks[XACE_NUM_HOOKS];
 
-/* Entry point for hook functions.  Called by Xserver.
- * Required by libdbe and libextmod
+/* A hook's callback list stays NULL until a security module registers on
+ * it, so with no module loaded every hook below is a single test.
+ */
+#define XaceHookIsSet(hook) _X_UNLIKELY(XaceHooks[hook] != NULL)
+
+/* Generic entry point for hook functions, for modules that still use it.
+ * The server calls the typed hooks below instead.
  */
 extern _X_EXPORT int XaceHook(int /*hook */ ,
                               ...       /*appropriate args for hook */
     );
 
-/* Special-cased hook functions
+/* Out-of-line halves of the typed hooks, only called when the hook is set.
+ */
+struct _ExtensionEntry;
+
+extern _X_EXPORT int _XaceHookDispatch(ClientPtr ptr, int major);
+extern _X_EXPORT void _XaceHookAuditEnd(ClientPtr ptr, int result);
+extern _X_EXPORT int _XaceHookResourceAccess(ClientPtr ptr, XID id,
+                                             RESTYPE rtype, void *res,
+                                             RESTYPE ptype, void *parent,
+                                             Mask access_mode);
+extern _X_EXPORT int _XaceHookDeviceAccess(ClientPtr ptr, DeviceIntPtr dev,
+                                           Mask access_mode);
+extern _X_EXPORT int _XaceHookPropertyAccess(ClientPtr ptr, WindowPtr pWin,
+                                             PropertyPtr *ppProp,
+                                             Mask access_mode);
+extern _X_EXPORT int _XaceHookSendAccess(ClientPtr ptr, DeviceIntPtr dev,
+                                         WindowPtr pWin, xEventPtr events,
+                                         int count);
+extern _X_EXPORT int _XaceHookReceiveAccess(ClientPtr ptr, WindowPtr pWin,
+                                            xEventPtr events, int count);
+extern _X_EXPORT int _XaceHookClientAccess(ClientPtr ptr, ClientPtr target,
+                                           Mask access_mode);
+extern _X_EXPORT int _XaceHookExtAccess(ClientPtr ptr,
+                                        struct _ExtensionEntry *ext);
+extern _X_EXPORT int _XaceHookServerAccess(ClientPtr ptr, Mask access_mode);
+extern _X_EXPORT int _XaceHookSelectionAccess(ClientPtr ptr,
+                                              Selection ** ppSel,
+                                              Mask access_mode);
+extern _X_EXPORT int _XaceHookScreenAccess(int hook, ClientPtr ptr,
+                                           ScreenPtr screen,
+                                           Mask access_mode);
+extern _X_EXPORT void _XaceHookAuthAvail(ClientPtr ptr, XID authId);
+extern _X_EXPORT void _XaceHookKeyAvail(xEventPtr event, DeviceIntPtr keybd,
+                                        int count);
+
+/* These four were exported functions before the hooks were inlined, and
+ * modules built against older servers still link against them.  xace.c
+ * keeps them; the server itself uses the inline versions below.
  */
 extern _X_EXPORT int XaceHookDispatch(ClientPtr ptr, int major);
+extern _X_EXPORT void XaceHookAuditEnd(ClientPtr ptr, int result);
 extern _X_EXPORT int XaceHookPropertyAccess(ClientPtr ptr, WindowPtr pWin,
                                             PropertyPtr *ppProp,
                                             Mask access_mode);
-extern _X_EXPORT int XaceHookSelectionAccess(ClientPtr ptr, Selection ** ppSel,
+extern _X_EXPORT int XaceHookSelectionAccess(ClientPtr ptr,
+                                             Selection ** ppSel,
                                              Mask access_mode);
-extern _X_EXPORT void XaceHookAuditEnd(ClientPtr ptr, int result);
+
+/* Typed hook functions.  Called by Xserver.
+ */
+static inline int
+XaceHookDispatchInline(ClientPtr ptr, int major)
+{
+    if (XaceHookIsSet(XACE_AUDIT_BEGIN) ||
+        XaceHookIsSet(major < 128 ? XACE_CORE_DISPATCH : XACE_EXT_DISPATCH))
+        return _XaceHookDispatch(ptr, major);
+    return Success;
+}
+
+static inline void
+XaceHookAuditEndInline(ClientPtr ptr, int result)
+{
+    if (XaceHookIsSet(XACE_AUDIT_END))
+        _XaceHookAuditEnd(ptr, result);
+}
+
+static inline int
+XaceHookResourceAccess(ClientPtr ptr, XID id, RESTYPE rtype, void *res,
+                       RESTYPE ptype, void *parent, Mask access_mode)
+{
+    if (XaceHookIsSet(XACE_RESOURCE_ACCESS))
+        return _XaceHookResourceAccess(ptr, id, rtype, res, ptype, parent,
+                                       access_mode);
+    return Success;
+}
+
+static inline int
+XaceHookDeviceAccess(ClientPtr ptr, DeviceIntPtr dev, Mask access_mode)
+{
+    if (XaceHookIsSet(XACE_DEVICE_ACCESS))
+        return _XaceHookDeviceAccess(ptr, dev, access_mode);
+    return Success;
+}
+
+static inline int
+XaceHookPropertyAccessInline(ClientPtr ptr, WindowPtr pWin,
+                             PropertyPtr *ppProp, Mask access_mode)
+{
+    if (XaceHookIsSet(XACE_PROPERTY_ACCESS))
+        return _XaceHookPropertyAccess(ptr, pWin, ppProp, access_mode);
+    return Success;
+}
+
+static inline int
+XaceHookSendAccess(ClientPtr ptr, DeviceIntPtr dev, WindowPtr pWin,
+                   xEventPtr events, int count)
+{
+    if (XaceHookIsSet(XACE_SEND_ACCESS))
+        return _XaceHookSendAccess(ptr, dev, pWin, events, count);
+    return Success;
+}
+
+static inline int
+XaceHookReceiveAccess(ClientPtr ptr, WindowPtr pWin, xEventPtr events,
+                      int count)
+{
+    if (XaceHookIsSet(XACE_RECEIVE_ACCESS))
+        return _XaceHookReceiveAccess(ptr, pWin, events, count);
+    return Success;
+}
+
+static inline int
+XaceHookClientAccess(ClientPtr ptr, ClientPtr target, Mask access_mode)
+{
+    if (XaceHookIsSet(XACE_CLIENT_ACCESS))
+        return _XaceHookClientAccess(ptr, target, access_mode);
+    return Success;
+}
+
+static inline int
+XaceHookExtAccess(ClientPtr ptr, struct _ExtensionEntry *ext)
+{
+    if (XaceHookIsSet(XACE_EXT_ACCESS))
+        return _XaceHookExtAccess(ptr, ext);
+    return Success;
+}
+
+static inline int
+XaceHookServerAccess(ClientPtr ptr, Mask access_mode)
+{
+    if (XaceHookIsSet(XACE_SERVER_ACCESS))
+        return _XaceHookServerAccess(ptr, access_mode);
+    return Success;
+}
+
+static inline int
+XaceHookSelectionAccessInline(ClientPtr ptr, Selection ** ppSel,
+                              Mask access_mode)
+{
+    if (XaceHookIsSet(XACE_SELECTION_ACCESS))
+        return _XaceHookSelectionAccess(ptr, ppSel, access_mode);
+    return Success;
+}
+
+static inline int
+XaceHookScreenAccess(ClientPtr ptr, ScreenPtr screen, Mask access_mode)
+{
+    if (XaceHookIsSet(XACE_SCREEN_ACCESS))
+        return _XaceHookScreenAccess(XACE_SCREEN_ACCESS, ptr, screen,
+                                     access_mode);
+    return Success;
+}
+
+static inline int
+XaceHookScreensaverAccess(ClientPtr ptr, ScreenPtr screen, Mask access_mode)
+{
+    if (XaceHookIsSet(XACE_SCREENSAVER_ACCESS))
+        return _XaceHookScreenAccess(XACE_SCREENSAVER_ACCESS, ptr, screen,
+                                     access_mode);
+    return Success;
+}
+
+static inline void
+XaceHookAuthAvail(ClientPtr ptr, XID authId)
+{
+    if (XaceHookIsSet(XACE_AUTH_AVAIL))
+        _XaceHookAuthAvail(ptr, authId);
+}
+
+static inline void
+XaceHookKeyAvail(xEventPtr event, DeviceIntPtr keybd, int count)
+{
+    if (XaceHookIsSet(XACE_KEY_AVAIL))
+        _XaceHookKeyAvail(event, keybd, count);
+}
+
+#define XaceHookDispatch(ptr, major) \
+    XaceHookDispatchInline(ptr, major)
+#define XaceHookAuditEnd(ptr, result) \
+    XaceHookAuditEndInline(ptr, result)
+#define XaceHookPropertyAccess(ptr, pWin, ppProp, access_mode) \
+    XaceHookPropertyAccessInline(ptr, pWin, ppProp, access_mode)
+#define XaceHookSelectionAccess(ptr, ppSel, access_mode) \
+    XaceHookSelectionAccessInline(ptr, ppSel, access_mode)
 
 /* Register a callback for a given hook.
  */
@@ -110,16 +292,38 @@ extern _X_EXPORT void XaceCensorImage(ClientPtr client,
 #ifdef __GNUC__
 #define XaceHook(args...) Success
 #define XaceHookDispatch(args...) Success
+#define XaceHookAuditEnd(args...) { ; }
+#define XaceHookResourceAccess(args...) Success
+#define XaceHookDeviceAccess(args...) Success
 #define XaceHookPropertyAccess(args...) Success
+#define XaceHookSendAccess(args...) Success
+#define XaceHookReceiveAccess(args...) Success
+#define XaceHookClientAccess(args...) Success
+#define XaceHookExtAccess(args...) Success
+#define XaceHookServerAccess(args...) Success
 #define XaceHookSelectionAccess(args...) Success
-#define XaceHookAuditEnd(args...) { ; }
+#define XaceHookScreenAccess(args...) Success
+#define XaceHookScreensaverAccess(args...) Success
+#define XaceHookAuthAvail(args...) { ; }
+#define XaceHookKeyAvail(args...) { ; }
 #define XaceCensorImage(args...) { ; }
 #else
 #define XaceHook(...) Success
 #define XaceHookDispatch(...) Success
+#define XaceHookAuditEnd(...) { ; }
+#define XaceHookResourceAccess(...) Success
+#define XaceHookDeviceAccess(...) Success
 #define XaceHookPropertyAccess(...) Success
+#define XaceHookSendAccess(...) Success
+#define XaceHookReceiveAccess(...) Success
+#define XaceHookClientAccess(...) Success
+#define XaceHookExtAccess(...) Success
+#define XaceHookServerAccess(...) Success
 #define XaceHookSelectionAccess(...) Success
-#define XaceHookAuditEnd(...) { ; }
+#define XaceHookScreenAccess(...) Success
+#define XaceHookScreensaverAccess(...) Success
+#define XaceHookAuthAvail(...) { ; }
+#define XaceHookKeyAvail(...) { ; }
 #define XaceCensorImage(...) { ; }
 #endif
 
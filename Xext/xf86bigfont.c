@@ -428,8 +428,10 @@ ProcXF86BigfontQueryFont(ClientPtr client)
                         chars[i++] = row;
                         chars[i++] = col;
                     }
+                    LockFontLibrary();
                     (*pFont->get_metrics) (pFont, ncols, chars, TwoD16Bit,
                                            &count, tmpCharInfos);
+                    UnlockFontLibrary();
                     for (i = 0; i < count && ninfos < nCharInfos; i++) {
                         *prCI++ = *tmpCharInfos[i];
                         ninfos++;
@@ -54,6 +54,8 @@
 #include "exevents.h"
 #include "eventstr.h"
 #include "inpututils.h"
+#include "protocol-versions.h"
+#include "xtestint.h"
 
 #include "extinit.h"
 
@@ -86,15 +88,20 @@ static int XTestSwapFakeInput(ClientPtr /* client */ ,
 static int
 ProcXTestGetVersion(ClientPtr client)
 {
+    REQUEST(xXTestGetVersionReq);
     xXTestGetVersionReply rep = {
         .type = X_Reply,
         .sequenceNumber = client->sequence,
         .length = 0,
-        .majorVersion = XTestMajorVersion,
+        .majorVersion = SERVER_XTEST_MAJOR_VERSION,
         .minorVersion = XTestMinorVersion
     };
 
     REQUEST_SIZE_MATCH(xXTestGetVersionReq);
+    /* only announce the batch request to clients that know about it */
+    if (stuff->majorVersion == SERVER_XTEST_MAJOR_VERSION &&
+        stuff->minorVersion >= SERVER_XTEST_MINOR_VERSION)
+        rep.minorVersion = SERVER_XTEST_MINOR_VERSION;
 
     if (client->swapped) {
         swaps(&rep.sequenceNumber);
@@ -433,6 +440,203 @@ ProcXTestFakeInput(ClientPtr client)
     return Success;
 }
 
+/**
+ * Check one event of a FakeInputBatch request against the XTest devices
+ * it will be injected through.
+ */
+static int
+XTestCheckBatchEvent(ClientPtr client, xXTestBatchEvent *ev,
+                     DeviceIntPtr ptr, DeviceIntPtr kbd, WindowPtr *root)
+{
+    int rc;
+
+    *root = NULL;
+
+    switch (ev->type) {
+    case 0:
+        return Success;
+    case KeyPress:
+    case KeyRelease:
+        if (!kbd)
+            return BadAccess;
+        if (!kbd->key)
+            return BadDevice;
+        if (ev->detail < kbd->key->xkbInfo->desc->min_key_code ||
+            ev->detail > kbd->key->xkbInfo->desc->max_key_code) {
+            client->errorValue = ev->detail;
+            return BadValue;
+        }
+        return Success;
+    case ButtonPress:
+    case ButtonRelease:
+        if (!ptr)
+            return BadAccess;
+        if (!ptr->button)
+            return BadDevice;
+        if (!ev->detail || ev->detail > ptr->button->numButtons) {
+            client->errorValue = ev->detail;
+            return BadValue;
+        }
+        return Success;
+    case MotionNotify:
+        if (!ptr)
+            return BadAccess;
+        if (!ptr->valuator)
+            return BadDevice;
+        if (ev->detail != xTrue && ev->detail != xFalse) {
+            client->errorValue = ev->detail;
+            return BadValue;
+        }
+        if (ev->root != None) {
+            rc = dixLookupWindow(root, ev->root, client, DixGetAttrAccess);
+            if (rc != Success)
+                return rc;
+            if ((*root)->parent) {
+                client->errorValue = ev->root;
+                return BadValue;
+            }
+        }
+        return Success;
+    default:
+        client->errorValue = ev->type;
+        return BadValue;
+    }
+}
+
+static void
+XTestSwapBatch(ClientPtr client)
+{
+    REQUEST(xXTestFakeInputBatchReq);
+    xXTestBatchEvent *ev = (xXTestBatchEvent *) &stuff[1];
+    int nev;
+
+    nev = ((client->req_len << 2) - sizeof(xXTestFakeInputBatchReq)) /
+        sizeof(xXTestBatchEvent);
+    for (; nev > 0; nev--, ev++) {
+        swapl(&ev->delay);
+        swapl(&ev->root);
+        swaps(&ev->rootX);
+        swaps(&ev->rootY);
+    }
+}
+
+static int
+ProcXTestFakeInputBatch(ClientPtr client)
+{
+    REQUEST(xXTestFakeInputBatchReq);
+    xXTestBatchEvent *events, *ev;
+    DeviceIntPtr ptr, kbd;
+    WindowPtr root;
+    ValuatorMask mask;
+    int valuators[2];
+    int nev, n, i, nevents, flags, rc;
+    Bool moved = FALSE;
+
+    REQUEST_AT_LEAST_SIZE(xXTestFakeInputBatchReq);
+    nev = (client->req_len << 2) - sizeof(xXTestFakeInputBatchReq);
+    if (nev % sizeof(xXTestBatchEvent))
+        return BadLength;
+    nev /= sizeof(xXTestBatchEvent);
+    events = (xXTestBatchEvent *) &stuff[1];
+
+    /* Technically the protocol doesn't allow for BadAccess here but
+     * this can only happen when all MDs are disabled.  */
+    ptr = PickPointer(client);
+    kbd = PickKeyboard(client);
+    if (ptr)
+        ptr = GetXTestDevice(ptr);
+    if (kbd)
+        kbd = GetXTestDevice(kbd);
+
+    for (n = 0; n < nev; n++) {
+        rc = XTestCheckBatchEvent(client, &events[n], ptr, kbd, &root);
+        if (rc != Success)
+            return rc;
+    }
+
+    UpdateCurrentTime();
+    if (screenIsSaved == SCREEN_SAVER_ON)
+        dixSaveScreens(serverClient, SCREEN_SAVER_OFF, ScreenSaverReset);
+
+    for (n = 0; n < nev; n++) {
+        ev = &events[n];
+        if (ev->type == 0)
+            continue;
+
+        /* If the event has a delay, sleep and come back for the rest */
+        if (ev->delay) {
+            TimeStamp activateTime;
+            CARD32 ms;
+
+            activateTime = currentTime;
+            ms = activateTime.milliseconds + ev->delay;
+            if (ms < activateTime.milliseconds)
+                activateTime.months++;
+            activateTime.milliseconds = ms;
+            ev->delay = 0;
+
+            if (moved)
+                miPointerUpdateSprite(ptr);
+            if (!ClientSleepUntil(client, &activateTime, NULL, NULL))
+                return BadAlloc;
+            /* swap the request back so we can simply re-execute it */
+            if (client->swapped) {
+                XTestSwapBatch(client);
+                swaps(&stuff->length);
+            }
+            ResetCurrentRequest(client);
+            client->sequence--;
+            return Success;
+        }
+
+        XTestCheckBatchEvent(client, ev, ptr, kbd, &root);
+        valuator_mask_zero(&mask);
+
+        switch (ev->type) {
+        case KeyPress:
+        case KeyRelease:
+            nevents = GetKeyboardEvents(xtest_evlist, kbd, ev->type,
+                                        ev->detail, NULL);
+            for (i = 0; i < nevents; i++)
+                mieqProcessDeviceEvent(kbd, &xtest_evlist[i],
+                                       miPointerGetScreen(inputInfo.pointer));
+            break;
+        case ButtonPress:
+        case ButtonRelease:
+        case MotionNotify:
+            flags = 0;
+            if (ev->type == MotionNotify) {
+                valuators[0] = ev->rootX;
+                valuators[1] = ev->rootY;
+                if (ev->detail == xFalse) {
+                    flags = POINTER_ABSOLUTE | POINTER_DESKTOP;
+                    if (root) {
+                        valuators[0] += root->drawable.pScreen->x;
+                        valuators[1] += root->drawable.pScreen->y;
+                    }
+                }
+                valuator_mask_set_range(&mask, 0, 2, valuators);
+            }
+            nevents = GetPointerEvents(xtest_evlist, ptr, ev->type,
+                                       ev->type == MotionNotify ?
+                                       0 : ev->detail, flags, &mask);
+            for (i = 0; i < nevents; i++)
+                mieqProcessDeviceEvent(ptr, &xtest_evlist[i],
+                                       miPointerGetScreen(inputInfo.pointer));
+            moved = TRUE;
+            break;
+        }
+
+        /* done with this one, should we have to come back */
+        ev->type = 0;
+    }
+
+    /* the sprite only needs to catch up once for the whole batch */
+    if (moved)
+        miPointerUpdateSprite(ptr);
+    return Success;
+}
+
 static int
 ProcXTestGrabControl(ClientPtr client)
 {
@@ -463,6 +667,8 @@ ProcXTestDispatch(ClientPtr client)
         return ProcXTestFakeInput(client);
     case X_XTestGrabControl:
         return ProcXTestGrabControl(client);
+    case X_XTestFakeInputBatch:
+        return ProcXTestFakeInputBatch(client);
     default:
         return BadRequest;
     }
@@ -528,6 +734,17 @@ SProcXTestFakeInput(ClientPtr client)
     return ProcXTestFakeInput(client);
 }
 
+static int
+SProcXTestFakeInputBatch(ClientPtr client)
+{
+    REQUEST(xXTestFakeInputBatchReq);
+
+    swaps(&stuff->length);
+    REQUEST_AT_LEAST_SIZE(xXTestFakeInputBatchReq);
+    XTestSwapBatch(client);
+    return ProcXTestFakeInputBatch(client);
+}
+
 static int
 SProcXTestGrabControl(ClientPtr client)
 {
@@ -551,6 +768,8 @@ SProcXTestDispatch(ClientPtr client)
         return SProcXTestFakeInput(client);
     case X_XTestGrabControl:
         return SProcXTestGrabControl(client);
+    case X_XTestFakeInputBatch:
+        return SProcXTestFakeInputBatch(client);
     default:
         return BadRequest;
     }
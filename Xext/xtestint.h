@@ -0,0 +1,58 @@
+/*
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _XTESTINT_H_
+#define _XTESTINT_H_
+
+#include <X11/Xmd.h>
+
+/*
+ * XTestFakeInputBatch (version 2.3) injects an array of core key, button
+ * and motion events with a single request.  It isn't in xtestproto yet,
+ * so its wire format is defined here.
+ *
+ * The whole batch is validated before any event is injected.  Each event's
+ * delay is in milliseconds after the previous one, like FakeInput's time
+ * field: the client is put to sleep and the request re-executed, with the
+ * events already injected turned into type 0 entries, which are skipped.
+ */
+#define X_XTestFakeInputBatch	4
+
+typedef struct {
+    CARD8 reqType;
+    CARD8 xtReqType;
+    CARD16 length;
+} xXTestFakeInputBatchReq;
+
+#define sz_xXTestFakeInputBatchReq 4
+
+typedef struct {
+    CARD8 type;                 /* KeyPress to MotionNotify, or 0 to skip */
+    CARD8 detail;               /* keycode, button or relative motion flag */
+    CARD16 pad;
+    CARD32 delay;               /* ms after the previous event */
+    CARD32 root;                /* MotionNotify: root window or None */
+    INT16 rootX, rootY;         /* MotionNotify */
+} xXTestBatchEvent;
+
+#define sz_xXTestBatchEvent 16
+
+#endif                          /* _XTESTINT_H_ */
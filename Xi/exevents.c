@@ -1016,17 +1016,19 @@ DeliverOneTouchEvent(ClientPtr client, DeviceIntPtr dev, TouchPointInfoPtr ti,
         return TRUE;
 
     /* If we fail here, we're going to leave a client hanging. */
-    err = EventToXI2(ev, &xi2);
+    err = EventToXI2Arena(ev, &xi2, &dev->convertArena);
     if (err != Success)
         FatalError("[Xi] %s: XI2 conversion failed in %s"
                    " (%d)\n", dev->name, __func__, err);
 
     FixUpEventFromWindow(&ti->sprite, xi2, win, child, FALSE);
     filter = GetEventFilter(dev, xi2);
-    if (XaceHook(XACE_RECEIVE_ACCESS, client, win, xi2, 1) != Success)
+    if (XaceHookReceiveAccess(client, win, xi2, 1) != Success) {
+        FreeConvertedEvent(&dev->convertArena, xi2);
         return FALSE;
+    }
     err = TryClientEvents(client, dev, xi2, 1, filter, filter, NullGrab);
-    free(xi2);
+    FreeConvertedEvent(&dev->convertArena, xi2);
 
     /* Returning the value from TryClientEvents isn't useful, since all our
      * resource-gone cleanups will update the delivery list anyway. */
@@ -1642,7 +1644,7 @@ ProcessBarrierEvent(InternalEvent *e, DeviceIntPtr dev)
     if (grab)
         be->flags |= XIBarrierDeviceIsGrabbed;
 
-    rc = EventToXI2(e, &ev);
+    rc = EventToXI2Arena(e, &ev, &dev->convertArena);
     if (rc != Success) {
         ErrorF("[Xi] event conversion from %s failed with code %d\n", __func__, rc);
         return;
@@ -1663,7 +1665,7 @@ ProcessBarrierEvent(InternalEvent *e, DeviceIntPtr dev)
         DeliverEventsToWindow(dev, pWin, ev, 1,
                               filter, NullGrab);
     }
-    free(ev);
+    FreeConvertedEvent(&dev->convertArena, ev);
 }
 
 /**
@@ -2246,7 +2248,7 @@ GrabButton(ClientPtr client, DeviceIntPtr dev, DeviceIntPtr modifier_device,
     if (param->this_device_mode == GrabModeSync ||
         param->other_devices_mode == GrabModeSync)
         access_mode |= DixFreezeAccess;
-    rc = XaceHook(XACE_DEVICE_ACCESS, client, dev, access_mode);
+    rc = XaceHookDeviceAccess(client, dev, access_mode);
     if (rc != Success)
         return rc;
     rc = dixLookupWindow(&pWin, param->grabWindow, client, DixSetAttrAccess);
@@ -2302,7 +2304,7 @@ GrabKey(ClientPtr client, DeviceIntPtr dev, DeviceIntPtr modifier_device,
     if (param->this_device_mode == GrabModeSync ||
         param->other_devices_mode == GrabModeSync)
         access_mode |= DixFreezeAccess;
-    rc = XaceHook(XACE_DEVICE_ACCESS, client, dev, access_mode);
+    rc = XaceHookDeviceAccess(client, dev, access_mode);
     if (rc != Success)
         return rc;
 
@@ -2345,7 +2347,7 @@ GrabWindow(ClientPtr client, DeviceIntPtr dev, int type,
     if (param->this_device_mode == GrabModeSync ||
         param->other_devices_mode == GrabModeSync)
         access_mode |= DixFreezeAccess;
-    rc = XaceHook(XACE_DEVICE_ACCESS, client, dev, access_mode);
+    rc = XaceHookDeviceAccess(client, dev, access_mode);
     if (rc != Success)
         return rc;
 
@@ -2376,7 +2378,7 @@ GrabTouch(ClientPtr client, DeviceIntPtr dev, DeviceIntPtr mod_dev,
     rc = dixLookupWindow(&pWin, param->grabWindow, client, DixSetAttrAccess);
     if (rc != Success)
         return rc;
-    rc = XaceHook(XACE_DEVICE_ACCESS, client, dev, DixGrabAccess);
+    rc = XaceHookDeviceAccess(client, dev, DixGrabAccess);
     if (rc != Success)
         return rc;
 
@@ -2539,6 +2541,7 @@ RecalculateDeviceDeliverableEvents(WindowPtr pWin)
                              & ~inputMasks->dontPropagateMask[i] &
                              PropagateMask[i]);
         }
+        RecalculateInputInterest(pChild);
         if (pChild->firstChild) {
             pChild = pChild->firstChild;
             continue;
@@ -2619,6 +2622,7 @@ WindowGone(WindowPtr win)
             for (j = 0; j < sprite->spriteTraceGood; j++) {
                 if (sprite->spriteTrace[j] == win) {
                     sprite->spriteTraceGood = j;
+                    sprite->hitStamp = 0;
                     break;
                 }
             }
@@ -2683,7 +2687,7 @@ SendEvent(ClientPtr client, DeviceIntPtr d, Window dest, Bool propagate,
                 break;
         }
     }
-    else if (!XaceHook(XACE_SEND_ACCESS, client, NULL, pWin, ev, count))
+    else if (!XaceHookSendAccess(client, NULL, pWin, ev, count))
         DeliverEventsToWindow(d, pWin, ev, count, mask, NullGrab);
     return Success;
 }
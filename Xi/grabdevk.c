@@ -123,7 +123,7 @@ ProcXGrabDeviceKey(ClientPtr client)
     }
     else {
         mdev = PickKeyboard(client);
-        ret = XaceHook(XACE_DEVICE_ACCESS, client, mdev, DixUseAccess);
+        ret = XaceHookDeviceAccess(client, mdev, DixUseAccess);
         if (ret != Success)
             return ret;
     }
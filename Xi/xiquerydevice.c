@@ -174,7 +174,7 @@ ShouldSkipDevice(ClientPtr client, int deviceid, DeviceIntPtr dev)
 {
     /* if all devices are not being queried, only master devices are */
     if (deviceid == XIAllDevices || IsMaster(dev)) {
-        int rc = XaceHook(XACE_DEVICE_ACCESS, client, dev, DixGetAttrAccess);
+        int rc = XaceHookDeviceAccess(client, dev, DixGetAttrAccess);
 
         if (rc == Success)
             return FALSE;
@@ -511,7 +511,7 @@ ListDeviceClasses(ClientPtr client, DeviceIntPtr dev,
     int rc;
 
     /* Check if the current device state should be suppressed */
-    rc = XaceHook(XACE_DEVICE_ACCESS, client, dev, DixReadAccess);
+    rc = XaceHookDeviceAccess(client, dev, DixReadAccess);
 
     if (dev->button) {
         (*nclasses)++;
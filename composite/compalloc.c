@@ -47,11 +47,53 @@
 
 #include "compint.h"
 
+/*
+ * Paint every automatically redirected window which reported damage
+ * since the last update.  Only those windows are visited, instead of
+ * walking the whole tree looking for them.
+ */
 static void
 compScreenUpdate(ScreenPtr pScreen)
 {
+    CompScreenPtr cs = GetCompScreen(pScreen);
+    CompUpdateStatsPtr stats = &cs->updateStats;
+    CompWindowPtr cw, next;
+    WindowPtr pWin;
+    unsigned long painted = stats->windows;
+
     compCheckTree(pScreen);
-    compPaintChildrenToWindow(pScreen->root);
+
+    /*
+     * compPaintWindowToParent paints any damaged descendants first, so
+     * nested redirection is still drawn bottom up.  Painting a window
+     * damages its parent, which may append the parent to the list
+     * while we walk it; the walk picks those up as well.
+     */
+    xorg_list_for_each_entry(cw, &cs->damagedWindows, damagedEntry) {
+        if (cw->damaged && cw->pWin->redirectDraw != RedirectDrawNone)
+            compPaintWindowToParent(cw->pWin);
+    }
+
+    /*
+     * Everything is clean now, clear the ancestor marks which
+     * compReportDamage left for compPaintChildrenToWindow
+     */
+    xorg_list_for_each_entry_safe(cw, next, &cs->damagedWindows, damagedEntry) {
+        xorg_list_del(&cw->damagedEntry);
+        for (pWin = cw->pWin->parent; pWin && pWin->damagedDescendants;
+             pWin = pWin->parent)
+            pWin->damagedDescendants = FALSE;
+    }
+
+    painted = stats->windows - painted;
+    stats->frames++;
+    stats->lastWindows = painted;
+    if (painted > stats->maxWindows)
+        stats->maxWindows = painted;
+#ifdef COMPOSITE_DEBUG
+    ErrorF("composite: update %lu painted %lu windows (max %lu)\n",
+           stats->frames, painted, stats->maxWindows);
+#endif
 }
 
 static void
@@ -79,16 +121,17 @@ compReportDamage(DamagePtr pDamage, RegionPtr pRegion, void *closure)
         cs->BlockHandler = pScreen->BlockHandler;
         pScreen->BlockHandler = compBlockHandler;
     }
+    if (xorg_list_is_empty(&cw->damagedEntry))
+        xorg_list_append(&cw->damagedEntry, &cs->damagedWindows);
     cw->damaged = TRUE;
 
-    /* Mark the ancestors */
-    pWin = pWin->parent;
-    while (pWin) {
-        if (pWin->damagedDescendants)
-            break;
+    /*
+     * Mark the ancestors so that compPaintChildrenToWindow can find
+     * this window.  Don't stop at an already marked ancestor; a mark
+     * may be stale after a reparent while its parent's isn't set.
+     */
+    for (pWin = pWin->parent; pWin; pWin = pWin->parent)
         pWin->damagedDescendants = TRUE;
-        pWin = pWin->parent;
-    }
 }
 
 static void
@@ -183,6 +226,7 @@ compRedirectWindow(ClientPtr pClient, WindowPtr pWin, int update)
             free(cw);
             return BadAlloc;
         }
+        DamageSetBoxLimit(cw->damage, DAMAGE_BOX_LIMIT);
 
         anyMarked = compMarkWindows(pWin, &pLayerWin);
 
@@ -194,6 +238,8 @@ compRedirectWindow(ClientPtr pClient, WindowPtr pWin, int update)
         cw->damageRegistered = FALSE;
         cw->damaged = FALSE;
         cw->pOldPixmap = NullPixmap;
+        cw->pWin = pWin;
+        xorg_list_init(&cw->damagedEntry);
         dixSetPrivate(&pWin->devPrivates, CompWindowPrivateKey, cw);
     }
     ccw->next = cw->clients;
@@ -290,6 +336,7 @@ compFreeClientWindow(WindowPtr pWin, XID id)
             DamageDestroy(cw->damage);
 
         RegionUninit(&cw->borderClip);
+        xorg_list_del(&cw->damagedEntry);
 
         dixSetPrivate(&pWin->devPrivates, CompWindowPrivateKey, NULL);
         free(cw);
@@ -309,7 +356,7 @@ compFreeClientWindow(WindowPtr pWin, XID id)
 
     if (pPixmap) {
         compRestoreWindow(pWin, pPixmap);
-        (*pScreen->DestroyPixmap) (pPixmap);
+        compReleasePixmap(pScreen, pPixmap);
     }
 }
 
@@ -526,6 +573,191 @@ compUnredirectOneSubwindow(WindowPtr pParent, WindowPtr pWin)
     return Success;
 }
 
+#define compPixmapPoolGrain(n) \
+    (((unsigned int) (n) + COMP_PIXMAP_POOL_GRAIN - 1) / COMP_PIXMAP_POOL_GRAIN)
+
+static unsigned int
+compPixmapPoolBucket(int w, int h, int depth)
+{
+    return (compPixmapPoolGrain(w) * 31 + compPixmapPoolGrain(h) * 7 +
+            depth) % COMP_PIXMAP_POOL_BUCKETS;
+}
+
+/*
+ * Whether pPixmap can stand in for a w x h one: the same size, or a
+ * larger pixmap of the same grain in memory, whose header can be trimmed
+ * without touching storage a driver may have laid out for the larger size.
+ */
+static Bool
+compPixmapPoolFits(PixmapPtr pPixmap, int w, int h, int depth)
+{
+    int pw = pPixmap->drawable.width;
+    int ph = pPixmap->drawable.height;
+
+    if (pPixmap->drawable.depth != depth || pw < w || ph < h ||
+        compPixmapPoolGrain(pw) != compPixmapPoolGrain(w) ||
+        compPixmapPoolGrain(ph) != compPixmapPoolGrain(h))
+        return FALSE;
+    if (pw == w && ph == h)
+        return TRUE;
+    return pPixmap->devPrivate.ptr != NULL && pPixmap->devKind > 0;
+}
+
+static void
+compPixmapPoolRemove(CompPixmapPoolPtr pool, CompPooledPixmapPtr pp)
+{
+    xorg_list_del(&pp->bucketEntry);
+    xorg_list_del(&pp->lruEntry);
+    pool->size -= pp->size;
+}
+
+static void
+compPixmapPoolEvict(ScreenPtr pScreen, CompPooledPixmapPtr pp)
+{
+    CompScreenPtr cs = GetCompScreen(pScreen);
+
+    compPixmapPoolRemove(&cs->pixmapPool, pp);
+    (*pScreen->DestroyPixmap) (pp->pPixmap);
+    free(pp);
+}
+
+static CARD32
+compPixmapPoolExpire(OsTimerPtr timer, CARD32 now, void *arg)
+{
+    ScreenPtr pScreen = arg;
+    CompPixmapPoolPtr pool = &GetCompScreen(pScreen)->pixmapPool;
+    CompPooledPixmapPtr pp, next;
+
+    xorg_list_for_each_entry_safe(pp, next, &pool->lru, lruEntry) {
+        if ((INT32) (now - pp->released) >= COMP_PIXMAP_POOL_MAX_AGE)
+            compPixmapPoolEvict(pScreen, pp);
+    }
+
+    if (xorg_list_is_empty(&pool->lru))
+        return 0;
+    return COMP_PIXMAP_POOL_MAX_AGE;
+}
+
+void
+compInitPixmapPool(ScreenPtr pScreen)
+{
+    CompPixmapPoolPtr pool = &GetCompScreen(pScreen)->pixmapPool;
+    int i;
+
+    for (i = 0; i < COMP_PIXMAP_POOL_BUCKETS; i++)
+        xorg_list_init(&pool->buckets[i]);
+    xorg_list_init(&pool->lru);
+    pool->size = 0;
+    pool->hits = 0;
+    pool->misses = 0;
+    pool->timer = NULL;
+}
+
+/*
+ * Hand a backing pixmap which is no longer used by its window to the
+ * pool.  Pixmaps still referenced elsewhere (NameWindowPixmap) or too
+ * large for the pool are simply destroyed.
+ */
+void
+compReleasePixmap(ScreenPtr pScreen, PixmapPtr pPixmap)
+{
+    CompPixmapPoolPtr pool = &GetCompScreen(pScreen)->pixmapPool;
+    CompPooledPixmapPtr pp, oldest;
+    unsigned long size;
+
+    size = (unsigned long) pPixmap->drawable.height *
+        (pPixmap->devKind > 0 ? pPixmap->devKind :
+         PixmapBytePad(pPixmap->drawable.width, pPixmap->drawable.depth));
+
+    if (pPixmap->refcnt != 1 || size > COMP_PIXMAP_POOL_MAX_BYTES ||
+        !(pp = malloc(sizeof(CompPooledPixmapRec)))) {
+        (*pScreen->DestroyPixmap) (pPixmap);
+        return;
+    }
+
+    /* Make room by dropping the least recently released pixmaps */
+    while (pool->size + size > COMP_PIXMAP_POOL_MAX_BYTES) {
+        oldest = xorg_list_last_entry(&pool->lru, CompPooledPixmapRec,
+                                      lruEntry);
+        compPixmapPoolEvict(pScreen, oldest);
+    }
+
+    /* The expiry timer keeps itself armed while the pool is not empty */
+    if (xorg_list_is_empty(&pool->lru))
+        pool->timer = TimerSet(pool->timer, 0, COMP_PIXMAP_POOL_MAX_AGE,
+                               compPixmapPoolExpire, pScreen);
+
+    pp->pPixmap = pPixmap;
+    pp->size = size;
+    pp->released = GetTimeInMillis();
+    xorg_list_add(&pp->bucketEntry,
+                  &pool->buckets[compPixmapPoolBucket(pPixmap->drawable.width,
+                                                      pPixmap->drawable.height,
+                                                      pPixmap->drawable.
+                                                      depth)]);
+    xorg_list_add(&pp->lruEntry, &pool->lru);
+    pool->size += size;
+}
+
+static PixmapPtr
+compPixmapPoolGet(ScreenPtr pScreen, int w, int h, int depth)
+{
+    CompPixmapPoolPtr pool = &GetCompScreen(pScreen)->pixmapPool;
+    CompPooledPixmapPtr pp, best = NULL;
+    PixmapPtr pPixmap;
+
+    /* prefer an exact match, then the smallest that fits */
+    xorg_list_for_each_entry(pp,
+                             &pool->buckets[compPixmapPoolBucket(w, h, depth)],
+                             bucketEntry) {
+        if (!compPixmapPoolFits(pp->pPixmap, w, h, depth))
+            continue;
+        if (!best || pp->size < best->size)
+            best = pp;
+        if (pp->pPixmap->drawable.width == w &&
+            pp->pPixmap->drawable.height == h)
+            break;
+    }
+
+    if (best) {
+        pPixmap = best->pPixmap;
+        if ((pPixmap->drawable.width != w || pPixmap->drawable.height != h) &&
+            !(*pScreen->ModifyPixmapHeader) (pPixmap, w, h, 0, 0, 0, NULL))
+            best = NULL;
+    }
+    if (!best) {
+        pool->misses++;
+#ifdef COMPOSITE_DEBUG
+        ErrorF("composite: pixmap pool miss %dx%d (hits %lu misses %lu)\n",
+               w, h, pool->hits, pool->misses);
+#endif
+        return NullPixmap;
+    }
+
+    compPixmapPoolRemove(pool, best);
+    free(best);
+    /* Make sure cached GC validation doesn't see the old use */
+    pPixmap->drawable.serialNumber = NEXT_SERIAL_NUMBER;
+    pool->hits++;
+#ifdef COMPOSITE_DEBUG
+    ErrorF("composite: pixmap pool hit %dx%d (hits %lu misses %lu)\n",
+           w, h, pool->hits, pool->misses);
+#endif
+    return pPixmap;
+}
+
+void
+compFlushPixmapPool(ScreenPtr pScreen)
+{
+    CompPixmapPoolPtr pool = &GetCompScreen(pScreen)->pixmapPool;
+    CompPooledPixmapPtr pp, next;
+
+    xorg_list_for_each_entry_safe(pp, next, &pool->lru, lruEntry)
+        compPixmapPoolEvict(pScreen, pp);
+    TimerFree(pool->timer);
+    pool->timer = NULL;
+}
+
 static PixmapPtr
 compNewPixmap(WindowPtr pWin, int x, int y, int w, int h)
 {
@@ -533,8 +765,11 @@ compNewPixmap(WindowPtr pWin, int x, int y, int w, int h)
     WindowPtr pParent = pWin->parent;
     PixmapPtr pPixmap;
 
-    pPixmap = (*pScreen->CreatePixmap) (pScreen, w, h, pWin->drawable.depth,
-                                        CREATE_PIXMAP_USAGE_BACKING_PIXMAP);
+    pPixmap = compPixmapPoolGet(pScreen, w, h, pWin->drawable.depth);
+    if (!pPixmap)
+        pPixmap = (*pScreen->CreatePixmap) (pScreen, w, h,
+                                            pWin->drawable.depth,
+                                            CREATE_PIXMAP_USAGE_BACKING_PIXMAP);
 
     if (!pPixmap)
         return 0;
@@ -642,6 +877,8 @@ compSetParentPixmap(WindowPtr pWin)
         cw->damageRegistered = FALSE;
         DamageEmpty(cw->damage);
     }
+    cw->damaged = FALSE;
+    xorg_list_del(&cw->damagedEntry);
     /*
      * Move the parent-constrained border clip region back into
      * the window so that ValidateTree will handle the unmap
@@ -260,8 +260,8 @@ ProcCompositeNameWindowPixmap(ClientPtr client)
         return BadMatch;
 
     /* security creation/labeling check */
-    rc = XaceHook(XACE_RESOURCE_ACCESS, client, stuff->pixmap, RT_PIXMAP,
-                  pPixmap, RT_WINDOW, pWin, DixCreateAccess);
+    rc = XaceHookResourceAccess(client, stuff->pixmap, RT_PIXMAP,
+                                pPixmap, RT_WINDOW, pWin, DixCreateAccess);
     if (rc != Success)
         return rc;
 
@@ -306,8 +306,9 @@ ProcCompositeGetOverlayWindow(ClientPtr client)
             return BadAlloc;
         }
 
-    rc = XaceHook(XACE_RESOURCE_ACCESS, client, cs->pOverlayWin->drawable.id,
-                  RT_WINDOW, cs->pOverlayWin, RT_NONE, NULL, DixGetAttrAccess);
+    rc = XaceHookResourceAccess(client, cs->pOverlayWin->drawable.id,
+                                RT_WINDOW, cs->pOverlayWin, RT_NONE, NULL,
+                                DixGetAttrAccess);
     if (rc != Success) {
         FreeResource(pOc->resource, RT_NONE);
         return rc;
@@ -827,10 +828,10 @@ PanoramiXCompositeGetOverlayWindow(ClientPtr client)
                 return BadAlloc;
             }
 
-        rc = XaceHook(XACE_RESOURCE_ACCESS, client,
-                      cs->pOverlayWin->drawable.id,
-                      RT_WINDOW, cs->pOverlayWin, RT_NONE, NULL,
-                      DixGetAttrAccess);
+        rc = XaceHookResourceAccess(client,
+                                    cs->pOverlayWin->drawable.id,
+                                    RT_WINDOW, cs->pOverlayWin, RT_NONE, NULL,
+                                    DixGetAttrAccess);
         if (rc != Success) {
             FreeResource(pOc->resource, RT_NONE);
             free(overlayWin);
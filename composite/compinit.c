@@ -58,6 +58,7 @@ compCloseScreen(ScreenPtr pScreen)
     CompScreenPtr cs = GetCompScreen(pScreen);
     Bool ret;
 
+    compFlushPixmapPool(pScreen);
     free(cs->alternateVisuals);
 
     pScreen->CloseScreen = cs->CloseScreen;
@@ -402,6 +403,9 @@ compScreenInit(ScreenPtr pScreen)
 
     cs->BlockHandler = NULL;
 
+    xorg_list_init(&cs->damagedWindows);
+    memset(&cs->updateStats, 0, sizeof(cs->updateStats));
+
     cs->CloseScreen = pScreen->CloseScreen;
     pScreen->CloseScreen = compCloseScreen;
 
@@ -413,6 +417,8 @@ compScreenInit(ScreenPtr pScreen)
 
     dixSetPrivate(&pScreen->devPrivates, CompScreenPrivateKey, cs);
 
+    compInitPixmapPool(pScreen);
+
     RegisterRealChildHeadProc(CompositeRealChildHead);
 
     return TRUE;
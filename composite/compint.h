@@ -72,6 +72,7 @@
 #include "xfixes.h"
 #include <X11/extensions/compositeproto.h>
 #include "compositeext.h"
+#include "list.h"
 #include <assert.h>
 
 /*
@@ -97,6 +98,8 @@ typedef struct _CompWindow {
     int oldy;
     PixmapPtr pOldPixmap;
     int borderClipX, borderClipY;
+    WindowPtr pWin;
+    struct xorg_list damagedEntry;      /* on CompScreenRec.damagedWindows */
 } CompWindowRec, *CompWindowPtr;
 
 #define COMP_ORIGIN_INVALID	    0x80000000
@@ -110,6 +113,47 @@ typedef struct _CompSubwindows {
 #define COMP_INCLUDE_RGB24_VISUAL 0
 #endif
 
+/*
+ * Backing pixmaps released by unmap, resize or unredirect are kept in a
+ * per-screen pool for a while so that the next window of a similar size
+ * can reuse them instead of allocating a new one.  Sizes are rounded up
+ * to COMP_PIXMAP_POOL_GRAIN pixels to pick a bucket.  A pixmap in memory
+ * may be handed out for a smaller window of the same bucket, trimmed to
+ * its size.
+ */
+#ifndef COMP_PIXMAP_POOL_BUCKETS
+#define COMP_PIXMAP_POOL_BUCKETS    64
+#endif
+
+#ifndef COMP_PIXMAP_POOL_GRAIN
+#define COMP_PIXMAP_POOL_GRAIN      64
+#endif
+
+#ifndef COMP_PIXMAP_POOL_MAX_BYTES
+#define COMP_PIXMAP_POOL_MAX_BYTES  (32 * 1024 * 1024)
+#endif
+
+#ifndef COMP_PIXMAP_POOL_MAX_AGE
+#define COMP_PIXMAP_POOL_MAX_AGE    2000    /* milliseconds */
+#endif
+
+typedef struct _CompPooledPixmap {
+    struct xorg_list bucketEntry;
+    struct xorg_list lruEntry;
+    PixmapPtr pPixmap;
+    unsigned long size;
+    CARD32 released;
+} CompPooledPixmapRec, *CompPooledPixmapPtr;
+
+typedef struct _CompPixmapPool {
+    struct xorg_list buckets[COMP_PIXMAP_POOL_BUCKETS];
+    struct xorg_list lru;       /* most recently released first */
+    unsigned long size;         /* bytes held by the pool */
+    unsigned long hits;
+    unsigned long misses;
+    OsTimerPtr timer;
+} CompPixmapPoolRec, *CompPixmapPoolPtr;
+
 typedef struct _CompOverlayClientRec *CompOverlayClientPtr;
 
 typedef struct _CompOverlayClientRec {
@@ -119,6 +163,13 @@ typedef struct _CompOverlayClientRec {
     XID resource;
 } CompOverlayClientRec;
 
+typedef struct _CompUpdateStats {
+    unsigned long frames;       /* block handler updates */
+    unsigned long windows;      /* automatic windows painted in total */
+    unsigned long lastWindows;  /* windows painted in the last update */
+    unsigned long maxWindows;   /* most windows painted in one update */
+} CompUpdateStatsRec, *CompUpdateStatsPtr;
+
 typedef struct _CompScreen {
     PositionWindowProcPtr PositionWindow;
     CopyWindowProcPtr CopyWindow;
@@ -162,6 +213,15 @@ typedef struct _CompScreen {
 
     GetImageProcPtr GetImage;
     SourceValidateProcPtr SourceValidate;
+
+    /*
+     * Automatically redirected windows which have reported damage
+     * since the last update
+     */
+    struct xorg_list damagedWindows;
+    CompUpdateStatsRec updateStats;
+
+    CompPixmapPoolRec pixmapPool;
 } CompScreenRec, *CompScreenPtr;
 
 extern DevPrivateKeyRec CompScreenPrivateKeyRec;
@@ -228,6 +288,15 @@ Bool
 compReallocPixmap(WindowPtr pWin, int x, int y,
                   unsigned int w, unsigned int h, int bw);
 
+void
+ compInitPixmapPool(ScreenPtr pScreen);
+
+void
+ compReleasePixmap(ScreenPtr pScreen, PixmapPtr pPixmap);
+
+void
+ compFlushPixmapPool(ScreenPtr pScreen);
+
 /*
  * compinit.c
  */
@@ -312,6 +381,9 @@ RegionPtr
 void
  compCopyWindow(WindowPtr pWin, DDXPointRec ptOldOrg, RegionPtr prgnSrc);
 
+void
+ compPaintWindowToParent(WindowPtr pWin);
+
 void
  compPaintChildrenToWindow(WindowPtr pWin);
 
@@ -169,7 +169,7 @@ compCheckRedirect(WindowPtr pWin)
 
             compSetParentPixmap(pWin);
             compRestoreWindow(pWin, pPixmap);
-            (*pScreen->DestroyPixmap) (pPixmap);
+            compReleasePixmap(pScreen, pPixmap);
         }
     }
     else if (should) {
@@ -360,7 +360,7 @@ compFreeOldPixmap(WindowPtr pWin)
         CompWindowPtr cw = GetCompWindow(pWin);
 
         if (cw->pOldPixmap) {
-            (*pScreen->DestroyPixmap) (cw->pOldPixmap);
+            compReleasePixmap(pScreen, cw->pOldPixmap);
             cw->pOldPixmap = NullPixmap;
         }
     }
@@ -584,7 +584,7 @@ compDestroyWindow(WindowPtr pWin)
         PixmapPtr pPixmap = (*pScreen->GetWindowPixmap) (pWin);
 
         compSetParentPixmap(pWin);
-        (*pScreen->DestroyPixmap) (pPixmap);
+        compReleasePixmap(pScreen, pPixmap);
     }
     ret = (*pScreen->DestroyWindow) (pWin);
     cs->DestroyWindow = pScreen->DestroyWindow;
@@ -636,6 +636,7 @@ compWindowUpdateAutomatic(WindowPtr pWin)
 {
     CompWindowPtr cw = GetCompWindow(pWin);
     ScreenPtr pScreen = pWin->drawable.pScreen;
+    CompScreenPtr cs = GetCompScreen(pScreen);
     WindowPtr pParent = pWin->parent;
     PixmapPtr pSrcPixmap = (*pScreen->GetWindowPixmap) (pWin);
     PictFormatPtr pSrcFormat = PictureWindowFormat(pWin);
@@ -691,9 +692,11 @@ compWindowUpdateAutomatic(WindowPtr pWin)
      * rendering the translations above harmless
      */
     DamageEmpty(cw->damage);
+
+    cs->updateStats.windows++;
 }
 
-static void
+void
 compPaintWindowToParent(WindowPtr pWin)
 {
     compPaintChildrenToWindow(pWin);
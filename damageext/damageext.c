@@ -44,10 +44,23 @@ static int (*PanoramiXSaveDamageCreate) (ClientPtr);
 
 #endif
 
+/*
+ * Damage 1.2 report level: the damage accumulates as for DeltaRectangles,
+ * but each damage object sends at most one DamageNotify, covering the
+ * extents of everything damaged since the last one, each time the server
+ * is about to block and at most once every damageCoalesceInterval
+ * milliseconds.
+ */
+#define XDamageReportCoalesced	4
+
 static unsigned char DamageReqCode;
 static int DamageEventBase;
 static RESTYPE DamageExtType;
 
+static struct xorg_list DamageExtPending;
+static int DamageExtNumCoalesced;
+static OsTimerPtr DamageExtTimer;
+
 static DevPrivateKeyRec DamageClientPrivateKeyRec;
 
 #define DamageClientPrivateKey (&DamageClientPrivateKeyRec)
@@ -94,13 +107,15 @@ DamageExtNotify(DamageExtPtr pDamageExt, BoxPtr pBoxes, int nBoxes)
     DrawablePtr pDrawable = pDamageExt->pDrawable;
     xDamageNotifyEvent ev;
     int i, x, y, w, h;
+    int level = pDamageExt->coalesce ? XDamageReportCoalesced
+                                     : pDamageExt->level;
 
     damageGetGeometry(pDrawable, &x, &y, &w, &h);
 
     UpdateCurrentTimeIf();
     ev = (xDamageNotifyEvent) {
         .type = DamageEventBase + XDamageNotify,
-        .level = pDamageExt->level,
+        .level = level,
         .drawable = pDamageExt->drawable,
         .damage = pDamageExt->id,
         .timestamp = currentTime.milliseconds,
@@ -111,7 +126,7 @@ DamageExtNotify(DamageExtPtr pDamageExt, BoxPtr pBoxes, int nBoxes)
     };
     if (pBoxes) {
         for (i = 0; i < nBoxes; i++) {
-            ev.level = pDamageExt->level;
+            ev.level = level;
             if (i < nBoxes - 1)
                 ev.level |= DamageNotifyMore;
             ev.area.x = pBoxes[i].x1;
@@ -132,11 +147,117 @@ DamageExtNotify(DamageExtPtr pDamageExt, BoxPtr pBoxes, int nBoxes)
     DamageNoteCritical(pClient);
 }
 
+static void
+DamageExtSendPending(void);
+
+static CARD32
+DamageExtTimerNotify(OsTimerPtr timer, CARD32 now, void *arg)
+{
+    DamageExtSendPending();
+    return 0;
+}
+
+/*
+ * Sends the coalesced damage of every pending damage object whose
+ * interval has passed, and arms a timer for the rest.
+ */
+static void
+DamageExtSendPending(void)
+{
+    DamageExtPtr pDamageExt, tmp;
+    CARD32 now = GetTimeInMillis();
+    CARD32 wait, next = 0;
+
+    xorg_list_for_each_entry_safe(pDamageExt, tmp, &DamageExtPending,
+                                  pending_entry) {
+        if (damageCoalesceInterval > 0 &&
+            (wait = now - pDamageExt->last_notify) <
+            (CARD32) damageCoalesceInterval) {
+            wait = damageCoalesceInterval - wait;
+            if (!next || wait < next)
+                next = wait;
+            continue;
+        }
+
+        xorg_list_del(&pDamageExt->pending_entry);
+        pDamageExt->pending = FALSE;
+        pDamageExt->last_notify = now;
+        DamageExtNotify(pDamageExt, &pDamageExt->pending_box, 1);
+    }
+
+    if (next)
+        DamageExtTimer = TimerSet(DamageExtTimer, 0, next,
+                                  DamageExtTimerNotify, NULL);
+}
+
+/*
+ * Pending damage is sent from the block handler rather than a
+ * FlushCallback: flush callbacks also run from WriteToClient when a
+ * client's buffer fills, which may be in the middle of a reply.  Output
+ * written here is flushed by WaitForSomething right after.
+ */
+static void
+DamageExtBlockHandler(void *data, OSTimePtr pTimeout, void *pRead)
+{
+    if (!xorg_list_is_empty(&DamageExtPending))
+        DamageExtSendPending();
+}
+
+static Bool
+DamageExtStartCoalescing(void)
+{
+    if (DamageExtNumCoalesced == 0 &&
+        !RegisterBlockAndWakeupHandlers(DamageExtBlockHandler,
+                                        (WakeupHandlerProcPtr) NoopDDA, NULL))
+        return FALSE;
+    DamageExtNumCoalesced++;
+    return TRUE;
+}
+
+static void
+DamageExtStopCoalescing(DamageExtPtr pDamageExt)
+{
+    if (pDamageExt->pending)
+        xorg_list_del(&pDamageExt->pending_entry);
+    if (--DamageExtNumCoalesced == 0) {
+        RemoveBlockAndWakeupHandlers(DamageExtBlockHandler,
+                                     (WakeupHandlerProcPtr) NoopDDA, NULL);
+        TimerFree(DamageExtTimer);
+        DamageExtTimer = NULL;
+    }
+}
+
+static void
+DamageExtCoalesce(DamageExtPtr pDamageExt, RegionPtr pRegion)
+{
+    BoxPtr pExtents = RegionExtents(pRegion);
+
+    if (RegionNil(pRegion))
+        return;
+
+    if (!pDamageExt->pending) {
+        pDamageExt->pending = TRUE;
+        pDamageExt->pending_box = *pExtents;
+        xorg_list_append(&pDamageExt->pending_entry, &DamageExtPending);
+        return;
+    }
+
+    pDamageExt->pending_box.x1 = min(pDamageExt->pending_box.x1, pExtents->x1);
+    pDamageExt->pending_box.y1 = min(pDamageExt->pending_box.y1, pExtents->y1);
+    pDamageExt->pending_box.x2 = max(pDamageExt->pending_box.x2, pExtents->x2);
+    pDamageExt->pending_box.y2 = max(pDamageExt->pending_box.y2, pExtents->y2);
+}
+
 static void
 DamageExtReport(DamagePtr pDamage, RegionPtr pRegion, void *closure)
 {
     DamageExtPtr pDamageExt = closure;
 
+    if (pDamageExt->coalesce) {
+        DamageExtCoalesce(pDamageExt, pRegion);
+        return;
+    }
+
     switch (pDamageExt->level) {
     case DamageReportRawRegion:
     case DamageReportDeltaRegion:
@@ -226,7 +347,7 @@ DamageExtRegister(DrawablePtr pDrawable, DamagePtr pDamage, Bool report)
 }
 
 static DamageExtPtr
-DamageExtCreate(DrawablePtr pDrawable, DamageReportLevel level,
+DamageExtCreate(DrawablePtr pDrawable, DamageReportLevel level, Bool coalesce,
                 ClientPtr client, XID id, XID drawable)
 {
     DamageExtPtr pDamageExt = malloc(sizeof(DamageExtRec));
@@ -238,12 +359,25 @@ DamageExtCreate(DrawablePtr pDrawable, DamageReportLevel level,
     pDamageExt->pDrawable = pDrawable;
     pDamageExt->level = level;
     pDamageExt->pClient = client;
+    pDamageExt->coalesce = coalesce;
+    pDamageExt->pending = FALSE;
+    pDamageExt->last_notify = 0;
+    xorg_list_init(&pDamageExt->pending_entry);
     pDamageExt->pDamage = DamageCreate(DamageExtReport, DamageExtDestroy, level,
                                        FALSE, pDrawable->pScreen, pDamageExt);
     if (!pDamageExt->pDamage) {
         free(pDamageExt);
         return NULL;
     }
+    /* these clients fetch the region instead of being sent each box */
+    if (level == DamageReportBoundingBox || level == DamageReportNonEmpty ||
+        coalesce)
+        DamageSetBoxLimit(pDamageExt->pDamage, DAMAGE_BOX_LIMIT);
+    if (coalesce && !DamageExtStartCoalescing()) {
+        DamageDestroy(pDamageExt->pDamage);
+        free(pDamageExt);
+        return NULL;
+    }
 
     if (!AddResource(id, DamageExtType, (void *) pDamageExt))
         return NULL;
@@ -260,6 +394,7 @@ doDamageCreate(ClientPtr client, int *rc)
     DrawablePtr pDrawable;
     DamageExtPtr pDamageExt;
     DamageReportLevel level;
+    Bool coalesce = FALSE;
 
     REQUEST(xDamageCreateReq);
 
@@ -281,14 +416,22 @@ doDamageCreate(ClientPtr client, int *rc)
     case XDamageReportNonEmpty:
         level = DamageReportNonEmpty;
         break;
+    case XDamageReportCoalesced:
+        /* only for clients that asked for version 1.2 */
+        if (GetDamageClient(client)->minor_version >= 2) {
+            level = DamageReportDeltaRegion;
+            coalesce = TRUE;
+            break;
+        }
+        /* fall through */
     default:
         client->errorValue = stuff->level;
         *rc = BadValue;
         return NULL;
     }
 
-    pDamageExt = DamageExtCreate(pDrawable, level, client, stuff->damage,
-                                 stuff->drawable);
+    pDamageExt = DamageExtCreate(pDrawable, level, coalesce, client,
+                                 stuff->damage, stuff->drawable);
     if (!pDamageExt)
         *rc = BadAlloc;
 
@@ -598,6 +741,8 @@ FreeDamageExt(void *value, XID did)
     if (pDamageExt->pDamage) {
         DamageDestroy(pDamageExt->pDamage);
     }
+    if (pDamageExt->coalesce)
+        DamageExtStopCoalescing(pDamageExt);
     free(pDamageExt);
     return Success;
 }
@@ -753,6 +898,8 @@ DamageExtensionInit(void)
     if (!DamageExtType)
         return;
 
+    xorg_list_init(&DamageExtPending);
+
     if (!dixRegisterPrivateKey
         (&DamageClientPrivateKeyRec, PRIVATE_CLIENT, sizeof(DamageClientRec)))
         return;
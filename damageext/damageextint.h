@@ -39,6 +39,7 @@
 #include "scrnintstr.h"
 #include "damage.h"
 #include "xfixes.h"
+#include "list.h"
 
 typedef struct _DamageClient {
     CARD32 major_version;
@@ -55,6 +56,11 @@ typedef struct _DamageExt {
     ClientPtr pClient;
     XID id;
     XID drawable;
+    Bool coalesce;              /* XDamageReportCoalesced */
+    Bool pending;               /* damage not yet notified */
+    BoxRec pending_box;         /* extents of that damage */
+    CARD32 last_notify;
+    struct xorg_list pending_entry;
 } DamageExtRec, *DamageExtPtr;
 
 #define VERIFY_DAMAGEEXT(pDamageExt, rid, client, mode) { \
@@ -56,108 +56,234 @@ SOFTWARE.
 #include "resource.h"
 #include "dix.h"
 
-#define InitialTableSize 100
+#ifdef FONT_THREAD
+#include <pthread.h>
+#endif
+
+/*
+ * Atoms are interned through an open-addressed hash table of atom numbers.
+ * Their names are packed into large arena chunks instead of being
+ * allocated one by one, and stay put until the atoms are reset.
+ *
+ * NameForAtom and ValidAtom only look at the name table and lastAtom, so
+ * they may be called from a thread other than the one creating atoms: a
+ * new name is stored before lastAtom is advanced past it, and a grown name
+ * table is filled in before it is published.  Superseded name tables are
+ * kept until FreeAllAtoms so a reader holding one never sees it go away.
+ *
+ * There is only ever one writer at a time, though.  With FONT_THREAD,
+ * libXfont creates atoms on the font thread while it opens fonts, so
+ * MakeAtom takes atomLock on both threads.
+ */
+
+#define InitialTableSize 256
+#define AtomChunkSize 16384
+
+#if defined(__GNUC__)
+#define AtomPublish(var, val)	__atomic_store_n(&(var), (val), __ATOMIC_RELEASE)
+#define AtomFetch(var)		__atomic_load_n(&(var), __ATOMIC_ACQUIRE)
+#else
+#define AtomPublish(var, val)	((var) = (val))
+#define AtomFetch(var)		(var)
+#endif
+
+typedef struct _AtomChunk {
+    struct _AtomChunk *next;
+    size_t used, size;
+} AtomChunkRec, *AtomChunkPtr;
+
+typedef struct _AtomNames {
+    struct _AtomNames *retired; /* superseded table, freed with the atoms */
+    unsigned long length;
+    const char **names;
+} AtomNamesRec, *AtomNamesPtr;
 
-typedef struct _Node {
-    struct _Node *left, *right;
-    Atom a;
-    unsigned int fingerPrint;
-    const char *string;
-} NodeRec, *NodePtr;
+typedef struct _AtomSlot {
+    unsigned int hash;
+    Atom atom;                  /* None for an empty slot */
+} AtomSlotRec, *AtomSlotPtr;
 
 static Atom lastAtom = None;
-static NodePtr atomRoot = NULL;
-static unsigned long tableLength;
-static NodePtr *nodeTable;
+static AtomNamesPtr atomNames;
+static AtomSlotPtr atomHash;
+static unsigned long atomHashSize;
+static AtomChunkPtr atomChunks;
 
-void FreeAtom(NodePtr patom);
+#ifdef FONT_THREAD
+static pthread_mutex_t atomLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
 
-Atom
-MakeAtom(const char *string, unsigned len, Bool makeit)
+static unsigned int
+AtomHash(const char *string, unsigned len)
 {
-    NodePtr *np;
+    unsigned int hash = 2166136261U;
     unsigned i;
-    int comp;
-    unsigned int fp = 0;
 
-    np = &atomRoot;
-    for (i = 0; i < (len + 1) / 2; i++) {
-        fp = fp * 27 + string[i];
-        fp = fp * 27 + string[len - 1 - i];
+    for (i = 0; i < len; i++)
+        hash = (hash ^ (unsigned char) string[i]) * 16777619U;
+    return hash;
+}
+
+static AtomSlotPtr
+AtomLookup(const char *string, unsigned len, unsigned int hash)
+{
+    unsigned long i = hash & (atomHashSize - 1);
+    AtomSlotPtr slot;
+    const char *name;
+
+    for (;; i = (i + 1) & (atomHashSize - 1)) {
+        slot = &atomHash[i];
+        if (slot->atom == None)
+            return slot;
+        if (slot->hash != hash)
+            continue;
+        name = atomNames->names[slot->atom];
+        if (strncmp(name, string, len) == 0 && name[len] == '\0')
+            return slot;
     }
-    while (*np != NULL) {
-        if (fp < (*np)->fingerPrint)
-            np = &((*np)->left);
-        else if (fp > (*np)->fingerPrint)
-            np = &((*np)->right);
-        else {                  /* now start testing the strings */
-            comp = strncmp(string, (*np)->string, (int) len);
-            if ((comp < 0) || ((comp == 0) && (len < strlen((*np)->string))))
-                np = &((*np)->left);
-            else if (comp > 0)
-                np = &((*np)->right);
-            else
-                return (*np)->a;
-        }
+}
+
+static Bool
+GrowAtomHash(void)
+{
+    unsigned long size = atomHash ? atomHashSize * 2 : InitialTableSize * 2;
+    AtomSlotPtr hash;
+    unsigned long i, j;
+
+    hash = calloc(size, sizeof(AtomSlotRec));
+    if (!hash)
+        return FALSE;
+    for (i = 0; i < atomHashSize; i++) {
+        if (atomHash[i].atom == None)
+            continue;
+        for (j = atomHash[i].hash & (size - 1); hash[j].atom != None;
+             j = (j + 1) & (size - 1));
+        hash[j] = atomHash[i];
     }
-    if (makeit) {
-        NodePtr nd;
+    free(atomHash);
+    atomHash = hash;
+    atomHashSize = size;
+    return TRUE;
+}
 
-        nd = malloc(sizeof(NodeRec));
-        if (!nd)
-            return BAD_RESOURCE;
-        if (lastAtom < XA_LAST_PREDEFINED) {
-            nd->string = string;
+static Bool
+GrowAtomNames(void)
+{
+    AtomNamesPtr names, old = atomNames;
+    unsigned long length = old ? old->length * 2 : InitialTableSize;
+
+    names = malloc(sizeof(AtomNamesRec) + length * sizeof(const char *));
+    if (!names)
+        return FALSE;
+    names->retired = old;
+    names->length = length;
+    names->names = (const char **) (names + 1);
+    if (old)
+        memcpy(names->names, old->names, (lastAtom + 1) * sizeof(const char *));
+    else
+        names->names[None] = NULL;
+    AtomPublish(atomNames, names);
+    return TRUE;
+}
+
+static const char *
+AtomStrndup(const char *string, unsigned len)
+{
+    AtomChunkPtr chunk = atomChunks;
+    char *name;
+
+    if (!chunk || chunk->size - chunk->used <= len) {
+        size_t size = max(AtomChunkSize, len + 1);
+
+        chunk = malloc(sizeof(AtomChunkRec) + size);
+        if (!chunk)
+            return NULL;
+        chunk->used = 0;
+        chunk->size = size;
+        /* Oversized names get a chunk of their own; keep filling the
+           current one. */
+        if (size > AtomChunkSize && atomChunks) {
+            chunk->next = atomChunks->next;
+            atomChunks->next = chunk;
         }
         else {
-            nd->string = strndup(string, len);
-            if (!nd->string) {
-                free(nd);
-                return BAD_RESOURCE;
-            }
-        }
-        if ((lastAtom + 1) >= tableLength) {
-            NodePtr *table;
-
-            table = realloc(nodeTable, tableLength * (2 * sizeof(NodePtr)));
-            if (!table) {
-                if (nd->string != string) {
-                    /* nd->string has been strdup'ed */
-                    free((char *) nd->string);
-                }
-                free(nd);
-                return BAD_RESOURCE;
-            }
-            tableLength <<= 1;
-            nodeTable = table;
+            chunk->next = atomChunks;
+            atomChunks = chunk;
         }
-        *np = nd;
-        nd->left = nd->right = NULL;
-        nd->fingerPrint = fp;
-        nd->a = ++lastAtom;
-        nodeTable[lastAtom] = nd;
-        return nd->a;
     }
-    else
+    name = (char *) (chunk + 1) + chunk->used;
+    memcpy(name, string, len);
+    name[len] = '\0';
+    chunk->used += len + 1;
+    return name;
+}
+
+static Atom
+AtomIntern(const char *string, unsigned len, Bool makeit)
+{
+    AtomSlotPtr slot;
+    unsigned int hash;
+    const char *name;
+    Atom atom;
+
+    len = strnlen(string, len);
+    hash = AtomHash(string, len);
+    slot = AtomLookup(string, len, hash);
+    if (slot->atom != None)
+        return slot->atom;
+    if (!makeit)
         return None;
+
+    if ((lastAtom + 1) >= atomNames->length && !GrowAtomNames())
+        return BAD_RESOURCE;
+    if ((lastAtom + 1) * 2 >= atomHashSize) {
+        if (!GrowAtomHash())
+            return BAD_RESOURCE;
+        slot = AtomLookup(string, len, hash);
+    }
+    if (lastAtom < XA_LAST_PREDEFINED)
+        name = string;
+    else if (!(name = AtomStrndup(string, len)))
+        return BAD_RESOURCE;
+
+    atom = lastAtom + 1;
+    atomNames->names[atom] = name;
+    slot->hash = hash;
+    slot->atom = atom;
+    AtomPublish(lastAtom, atom);
+    return atom;
+}
+
+Atom
+MakeAtom(const char *string, unsigned len, Bool makeit)
+{
+#ifdef FONT_THREAD
+    Atom atom;
+
+    pthread_mutex_lock(&atomLock);
+    atom = AtomIntern(string, len, makeit);
+    pthread_mutex_unlock(&atomLock);
+    return atom;
+#else
+    return AtomIntern(string, len, makeit);
+#endif
 }
 
 Bool
 ValidAtom(Atom atom)
 {
-    return (atom != None) && (atom <= lastAtom);
+    return (atom != None) && (atom <= AtomFetch(lastAtom));
 }
 
 const char *
 NameForAtom(Atom atom)
 {
-    NodePtr node;
+    AtomNamesPtr names;
 
-    if (atom > lastAtom)
+    if (atom > AtomFetch(lastAtom))
         return 0;
-    if ((node = nodeTable[atom]) == NULL)
-        return 0;
-    return node->string;
+    names = AtomFetch(atomNames);
+    return names->names[atom];
 }
 
 void
@@ -166,32 +292,23 @@ AtomError(void)
     FatalError("initializing atoms");
 }
 
-void
-FreeAtom(NodePtr patom)
-{
-    if (patom->left)
-        FreeAtom(patom->left);
-    if (patom->right)
-        FreeAtom(patom->right);
-    if (patom->a > XA_LAST_PREDEFINED) {
-        /*
-         * All strings above XA_LAST_PREDEFINED are strdup'ed, so it's safe to
-         * cast here
-         */
-        free((char *) patom->string);
-    }
-    free(patom);
-}
-
 void
 FreeAllAtoms(void)
 {
-    if (atomRoot == NULL)
-        return;
-    FreeAtom(atomRoot);
-    atomRoot = NULL;
-    free(nodeTable);
-    nodeTable = NULL;
+    AtomNamesPtr names;
+    AtomChunkPtr chunk;
+
+    while ((names = atomNames)) {
+        atomNames = names->retired;
+        free(names);
+    }
+    while ((chunk = atomChunks)) {
+        atomChunks = chunk->next;
+        free(chunk);
+    }
+    free(atomHash);
+    atomHash = NULL;
+    atomHashSize = 0;
     lastAtom = None;
 }
 
@@ -199,11 +316,8 @@ void
 InitAtoms(void)
 {
     FreeAllAtoms();
-    tableLength = InitialTableSize;
-    nodeTable = malloc(InitialTableSize * sizeof(NodePtr));
-    if (!nodeTable)
+    if (!GrowAtomNames() || !GrowAtomHash())
         AtomError();
-    nodeTable[None] = NULL;
     MakePredeclaredAtoms();
     if (lastAtom != XA_LAST_PREDEFINED)
         AtomError();
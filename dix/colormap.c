@@ -373,8 +373,8 @@ CreateColormap(Colormap mid, ScreenPtr pScreen, VisualPtr pVisual,
     /*  
      * Security creation/labeling check
      */
-    i = XaceHook(XACE_RESOURCE_ACCESS, clients[client], mid, RT_COLORMAP,
-                 pmap, RT_NONE, NULL, DixCreateAccess);
+    i = XaceHookResourceAccess(clients[client], mid, RT_COLORMAP,
+                               pmap, RT_NONE, NULL, DixCreateAccess);
     if (i != Success) {
         FreeResource(mid, RT_NONE);
         return i;
@@ -284,8 +284,8 @@ AllocARGBCursor(unsigned char *psrcbits, unsigned char *pmaskbits,
     pCurs->id = cid;
 
     /* security creation/labeling check */
-    rc = XaceHook(XACE_RESOURCE_ACCESS, client, cid, RT_CURSOR,
-                  pCurs, RT_NONE, NULL, DixCreateAccess);
+    rc = XaceHookResourceAccess(client, cid, RT_CURSOR,
+                                pCurs, RT_NONE, NULL, DixCreateAccess);
     if (rc != Success)
         goto error;
 
@@ -443,8 +443,8 @@ AllocGlyphCursor(Font source, unsigned sourceChar, Font mask, unsigned maskChar,
     pCurs->id = cid;
 
     /* security creation/labeling check */
-    rc = XaceHook(XACE_RESOURCE_ACCESS, client, cid, RT_CURSOR,
-                  pCurs, RT_NONE, NULL, DixCreateAccess);
+    rc = XaceHookResourceAccess(client, cid, RT_CURSOR,
+                                pCurs, RT_NONE, NULL, DixCreateAccess);
     if (rc != Success)
         goto error;
 
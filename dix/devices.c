@@ -79,6 +79,7 @@ SOFTWARE.
 #include <pixman.h>
 #include "exglobals.h"
 #include "exevents.h"
+#include "eventconvert.h"
 #include "xiquerydevice.h"      /* for SizeDeviceClasses */
 #include "xiproperty.h"
 #include "enterleave.h"         /* for EnterWindow() */
@@ -292,7 +293,7 @@ AddInputDevice(ClientPtr client, DeviceProc deviceProc, Bool autoStart)
 
     /*  security creation/labeling check
      */
-    if (XaceHook(XACE_DEVICE_ACCESS, client, dev, DixCreateAccess)) {
+    if (XaceHookDeviceAccess(client, dev, DixCreateAccess)) {
         dixFreePrivates(dev->devPrivates, PRIVATE_DEVICE);
         free(dev);
         return NULL;
@@ -984,6 +985,7 @@ CloseDevice(DeviceIntPtr dev)
     for (j = 0; j < dev->last.num_touches; j++)
         free(dev->last.touches[j].valuators);
     free(dev->last.touches);
+    FreeEventConvertArena(&dev->convertArena);
     dev->config_info = NULL;
     dixFreePrivates(dev->devPrivates, PRIVATE_DEVICE);
     free(dev);
@@ -1198,7 +1200,7 @@ dixLookupDevice(DeviceIntPtr *pDev, int id, ClientPtr client, Mask access_mode)
     return BadDevice;
 
  found:
-    rc = XaceHook(XACE_DEVICE_ACCESS, client, dev, access_mode);
+    rc = XaceHookDeviceAccess(client, dev, access_mode);
     if (rc == Success)
         *pDev = dev;
     return rc;
@@ -1813,7 +1815,7 @@ ProcChangeKeyboardMapping(ClientPtr client)
     keysyms.mapWidth = stuff->keySymsPerKeyCode;
     keysyms.map = (KeySym *) &stuff[1];
 
-    rc = XaceHook(XACE_DEVICE_ACCESS, client, pDev, DixManageAccess);
+    rc = XaceHookDeviceAccess(client, pDev, DixManageAccess);
     if (rc != Success)
         return rc;
 
@@ -1826,7 +1828,7 @@ ProcChangeKeyboardMapping(ClientPtr client)
         if (!tmp->key)
             continue;
 
-        rc = XaceHook(XACE_DEVICE_ACCESS, client, pDev, DixManageAccess);
+        rc = XaceHookDeviceAccess(client, pDev, DixManageAccess);
         if (rc != Success)
             continue;
 
@@ -1907,7 +1909,7 @@ ProcGetKeyboardMapping(ClientPtr client)
     REQUEST(xGetKeyboardMappingReq);
     REQUEST_SIZE_MATCH(xGetKeyboardMappingReq);
 
-    rc = XaceHook(XACE_DEVICE_ACCESS, client, kbd, DixGetAttrAccess);
+    rc = XaceHookDeviceAccess(client, kbd, DixGetAttrAccess);
     if (rc != Success)
         return rc;
 
@@ -1960,7 +1962,7 @@ ProcGetPointerMapping(ClientPtr client)
 
     REQUEST_SIZE_MATCH(xReq);
 
-    rc = XaceHook(XACE_DEVICE_ACCESS, client, ptr, DixGetAttrAccess);
+    rc = XaceHookDeviceAccess(client, ptr, DixGetAttrAccess);
     if (rc != Success)
         return rc;
 
@@ -2186,7 +2188,7 @@ ProcChangeKeyboardControl(ClientPtr client)
         if ((pDev == keyboard ||
              (!IsMaster(pDev) && GetMaster(pDev, MASTER_KEYBOARD) == keyboard))
             && pDev->kbdfeed && pDev->kbdfeed->CtrlProc) {
-            ret = XaceHook(XACE_DEVICE_ACCESS, client, pDev, DixManageAccess);
+            ret = XaceHookDeviceAccess(client, pDev, DixManageAccess);
             if (ret != Success)
                 return ret;
         }
@@ -2215,7 +2217,7 @@ ProcGetKeyboardControl(ClientPtr client)
 
     REQUEST_SIZE_MATCH(xReq);
 
-    rc = XaceHook(XACE_DEVICE_ACCESS, client, kbd, DixGetAttrAccess);
+    rc = XaceHookDeviceAccess(client, kbd, DixGetAttrAccess);
     if (rc != Success)
         return rc;
 
@@ -2263,7 +2265,7 @@ ProcBell(ClientPtr client)
              (!IsMaster(dev) && GetMaster(dev, MASTER_KEYBOARD) == keybd)) &&
             dev->kbdfeed && dev->kbdfeed->BellProc) {
 
-            rc = XaceHook(XACE_DEVICE_ACCESS, client, dev, DixBellAccess);
+            rc = XaceHookDeviceAccess(client, dev, DixBellAccess);
             if (rc != Success)
                 return rc;
             XkbHandleBell(FALSE, FALSE, dev, newpercent,
@@ -2333,7 +2335,7 @@ ProcChangePointerControl(ClientPtr client)
         if ((dev == mouse ||
              (!IsMaster(dev) && GetMaster(dev, MASTER_POINTER) == mouse)) &&
             dev->ptrfeed) {
-            rc = XaceHook(XACE_DEVICE_ACCESS, client, dev, DixManageAccess);
+            rc = XaceHookDeviceAccess(client, dev, DixManageAccess);
             if (rc != Success)
                 return rc;
         }
@@ -2360,7 +2362,7 @@ ProcGetPointerControl(ClientPtr client)
 
     REQUEST_SIZE_MATCH(xReq);
 
-    rc = XaceHook(XACE_DEVICE_ACCESS, client, ptr, DixGetAttrAccess);
+    rc = XaceHookDeviceAccess(client, ptr, DixGetAttrAccess);
     if (rc != Success)
         return rc;
 
@@ -2409,7 +2411,7 @@ ProcGetMotionEvents(ClientPtr client)
     rc = dixLookupWindow(&pWin, stuff->window, client, DixGetAttrAccess);
     if (rc != Success)
         return rc;
-    rc = XaceHook(XACE_DEVICE_ACCESS, client, mouse, DixReadAccess);
+    rc = XaceHookDeviceAccess(client, mouse, DixReadAccess);
     if (rc != Success)
         return rc;
 
@@ -2472,7 +2474,7 @@ ProcQueryKeymap(ClientPtr client)
         .length = 2
     };
 
-    rc = XaceHook(XACE_DEVICE_ACCESS, client, keybd, DixReadAccess);
+    rc = XaceHookDeviceAccess(client, keybd, DixReadAccess);
     /* If rc is Success, we're allowed to copy out the keymap.
      * If it's BadAccess, we leave it empty & lie to the client.
      */
@@ -1272,6 +1272,7 @@ ProcQueryTextExtents(ClientPtr client)
     FontPtr pFont;
     ExtentInfoRec info;
     unsigned long length;
+    Bool ok;
     int rc;
 
     REQUEST(xQueryTextExtentsReq);
@@ -1288,7 +1289,10 @@ ProcQueryTextExtents(ClientPtr client)
             return BadLength;
         length--;
     }
-    if (!QueryTextExtents(pFont, length, (unsigned char *) &stuff[1], &info))
+    LockFontLibrary();
+    ok = QueryTextExtents(pFont, length, (unsigned char *) &stuff[1], &info);
+    UnlockFontLibrary();
+    if (!ok)
         return BadAlloc;
     reply = (xQueryTextExtentsReply) {
         .type = X_Reply,
@@ -1395,8 +1399,8 @@ ProcCreatePixmap(ClientPtr client)
         pMap->drawable.serialNumber = NEXT_SERIAL_NUMBER;
         pMap->drawable.id = stuff->pid;
         /* security creation/labeling check */
-        rc = XaceHook(XACE_RESOURCE_ACCESS, client, stuff->pid, RT_PIXMAP,
-                      pMap, RT_NONE, NULL, DixCreateAccess);
+        rc = XaceHookResourceAccess(client, stuff->pid, RT_PIXMAP,
+                                    pMap, RT_NONE, NULL, DixCreateAccess);
         if (rc != Success) {
             (*pDraw->pScreen->DestroyPixmap) (pMap);
             return rc;
@@ -2356,7 +2360,7 @@ ProcInstallColormap(ClientPtr client)
     if (rc != Success)
         goto out;
 
-    rc = XaceHook(XACE_SCREEN_ACCESS, client, pcmp->pScreen, DixSetAttrAccess);
+    rc = XaceHookScreenAccess(client, pcmp->pScreen, DixSetAttrAccess);
     if (rc != Success) {
         if (rc == BadValue)
             rc = BadColor;
@@ -2385,7 +2389,7 @@ ProcUninstallColormap(ClientPtr client)
     if (rc != Success)
         goto out;
 
-    rc = XaceHook(XACE_SCREEN_ACCESS, client, pcmp->pScreen, DixSetAttrAccess);
+    rc = XaceHookScreenAccess(client, pcmp->pScreen, DixSetAttrAccess);
     if (rc != Success) {
         if (rc == BadValue)
             rc = BadColor;
@@ -2415,8 +2419,8 @@ ProcListInstalledColormaps(ClientPtr client)
     if (rc != Success)
         return rc;
 
-    rc = XaceHook(XACE_SCREEN_ACCESS, client, pWin->drawable.pScreen,
-                  DixGetAttrAccess);
+    rc = XaceHookScreenAccess(client, pWin->drawable.pScreen,
+                              DixGetAttrAccess);
     if (rc != Success)
         return rc;
 
@@ -2980,7 +2984,7 @@ ProcQueryBestSize(ClientPtr client)
     if (stuff->class != CursorShape && pDraw->type == UNDRAWABLE_WINDOW)
         return BadMatch;
     pScreen = pDraw->pScreen;
-    rc = XaceHook(XACE_SCREEN_ACCESS, client, pScreen, DixGetAttrAccess);
+    rc = XaceHookScreenAccess(client, pScreen, DixGetAttrAccess);
     if (rc != Success)
         return rc;
     (*pScreen->QueryBestSize) (stuff->class, &stuff->width,
@@ -3005,8 +3009,8 @@ ProcSetScreenSaver(ClientPtr client)
     REQUEST_SIZE_MATCH(xSetScreenSaverReq);
 
     for (i = 0; i < screenInfo.numScreens; i++) {
-        rc = XaceHook(XACE_SCREENSAVER_ACCESS, client, screenInfo.screens[i],
-                      DixSetAttrAccess);
+        rc = XaceHookScreensaverAccess(client, screenInfo.screens[i],
+                                       DixSetAttrAccess);
         if (rc != Success)
             return rc;
     }
@@ -3065,8 +3069,8 @@ ProcGetScreenSaver(ClientPtr client)
     REQUEST_SIZE_MATCH(xReq);
 
     for (i = 0; i < screenInfo.numScreens; i++) {
-        rc = XaceHook(XACE_SCREENSAVER_ACCESS, client, screenInfo.screens[i],
-                      DixGetAttrAccess);
+        rc = XaceHookScreensaverAccess(client, screenInfo.screens[i],
+                                       DixGetAttrAccess);
         if (rc != Success)
             return rc;
     }
@@ -3114,7 +3118,7 @@ ProcListHosts(ClientPtr client)
     REQUEST_SIZE_MATCH(xListHostsReq);
 
     /* untrusted clients can't list hosts */
-    result = XaceHook(XACE_SERVER_ACCESS, client, DixReadAccess);
+    result = XaceHookServerAccess(client, DixReadAccess);
     if (result != Success)
         return result;
 
@@ -3264,7 +3268,7 @@ ProcChangeCloseDownMode(ClientPtr client)
     REQUEST(xSetCloseDownModeReq);
     REQUEST_SIZE_MATCH(xSetCloseDownModeReq);
 
-    rc = XaceHook(XACE_CLIENT_ACCESS, client, client, DixManageAccess);
+    rc = XaceHookClientAccess(client, client, DixManageAccess);
     if (rc != Success)
         return rc;
 
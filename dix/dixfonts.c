@@ -70,6 +70,13 @@ Equipment Corporation.
 #include "xf86bigfontsrv.h"
 #endif
 
+#ifdef FONT_THREAD
+#include <pthread.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 extern void *fosNaturalParams;
 extern FontPtr defaultFont;
 
@@ -85,6 +92,82 @@ static int size_slept_fpes = 0;
 static FontPathElementPtr *slept_fpes = (FontPathElementPtr *) 0;
 static FontPatternCachePtr patternCache;
 
+/*
+ * ListFonts replies for font paths made only of local directories, keyed by
+ * pattern and max_names.  The names such a path lists only change when the
+ * path is set again, which bumps fontPathGeneration and empties the cache.
+ */
+#define LIST_FONTS_CACHE_SIZE	64
+
+typedef struct _ListFontsCacheEntry {
+    unsigned long generation;   /* 0 if unused */
+    LFWIstateRec request;
+    int nnames;
+    int length;
+    char *data;                 /* the reply's list of STR */
+} ListFontsCacheEntryRec, *ListFontsCacheEntryPtr;
+
+static ListFontsCacheEntryRec listFontsCache[LIST_FONTS_CACHE_SIZE];
+static unsigned long fontPathGeneration = 1;
+static unsigned long listFontsCacheHits, listFontsCacheMisses;
+
+/*
+ * Decoded glyphs of a local font, by encoding and character code, shared
+ * by every client drawing core text with it.  Fonts whose glyphs are
+ * loaded on demand from a font server aren't cached.
+ */
+typedef struct _GlyphIndexCache {
+    CharInfoPtr *pages[TwoD16Bit + 1][256];
+} GlyphIndexCacheRec, *GlyphIndexCachePtr;
+
+static int glyphIndexCachePrivate = -1;
+static CharInfoRec noGlyph;     /* marks characters without a glyph */
+static unsigned long glyphIndexCacheHits, glyphIndexCacheMisses;
+
+/*
+ * Where an OpenFont request stands with the font thread.
+ */
+enum {
+    FontThreadNone,             /* never handed to the thread */
+    FontThreadQueued,           /* queued, or being opened */
+    FontThreadDone,             /* opened, waiting for doOpenFont */
+    FontThreadResumed           /* back in doOpenFont, client still asleep */
+};
+
+#ifdef FONT_THREAD
+/*
+ * Fonts from local directories are opened on a thread of their own, so
+ * that decompressing and parsing a large font only holds up the client
+ * asking for it.  libXfont isn't thread safe: every call into it, from
+ * either thread, is made holding fontLibraryLock.  A font closed while
+ * the thread might still hand it out again isn't freed until the thread
+ * has nothing left pending.
+ *
+ * The thread holds fontLibraryLock for all of open_font, so while it is
+ * parsing a font, anything else that calls into libXfont waits for it:
+ * ListFonts, ListFontsWithInfo, QueryFont, QueryTextExtents, CloseFont,
+ * SetFontPath, opens from font servers, the font server block and wakeup
+ * handlers, cleanup after a client dies, and text requests that miss the
+ * glyph cache.  Requests that don't touch libXfont, including text on
+ * glyphs already cached, aren't held up.  Atoms and log messages libXfont
+ * creates from the thread go through locks of their own in dix/atom.c and
+ * os/log.c.
+ */
+static pthread_mutex_t fontLibraryLock;     /* recursive */
+static Bool fontLibraryLockInitialized;
+static pthread_mutex_t fontThreadLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t fontThreadCond = PTHREAD_COND_INITIALIZER;
+static pthread_t fontThread;
+static Bool fontThreadRunning, fontThreadQuit;
+static int fontThreadPipe[2] = { -1, -1 };
+static OFclosurePtr fontThreadQueue, fontThreadDone;
+static int fontThreadPending;   /* requests not yet back in doOpenFont */
+
+static int num_deferred_fonts = 0;
+static int size_deferred_fonts = 0;
+static FontPtr *deferred_fonts = (FontPtr *) 0;
+#endif
+
 static int
 FontToXError(int err)
 {
@@ -104,15 +187,76 @@ FontToXError(int err)
     }
 }
 
+/**
+ * Serialize calls into the font library with the font thread.  Code
+ * calling a font's get_glyphs or get_metrics directly must hold this.
+ */
+void
+LockFontLibrary(void)
+{
+#ifdef FONT_THREAD
+    pthread_mutex_lock(&fontLibraryLock);
+#endif
+}
+
+void
+UnlockFontLibrary(void)
+{
+#ifdef FONT_THREAD
+    pthread_mutex_unlock(&fontLibraryLock);
+#endif
+}
+
 static int
 LoadGlyphs(ClientPtr client, FontPtr pfont, unsigned nchars, int item_size,
            unsigned char *data)
 {
-    if (fpe_functions[pfont->fpe->type].load_glyphs)
-        return (*fpe_functions[pfont->fpe->type].load_glyphs)
+    int err = Successful;
+
+    if (fpe_functions[pfont->fpe->type].load_glyphs) {
+        LockFontLibrary();
+        err = (*fpe_functions[pfont->fpe->type].load_glyphs)
             (client, pfont, 0, nchars, item_size, data);
-    else
-        return Successful;
+        UnlockFontLibrary();
+    }
+    return err;
+}
+
+static GlyphIndexCachePtr
+GetGlyphIndexCache(FontPtr font)
+{
+    GlyphIndexCachePtr cache;
+
+    if (glyphIndexCachePrivate < 0 || !font->fpe ||
+        fpe_functions[font->fpe->type].load_glyphs)
+        return NULL;
+
+    cache = FontGetPrivate(font, glyphIndexCachePrivate);
+    if (!cache) {
+        cache = calloc(1, sizeof(GlyphIndexCacheRec));
+        if (cache && !FontSetPrivate(font, glyphIndexCachePrivate, cache)) {
+            free(cache);
+            cache = NULL;
+        }
+    }
+    return cache;
+}
+
+static void
+FreeGlyphIndexCache(FontPtr font)
+{
+    GlyphIndexCachePtr cache;
+    int encoding, page;
+
+    if (glyphIndexCachePrivate < 0 ||
+        !(cache = FontGetPrivate(font, glyphIndexCachePrivate)))
+        return;
+
+    for (encoding = 0; encoding <= TwoD16Bit; encoding++)
+        for (page = 0; page < 256; page++)
+            free(cache->pages[encoding][page]);
+    free(cache);
+    FontSetPrivate(font, glyphIndexCachePrivate, NULL);
 }
 
 void
@@ -121,7 +265,142 @@ dixGetGlyphs(FontPtr font, unsigned long count, unsigned char *chars,
              unsigned long *glyphcount,    /* RETURN */
              CharInfoPtr *glyphs)          /* RETURN */
 {
-    (*font->get_glyphs) (font, count, chars, fontEncoding, glyphcount, glyphs);
+    GlyphIndexCachePtr cache;
+    int width = (fontEncoding == Linear8Bit ||
+                 fontEncoding == TwoD8Bit) ? 1 : 2;
+    unsigned long i, n = 0;
+
+    if ((unsigned) fontEncoding > TwoD16Bit ||
+        !(cache = GetGlyphIndexCache(font))) {
+        LockFontLibrary();
+        (*font->get_glyphs) (font, count, chars, fontEncoding, glyphcount,
+                             glyphs);
+        UnlockFontLibrary();
+        return;
+    }
+
+    for (i = 0; i < count; i++, chars += width) {
+        unsigned code = width == 1 ? chars[0] : (chars[0] << 8) | chars[1];
+        CharInfoPtr *page = cache->pages[fontEncoding][code >> 8];
+        CharInfoPtr pci = page ? page[code & 0xff] : NULL;
+
+        if (pci) {
+            glyphIndexCacheHits++;
+        }
+        else {
+            unsigned long got;
+
+            glyphIndexCacheMisses++;
+            LockFontLibrary();
+            (*font->get_glyphs) (font, 1, chars, fontEncoding, &got, &pci);
+            UnlockFontLibrary();
+            if (!got)
+                pci = &noGlyph;
+            if (!page)
+                page = cache->pages[fontEncoding][code >> 8] =
+                    calloc(256, sizeof(CharInfoPtr));
+            if (page)
+                page[code & 0xff] = pci;
+        }
+        if (pci != &noGlyph)
+            glyphs[n++] = pci;
+    }
+    *glyphcount = n;
+}
+
+static unsigned
+ListFontsCacheHash(LFWIstatePtr request)
+{
+    unsigned hash = 2166136261U;
+    int i;
+
+    for (i = 0; i < request->patlen; i++)
+        hash = (hash ^ (unsigned char) request->pattern[i]) * 16777619U;
+    hash = (hash ^ request->max_names) * 16777619U;
+    return hash % LIST_FONTS_CACHE_SIZE;
+}
+
+static ListFontsCacheEntryPtr
+ListFontsCacheLookup(LFWIstatePtr request)
+{
+    ListFontsCacheEntryPtr entry = &listFontsCache[ListFontsCacheHash(request)];
+
+    if (entry->generation == fontPathGeneration &&
+        entry->request.patlen == request->patlen &&
+        entry->request.max_names == request->max_names &&
+        memcmp(entry->request.pattern, request->pattern,
+               request->patlen) == 0) {
+        listFontsCacheHits++;
+        return entry;
+    }
+    listFontsCacheMisses++;
+    return NULL;
+}
+
+static void
+ListFontsCacheStore(LFWIstatePtr request, int nnames, int length, char *data)
+{
+    ListFontsCacheEntryPtr entry = &listFontsCache[ListFontsCacheHash(request)];
+    char *copy = malloc(length ? length : 1);
+
+    if (!copy)
+        return;
+    memcpy(copy, data, length);
+    free(entry->data);
+    entry->generation = fontPathGeneration;
+    entry->request = *request;
+    entry->nnames = nnames;
+    entry->length = length;
+    entry->data = copy;
+}
+
+static void
+ListFontsCacheInvalidate(void)
+{
+    int i;
+
+    fontPathGeneration++;
+    for (i = 0; i < LIST_FONTS_CACHE_SIZE; i++) {
+        free(listFontsCache[i].data);
+        listFontsCache[i].data = NULL;
+        listFontsCache[i].generation = 0;
+    }
+}
+
+/*
+ * Whether ListFonts replies for the current font path may be cached:
+ * font servers can change what they list at any time, and catalogue
+ * directories are rescanned when they change.
+ */
+static Bool
+ListFontsCacheable(void)
+{
+    int i;
+
+    for (i = 0; i < num_fpes; i++) {
+        FontPathElementPtr fpe = font_path_elements[i];
+
+        if (fpe_functions[fpe->type].wakeup_fpe ||
+            fpe_functions[fpe->type].load_glyphs ||
+            strncmp(fpe->name, "catalogue:", 10) == 0)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static void
+ListFontsWriteReply(ClientPtr client, int nnames, int length, char *data)
+{
+    xListFontsReply reply = {
+        .type = X_Reply,
+        .length = bytes_to_int32(length),
+        .nFonts = nnames,
+        .sequenceNumber = client->sequence
+    };
+
+    client->pSwapReplyFunc = ReplySwapVector[X_ListFonts];
+    WriteSwappedDataToClient(client, sizeof(xListFontsReply), &reply);
+    WriteToClient(client, length, data);
 }
 
 /*
@@ -205,10 +484,12 @@ FontWakeup(void *data, int count, void *LastSelectMask)
     if (count < 0)
         return;
     /* wake up any fpe's that may be waiting for information */
+    LockFontLibrary();
     for (i = 0; i < num_slept_fpes; i++) {
         fpe = slept_fpes[i];
         (void) (*fpe_functions[fpe->type].wakeup_fpe) (fpe, LastSelectMask);
     }
+    UnlockFontLibrary();
 }
 
 /* XXX -- these two funcs may want to be broken into macros */
@@ -223,30 +504,35 @@ FreeFPE(FontPathElementPtr fpe)
 {
     fpe->refcount--;
     if (fpe->refcount == 0) {
+        LockFontLibrary();
         (*fpe_functions[fpe->type].free_fpe) (fpe);
+        UnlockFontLibrary();
         free((void *) fpe->name);
         free(fpe);
     }
 }
 
-static Bool
-doOpenFont(ClientPtr client, OFclosurePtr c)
+static void
+FreeOpenFontClosure(OFclosurePtr c)
 {
-    FontPtr pfont = NullFont;
-    FontPathElementPtr fpe = NULL;
-    ScreenPtr pScr;
-    int err = Successful;
     int i;
-    char *alias, *newname;
-    int newlen;
-    int aliascount = 20;
 
-    /*
-     * Decide at runtime what FontFormat to use.
-     */
-    Mask FontFormat =
-        ((screenInfo.imageByteOrder == LSBFirst) ?
-         BitmapFormatByteOrderLSB : BitmapFormatByteOrderMSB) |
+    for (i = 0; i < c->num_fpes; i++) {
+        FreeFPE(c->fpe_list[i]);
+    }
+    free(c->fpe_list);
+    free((void *) c->fontname);
+    free(c);
+}
+
+/*
+ * Decide at runtime what FontFormat to use.
+ */
+static Mask
+OpenFontFormat(void)
+{
+    return ((screenInfo.imageByteOrder == LSBFirst) ?
+            BitmapFormatByteOrderLSB : BitmapFormatByteOrderMSB) |
         ((screenInfo.bitmapBitOrder == LSBFirst) ?
          BitmapFormatBitOrderLSB : BitmapFormatBitOrderMSB) |
         BitmapFormatImageRectMin |
@@ -263,40 +549,435 @@ doOpenFont(ClientPtr client, OFclosurePtr c)
         BitmapFormatScanlinePad64 |
 #endif
         BitmapFormatScanlineUnit8;
+}
+
+/*
+ * Try to open c's font from fpe.  If the name is an alias, c is renamed
+ * to what it points at and restarted from the first path element, and
+ * FontNameAlias is returned.
+ */
+static int
+OpenFontFromFPE(ClientPtr client, OFclosurePtr c, FontPathElementPtr fpe,
+                FontPtr *ppfont)
+{
+    char *alias, *newname;
+    int newlen;
+    int err;
+
+    LockFontLibrary();
+    err = (*fpe_functions[fpe->type].open_font)
+        ((void *) client, fpe, c->flags,
+         c->fontname, c->fnamelen, OpenFontFormat(),
+         BitmapFormatMaskByte |
+         BitmapFormatMaskBit |
+         BitmapFormatMaskImageRectangle |
+         BitmapFormatMaskScanLinePad |
+         BitmapFormatMaskScanLineUnit,
+         c->fontid, ppfont, &alias,
+         c->non_cachable_font && c->non_cachable_font->fpe == fpe ?
+         c->non_cachable_font : (FontPtr) 0);
+
+    if (err == FontNameAlias) {
+        if (alias) {
+            newlen = strlen(alias);
+            newname = (char *) realloc((char *) c->fontname, newlen);
+            if (newname) {
+                memmove(newname, alias, newlen);
+                c->fontname = newname;
+                c->fnamelen = newlen;
+                c->current_fpe = 0;
+            }
+            else
+                err = AllocError;
+        }
+        else
+            err = BadFontName;
+    }
+    UnlockFontLibrary();
+    return err;
+}
+
+#ifdef FONT_THREAD
+/* Font servers are asynchronous already */
+static Bool
+FontThreadCanOpen(FontPathElementPtr fpe)
+{
+    return !fpe_functions[fpe->type].wakeup_fpe &&
+        !fpe_functions[fpe->type].load_glyphs;
+}
+
+/*
+ * Open c's font from the local directories starting at its current path
+ * element, stopping at the first font server.
+ */
+static void
+FontThreadOpen(OFclosurePtr c)
+{
+    FontPathElementPtr fpe;
+    FontPtr pfont = NullFont;
+    int err = BadFontName;
+    int aliascount = 20;
+
+    while (c->current_fpe < c->num_fpes) {
+        fpe = c->fpe_list[c->current_fpe];
+        if (!FontThreadCanOpen(fpe)) {
+            err = BadFontName;
+            break;
+        }
+        /* the client may be gone; local directories don't look at it */
+        err = OpenFontFromFPE(serverClient, c, fpe, &pfont);
+        if (err == FontNameAlias) {
+            if (--aliascount <= 0) {
+                err = BadImplementation;
+                break;
+            }
+            continue;
+        }
+        if (err == BadFontName) {
+            c->current_fpe++;
+            continue;
+        }
+        break;
+    }
+    c->thread_err = err;
+    c->thread_font = pfont;
+}
+
+static void *
+FontThreadMain(void *arg)
+{
+    OFclosurePtr c;
+    char byte = 0;
+
+    pthread_mutex_lock(&fontThreadLock);
+    for (;;) {
+        while (!fontThreadQueue && !fontThreadQuit)
+            pthread_cond_wait(&fontThreadCond, &fontThreadLock);
+        if (fontThreadQuit)
+            break;
+        c = fontThreadQueue;
+        fontThreadQueue = c->thread_next;
+        pthread_mutex_unlock(&fontThreadLock);
+
+        FontThreadOpen(c);
+
+        pthread_mutex_lock(&fontThreadLock);
+        c->thread_next = fontThreadDone;
+        fontThreadDone = c;
+        /* a full pipe has wakeups enough already */
+        if (write(fontThreadPipe[1], &byte, 1) < 0)
+            continue;
+    }
+    pthread_mutex_unlock(&fontThreadLock);
+    return NULL;
+}
+
+static int
+FindDeferredFont(FontPtr pfont)
+{
+    int i;
+
+    for (i = 0; i < num_deferred_fonts; i++)
+        if (deferred_fonts[i] == pfont)
+            return i;
+    return -1;
+}
+
+/*
+ * Hold on to a font nothing references any more until the thread has
+ * nothing pending that might return it.  The font keeps a reference to
+ * its FPE meanwhile.
+ */
+static Bool
+DeferFontClose(FontPtr pfont)
+{
+    FontPtr *new;
+
+    if (num_deferred_fonts == size_deferred_fonts) {
+        new = (FontPtr *) realloc(deferred_fonts,
+                                  sizeof(FontPtr) * (size_deferred_fonts + 4));
+        if (!new)
+            return FALSE;
+        deferred_fonts = new;
+        size_deferred_fonts += 4;
+    }
+    deferred_fonts[num_deferred_fonts++] = pfont;
+    return TRUE;
+}
+
+/* The font was opened again before the thread went idle */
+static void
+UndeferFontClose(FontPtr pfont)
+{
+    int i = FindDeferredFont(pfont);
+
+    if (i >= 0) {
+        deferred_fonts[i] = deferred_fonts[--num_deferred_fonts];
+        FreeFPE(pfont->fpe);
+    }
+}
+
+static void
+CloseDeferredFonts(void)
+{
+    FontPtr pfont;
+    FontPathElementPtr fpe;
+
+    while (num_deferred_fonts) {
+        pfont = deferred_fonts[--num_deferred_fonts];
+        fpe = pfont->fpe;
+        LockFontLibrary();
+        (*fpe_functions[fpe->type].close_font) (fpe, pfont);
+        UnlockFontLibrary();
+        FreeFPE(fpe);
+    }
+}
+
+static void
+FontThreadRelease(void)
+{
+    if (--fontThreadPending == 0)
+        CloseDeferredFonts();
+}
+
+/*
+ * Take the thread's answer for c back into doOpenFont.
+ */
+static int
+FontThreadResult(OFclosurePtr c, FontPtr *ppfont)
+{
+    FontPtr pfont = c->thread_font;
+
+    if (c->thread_err == Successful && pfont)
+        UndeferFontClose(pfont);
+    c->thread_state = FontThreadResumed;
+    FontThreadRelease();
+    *ppfont = pfont;
+    return c->thread_err;
+}
+
+/*
+ * Drop the thread's answer for a client that has gone away.
+ */
+static void
+FontThreadDiscard(OFclosurePtr c)
+{
+    FontPtr pfont = c->thread_font;
+
+    if (c->thread_err == Successful && pfont && pfont->refcnt == 0 &&
+        FindDeferredFont(pfont) < 0) {
+        if (!pfont->fpe)
+            pfont->fpe = c->fpe_list[c->current_fpe];
+        UseFPE(pfont->fpe);
+        if (!DeferFontClose(pfont))
+            FreeFPE(pfont->fpe);
+    }
+    c->thread_state = FontThreadNone;
+    FontThreadRelease();
+}
+
+static void
+FontThreadFinish(OFclosurePtr c)
+{
+    if (c->client) {
+        c->thread_state = FontThreadDone;
+        ClientSignal(c->client);
+    }
+    else {
+        FontThreadDiscard(c);
+        FreeOpenFontClosure(c);
+    }
+}
+
+static void
+FontThreadCollect(void)
+{
+    OFclosurePtr c, next;
+    char buf[64];
+
+    while (read(fontThreadPipe[0], buf, sizeof(buf)) > 0)
+        continue;
+
+    pthread_mutex_lock(&fontThreadLock);
+    c = fontThreadDone;
+    fontThreadDone = NULL;
+    pthread_mutex_unlock(&fontThreadLock);
+
+    for (; c; c = next) {
+        next = c->thread_next;
+        FontThreadFinish(c);
+    }
+}
+
+static void
+FontThreadBlock(void *data, OSTimePtr pTimeout, void *pReadmask)
+{
+}
+
+static void
+FontThreadWakeup(void *data, int count, void *LastSelectMask)
+{
+    if (count > 0 && FD_ISSET(fontThreadPipe[0], (fd_set *) LastSelectMask))
+        FontThreadCollect();
+}
+
+static Bool
+FontThreadStart(void)
+{
+    sigset_t set, old;
+    int err;
+
+    if (fontThreadRunning)
+        return TRUE;
+
+    if (pipe(fontThreadPipe) < 0)
+        return FALSE;
+    fcntl(fontThreadPipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(fontThreadPipe[1], F_SETFL, O_NONBLOCK);
+    if (!RegisterBlockAndWakeupHandlers(FontThreadBlock, FontThreadWakeup,
+                                        NULL))
+        goto bail;
+
+    /* signals are for the main thread to handle */
+    sigfillset(&set);
+    pthread_sigmask(SIG_BLOCK, &set, &old);
+    err = pthread_create(&fontThread, NULL, FontThreadMain, NULL);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (err) {
+        RemoveBlockAndWakeupHandlers(FontThreadBlock, FontThreadWakeup, NULL);
+        goto bail;
+    }
+
+    AddGeneralSocket(fontThreadPipe[0]);
+    fontThreadRunning = TRUE;
+    return TRUE;
+
+ bail:
+    close(fontThreadPipe[0]);
+    close(fontThreadPipe[1]);
+    fontThreadPipe[0] = fontThreadPipe[1] = -1;
+    return FALSE;
+}
+
+static void
+FontThreadStop(void)
+{
+    OFclosurePtr c, next;
+
+    if (!fontThreadRunning)
+        return;
+
+    pthread_mutex_lock(&fontThreadLock);
+    c = fontThreadQueue;
+    fontThreadQueue = NULL;
+    fontThreadQuit = TRUE;
+    pthread_cond_signal(&fontThreadCond);
+    pthread_mutex_unlock(&fontThreadLock);
+    pthread_join(fontThread, NULL);
+
+    /* requests the thread never got to */
+    for (; c; c = next) {
+        next = c->thread_next;
+        c->thread_err = BadFontName;
+        c->thread_font = NullFont;
+        c->current_fpe = c->num_fpes;
+        FontThreadFinish(c);
+    }
+    FontThreadCollect();
+
+    RemoveGeneralSocket(fontThreadPipe[0]);
+    RemoveBlockAndWakeupHandlers(FontThreadBlock, FontThreadWakeup, NULL);
+    close(fontThreadPipe[0]);
+    close(fontThreadPipe[1]);
+    fontThreadPipe[0] = fontThreadPipe[1] = -1;
+    fontThreadQuit = FALSE;
+    fontThreadRunning = FALSE;
+}
+
+/*
+ * Whether to leave opening c's font from fpe to the thread.  Requests
+ * that must complete before OpenFont returns stay on this one.
+ */
+static Bool
+FontThreadTakes(ClientPtr client, OFclosurePtr c, FontPathElementPtr fpe)
+{
+    return !(c->flags & FontOpenSync) && client != serverClient &&
+        !ClientIsAsleep(client) && FontThreadCanOpen(fpe) &&
+        FontThreadStart();
+}
+
+static void
+FontThreadQueue(OFclosurePtr c)
+{
+    OFclosurePtr *prev;
+
+    c->thread_state = FontThreadQueued;
+    c->thread_next = NULL;
+    fontThreadPending++;
+
+    pthread_mutex_lock(&fontThreadLock);
+    for (prev = &fontThreadQueue; *prev; prev = &(*prev)->thread_next)
+        continue;
+    *prev = c;
+    pthread_cond_signal(&fontThreadCond);
+    pthread_mutex_unlock(&fontThreadLock);
+}
+#endif                          /* FONT_THREAD */
+
+static Bool
+doOpenFont(ClientPtr client, OFclosurePtr c)
+{
+    FontPtr pfont = NullFont;
+    FontPathElementPtr fpe = NULL;
+    ScreenPtr pScr;
+    int err = Successful;
+    int i;
+    int aliascount = 20;
 
     if (client->clientGone) {
+#ifdef FONT_THREAD
+        if (c->thread_state == FontThreadQueued) {
+            /* FontThreadFinish frees it once the thread is done */
+            c->client = NullClient;
+            ClientWakeup(client);
+            return TRUE;
+        }
+        if (c->thread_state == FontThreadDone)
+            FontThreadDiscard(c);
+#endif
         if (c->current_fpe < c->num_fpes) {
             fpe = c->fpe_list[c->current_fpe];
-            (*fpe_functions[fpe->type].client_died) ((void *) client, fpe);
+            if (fpe_functions[fpe->type].client_died) {
+                LockFontLibrary();
+                (*fpe_functions[fpe->type].client_died) ((void *) client,
+                                                         fpe);
+                UnlockFontLibrary();
+            }
         }
         err = Successful;
         goto bail;
     }
+#ifdef FONT_THREAD
+    if (c->thread_state == FontThreadDone) {
+        /* the thread went as far as the next font server */
+        err = FontThreadResult(c, &pfont);
+        if (err != BadFontName) {
+            fpe = c->fpe_list[c->current_fpe];
+            goto opened;
+        }
+    }
+#endif
     while (c->current_fpe < c->num_fpes) {
         fpe = c->fpe_list[c->current_fpe];
-        err = (*fpe_functions[fpe->type].open_font)
-            ((void *) client, fpe, c->flags,
-             c->fontname, c->fnamelen, FontFormat,
-             BitmapFormatMaskByte |
-             BitmapFormatMaskBit |
-             BitmapFormatMaskImageRectangle |
-             BitmapFormatMaskScanLinePad |
-             BitmapFormatMaskScanLineUnit,
-             c->fontid, &pfont, &alias,
-             c->non_cachable_font && c->non_cachable_font->fpe == fpe ?
-             c->non_cachable_font : (FontPtr) 0);
-
-        if (err == FontNameAlias && alias) {
-            newlen = strlen(alias);
-            newname = (char *) realloc((char *) c->fontname, newlen);
-            if (!newname) {
-                err = AllocError;
-                break;
-            }
-            memmove(newname, alias, newlen);
-            c->fontname = newname;
-            c->fnamelen = newlen;
-            c->current_fpe = 0;
+#ifdef FONT_THREAD
+        if (FontThreadTakes(client, c, fpe) &&
+            ClientSleep(client, (ClientSleepProcPtr) doOpenFont, c)) {
+            FontThreadQueue(c);
+            return TRUE;
+        }
+#endif
+        err = OpenFontFromFPE(client, c, fpe, &pfont);
+        if (err == FontNameAlias) {
             if (--aliascount <= 0) {
                 /* We've tried resolving this alias 20 times, we're
                  * probably stuck in an infinite loop of aliases pointing
@@ -314,13 +995,18 @@ doOpenFont(ClientPtr client, OFclosurePtr c)
         if (err == Suspended) {
             if (!ClientIsAsleep(client))
                 ClientSleep(client, (ClientSleepProcPtr) doOpenFont, c);
-            else
+            else if (c->thread_state != FontThreadResumed)
                 goto xinerama_sleep;
             return TRUE;
         }
         break;
     }
 
+#ifdef FONT_THREAD
+    if (err == Successful && pfont)
+        UndeferFontClose(pfont);
+ opened:
+#endif
     if (err != Successful)
         goto bail;
     if (!pfont) {
@@ -364,12 +1050,7 @@ doOpenFont(ClientPtr client, OFclosurePtr c)
     }
     ClientWakeup(c->client);
  xinerama_sleep:
-    for (i = 0; i < c->num_fpes; i++) {
-        FreeFPE(c->fpe_list[i]);
-    }
-    free(c->fpe_list);
-    free((void *) c->fontname);
-    free(c);
+    FreeOpenFontClosure(c);
     return TRUE;
 }
 
@@ -442,6 +1123,7 @@ OpenFont(ClientPtr client, XID fid, Mask flags, unsigned lenfname,
     c->fnamelen = lenfname;
     c->flags = flags;
     c->non_cachable_font = cached;
+    c->thread_state = FontThreadNone;
 
     (void) doOpenFont(client, c);
     return Success;
@@ -465,6 +1147,7 @@ CloseFont(void *value, XID fid)
     if (--pfont->refcnt == 0) {
         if (patternCache)
             RemoveCachedFontPattern(patternCache, pfont);
+        FreeGlyphIndexCache(pfont);
         /*
          * since the last reference is gone, ask each screen to free any
          * storage it may have allocated locally for it.
@@ -480,7 +1163,17 @@ CloseFont(void *value, XID fid)
         XF86BigfontFreeFontShm(pfont);
 #endif
         fpe = pfont->fpe;
+#ifdef FONT_THREAD
+        if (fontThreadPending) {
+            /* if this fails, leak the font rather than free it under the
+             * thread */
+            (void) DeferFontClose(pfont);
+            return Success;
+        }
+#endif
+        LockFontLibrary();
         (*fpe_functions[fpe->type].close_font) (fpe, pfont);
+        UnlockFontLibrary();
         FreeFPE(fpe);
     }
     return Success;
@@ -540,8 +1233,10 @@ QueryFont(FontPtr pFont, xQueryFontReply * pReply, int nProtoCCIStructs)
             chars[i++] = r;
             chars[i++] = c;
         }
+        LockFontLibrary();
         (*pFont->get_metrics) (pFont, ncols, chars,
                                TwoD16Bit, &count, charInfos);
+        UnlockFontLibrary();
         i = 0;
         for (i = 0; i < (int) count && ninfos < nProtoCCIStructs; i++) {
             *prCI = *charInfos[i];
@@ -568,6 +1263,7 @@ doListFontsAndAliases(ClientPtr client, LFclosurePtr c)
     char *bufferStart;
     int aliascount = 0;
 
+    LockFontLibrary();
     if (client->clientGone) {
         if (c->current.current_fpe < c->num_fpes) {
             fpe = c->fpe_list[c->current.current_fpe];
@@ -598,6 +1294,9 @@ doListFontsAndAliases(ClientPtr client, LFclosurePtr c)
                                 (ClientSleepProcPtr) doListFontsAndAliases, c);
                 else
                     goto xinerama_sleep;
+                /* a reply that had to wait for an FPE is not cached */
+                c->cacheGeneration = 0;
+                UnlockFontLibrary();
                 return TRUE;
             }
 
@@ -625,6 +1324,8 @@ doListFontsAndAliases(ClientPtr client, LFclosurePtr c)
                                     c);
                     else
                         goto xinerama_sleep;
+                    c->cacheGeneration = 0;
+                    UnlockFontLibrary();
                     return TRUE;
                 }
                 if (err == Successful)
@@ -644,6 +1345,8 @@ doListFontsAndAliases(ClientPtr client, LFclosurePtr c)
                                     c);
                     else
                         goto xinerama_sleep;
+                    c->cacheGeneration = 0;
+                    UnlockFontLibrary();
                     return TRUE;
                 }
                 if (err == FontNameAlias) {
@@ -780,10 +1483,10 @@ doListFontsAndAliases(ClientPtr client, LFclosurePtr c)
         }
     }
     nnames = reply.nFonts;
-    reply.length = bytes_to_int32(stringLens + nnames);
-    client->pSwapReplyFunc = ReplySwapVector[X_ListFonts];
-    WriteSwappedDataToClient(client, sizeof(xListFontsReply), &reply);
-    WriteToClient(client, stringLens + nnames, bufferStart);
+    if (c->cacheGeneration == fontPathGeneration)
+        ListFontsCacheStore(&c->request, nnames, stringLens + nnames,
+                            bufferStart);
+    ListFontsWriteReply(client, nnames, stringLens + nnames, bufferStart);
     free(bufferStart);
 
  bail:
@@ -796,6 +1499,7 @@ doListFontsAndAliases(ClientPtr client, LFclosurePtr c)
     FreeFontNames(names);
     free(c);
     free(resolved);
+    UnlockFontLibrary();
     return TRUE;
 }
 
@@ -805,6 +1509,9 @@ ListFonts(ClientPtr client, unsigned char *pattern, unsigned length,
 {
     int i;
     LFclosurePtr c;
+    LFWIstateRec request;
+    ListFontsCacheEntryPtr entry;
+    Bool cacheable;
 
     /* 
      * The right error to return here would be BadName, however the
@@ -815,10 +1522,22 @@ ListFonts(ClientPtr client, unsigned char *pattern, unsigned length,
     if (length > XLFDMAXFONTNAMELEN)
         return BadAlloc;
 
-    i = XaceHook(XACE_SERVER_ACCESS, client, DixGetAttrAccess);
+    i = XaceHookServerAccess(client, DixGetAttrAccess);
     if (i != Success)
         return i;
 
+    cacheable = ListFontsCacheable();
+    if (cacheable) {
+        memmove(request.pattern, pattern, length);
+        request.patlen = length;
+        request.max_names = max_names;
+        if ((entry = ListFontsCacheLookup(&request))) {
+            ListFontsWriteReply(client, entry->nnames, entry->length,
+                                entry->data);
+            return Success;
+        }
+    }
+
     if (!(c = malloc(sizeof *c)))
         return BadAlloc;
     c->fpe_list = malloc(sizeof(FontPathElementPtr) * num_fpes);
@@ -846,6 +1565,11 @@ ListFonts(ClientPtr client, unsigned char *pattern, unsigned length,
     c->current.private = 0;
     c->haveSaved = FALSE;
     c->savedName = 0;
+    c->cacheGeneration = 0;
+    if (cacheable) {
+        c->request = request;
+        c->cacheGeneration = fontPathGeneration;
+    }
     doListFontsAndAliases(client, c);
     return Success;
 }
@@ -866,6 +1590,7 @@ doListFontsWithInfo(ClientPtr client, LFWIclosurePtr c)
     int aliascount = 0;
     xListFontsWithInfoReply finalReply;
 
+    LockFontLibrary();
     if (client->clientGone) {
         if (c->current.current_fpe < c->num_fpes) {
             fpe = c->fpe_list[c->current.current_fpe];
@@ -890,6 +1615,7 @@ doListFontsWithInfo(ClientPtr client, LFWIclosurePtr c)
                                 (ClientSleepProcPtr) doListFontsWithInfo, c);
                 else
                     goto xinerama_sleep;
+                UnlockFontLibrary();
                 return TRUE;
             }
             if (err == Successful)
@@ -907,6 +1633,7 @@ doListFontsWithInfo(ClientPtr client, LFWIclosurePtr c)
                                 (ClientSleepProcPtr) doListFontsWithInfo, c);
                 else
                     goto xinerama_sleep;
+                UnlockFontLibrary();
                 return TRUE;
             }
         }
@@ -1047,6 +1774,7 @@ doListFontsWithInfo(ClientPtr client, LFWIclosurePtr c)
     free(c->fpe_list);
     free(c->savedName);
     free(c);
+    UnlockFontLibrary();
     return TRUE;
 }
 
@@ -1066,7 +1794,7 @@ StartListFontsWithInfo(ClientPtr client, int length, unsigned char *pattern,
     if (length > XLFDMAXFONTNAMELEN)
         return BadAlloc;
 
-    i = XaceHook(XACE_SERVER_ACCESS, client, DixGetAttrAccess);
+    i = XaceHookServerAccess(client, DixGetAttrAccess);
     if (i != Success)
         return i;
 
@@ -1118,7 +1846,9 @@ doPolyText(ClientPtr client, PTclosurePtr c)
 
     if (client->clientGone) {
         fpe = c->pGC->font->fpe;
+        LockFontLibrary();
         (*fpe_functions[fpe->type].client_died) ((void *) client, fpe);
+        UnlockFontLibrary();
 
         if (ClientIsAsleep(client)) {
             /* Client has died, but we cannot bail out right now.  We
@@ -1144,7 +1874,9 @@ doPolyText(ClientPtr client, PTclosurePtr c)
                the FPE code to clean up after client and avoid further
                rendering while we clean up after ourself.  */
             fpe = c->pGC->font->fpe;
+            LockFontLibrary();
             (*fpe_functions[fpe->type].client_died) ((void *) client, fpe);
+            UnlockFontLibrary();
             c->pDraw = (DrawablePtr) 0;
         }
     }
@@ -1399,7 +2131,9 @@ doImageText(ClientPtr client, ITclosurePtr c)
 
     if (client->clientGone) {
         fpe = c->pGC->font->fpe;
+        LockFontLibrary();
         (*fpe_functions[fpe->type].client_died) ((void *) client, fpe);
+        UnlockFontLibrary();
         err = Success;
         goto bail;
     }
@@ -1413,7 +2147,9 @@ doImageText(ClientPtr client, ITclosurePtr c)
             /* Our drawable has disappeared.  Treat like client died... ask
                the FPE code to clean up after client. */
             fpe = c->pGC->font->fpe;
+            LockFontLibrary();
             (*fpe_functions[fpe->type].client_died) ((void *) client, fpe);
+            UnlockFontLibrary();
             err = Success;
             goto bail;
         }
@@ -1541,11 +2277,13 @@ DetermineFPEType(const char *pathname)
 {
     int i;
 
+    LockFontLibrary();
     for (i = 0; i < num_fpe_types; i++) {
         if ((*fpe_functions[i].name_check) (pathname))
-            return i;
+            break;
     }
-    return -1;
+    UnlockFontLibrary();
+    return i < num_fpe_types ? i : -1;
 }
 
 static void
@@ -1602,10 +2340,13 @@ SetFontPathElements(int npaths, unsigned char *paths, int *bad, Bool persist)
         *bad = 0;
         return BadAlloc;
     }
+    ListFontsCacheInvalidate();
+    LockFontLibrary();
     for (i = 0; i < num_fpe_types; i++) {
         if (fpe_functions[i].set_path_hook)
             (*fpe_functions[i].set_path_hook) ();
     }
+    UnlockFontLibrary();
     for (i = 0; i < npaths; i++) {
         len = (unsigned int) (*cp++);
 
@@ -1623,7 +2364,9 @@ SetFontPathElements(int npaths, unsigned char *paths, int *bad, Bool persist)
              */
             fpe = find_existing_fpe(font_path_elements, num_fpes, cp, len);
             if (fpe) {
+                LockFontLibrary();
                 err = (*fpe_functions[fpe->type].reset_fpe) (fpe);
+                UnlockFontLibrary();
                 if (err == Successful) {
                     UseFPE(fpe);        /* since it'll be decref'd later when freed
                                          * from the old list */
@@ -1654,8 +2397,11 @@ SetFontPathElements(int npaths, unsigned char *paths, int *bad, Bool persist)
                 fpe->type = DetermineFPEType(fpe->name);
                 if (fpe->type == -1)
                     err = BadValue;
-                else
+                else {
+                    LockFontLibrary();
                     err = (*fpe_functions[fpe->type].init_fpe) (fpe);
+                    UnlockFontLibrary();
+                }
                 if (err != Successful) {
                     if (persist) {
                         ErrorF
@@ -1695,7 +2441,7 @@ SetFontPathElements(int npaths, unsigned char *paths, int *bad, Bool persist)
 int
 SetFontPath(ClientPtr client, int npaths, unsigned char *paths)
 {
-    int err = XaceHook(XACE_SERVER_ACCESS, client, DixManageAccess);
+    int err = XaceHookServerAccess(client, DixManageAccess);
 
     if (err != Success)
         return err;
@@ -1783,7 +2529,7 @@ GetFontPath(ClientPtr client, int *count, int *length, unsigned char **result)
     int len;
     FontPathElementPtr fpe;
 
-    i = XaceHook(XACE_SERVER_ACCESS, client, DixGetAttrAccess);
+    i = XaceHookServerAccess(client, DixGetAttrAccess);
     if (i != Success)
         return i;
 
@@ -1819,17 +2565,31 @@ DeleteClientFontStuff(ClientPtr client)
     int i;
     FontPathElementPtr fpe;
 
+    LockFontLibrary();
     for (i = 0; i < num_fpes; i++) {
         fpe = font_path_elements[i];
         if (fpe_functions[fpe->type].client_died)
             (*fpe_functions[fpe->type].client_died) ((void *) client, fpe);
     }
+    UnlockFontLibrary();
 }
 
 void
 InitFonts(void)
 {
+#ifdef FONT_THREAD
+    if (!fontLibraryLockInitialized) {
+        pthread_mutexattr_t attr;
+
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+        pthread_mutex_init(&fontLibraryLock, &attr);
+        pthread_mutexattr_destroy(&attr);
+        fontLibraryLockInitialized = TRUE;
+    }
+#endif
     patternCache = MakeFontPatternCache();
+    glyphIndexCachePrivate = AllocateFontPrivateIndex();
 
     register_fpe_functions();
 }
@@ -1923,10 +2683,18 @@ RegisterFPEFunctions(NameCheckFunc name_func,
 void
 FreeFonts(void)
 {
+#ifdef FONT_THREAD
+    FontThreadStop();
+#endif
     if (patternCache) {
         FreeFontPatternCache(patternCache);
         patternCache = 0;
     }
+    LogMessageVerb(X_INFO, 3, "ListFonts cache: %lu hits, %lu misses; "
+                   "glyph index cache: %lu hits, %lu misses\n",
+                   listFontsCacheHits, listFontsCacheMisses,
+                   glyphIndexCacheHits, glyphIndexCacheMisses);
+    ListFontsCacheInvalidate();
     FreeFontPath(font_path_elements, num_fpes, TRUE);
     font_path_elements = 0;
     num_fpes = 0;
@@ -1976,6 +2744,16 @@ client_auth_generation(ClientPtr client)
 
 static int fs_handlers_installed = 0;
 static unsigned int last_server_gen;
+static BlockHandlerProcPtr fs_block_handler;
+
+/* the font server's block handler, called holding the font library lock */
+static void
+FontBlockHandler(void *data, OSTimePtr pTimeout, void *pReadmask)
+{
+    LockFontLibrary();
+    (*fs_block_handler) (data, pTimeout, pReadmask);
+    UnlockFontLibrary();
+}
 
 _X_EXPORT
 int
@@ -1987,7 +2765,8 @@ init_fs_handlers(FontPathElementPtr fpe, BlockHandlerProcPtr block_handler)
         fs_handlers_installed = 0;
     }
     if (fs_handlers_installed == 0) {
-        if (!RegisterBlockAndWakeupHandlers(block_handler,
+        fs_block_handler = block_handler;
+        if (!RegisterBlockAndWakeupHandlers(FontBlockHandler,
                                             FontWakeup, (void *) 0))
             return AllocError;
         fs_handlers_installed++;
@@ -2004,7 +2783,7 @@ remove_fs_handlers(FontPathElementPtr fpe, BlockHandlerProcPtr block_handler,
     if (all) {
         /* remove the handlers if no one else is using them */
         if (--fs_handlers_installed == 0) {
-            RemoveBlockAndWakeupHandlers(block_handler, FontWakeup,
+            RemoveBlockAndWakeupHandlers(FontBlockHandler, FontWakeup,
                                          (void *) 0);
         }
     }
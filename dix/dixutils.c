@@ -271,7 +271,7 @@ dixLookupClient(ClientPtr *pClient, XID rid, ClientPtr client, Mask access)
     if (rc != Success)
         goto bad;
 
-    rc = XaceHook(XACE_CLIENT_ACCESS, client, clients[clientIndex], access);
+    rc = XaceHookClientAccess(client, clients[clientIndex], access);
     if (rc != Success)
         goto bad;
 
@@ -612,9 +612,15 @@ Bool
 ClientSignal(ClientPtr client)
 {
     SleepQueuePtr q;
+    WorkQueuePtr w;
 
     for (q = sleepQueue; q; q = q->next)
         if (q->client == client) {
+            /* signalled already, e.g. just before the client went away */
+            for (w = workQueue; w; w = w->next)
+                if (w->client == client && w->function == q->function &&
+                    w->closure == q->closure)
+                    return TRUE;
             return QueueWorkProc(q->function, q->client, q->closure);
         }
     return FALSE;
@@ -53,12 +53,18 @@
 
 static int countValuators(DeviceEvent *ev, int *first);
 static int getValuatorEvents(DeviceEvent *ev, deviceValuator * xv);
-static int eventToKeyButtonPointer(DeviceEvent *ev, xEvent **xi, int *count);
-static int eventToDeviceChanged(DeviceChangedEvent *ev, xEvent **dcce);
-static int eventToDeviceEvent(DeviceEvent *ev, xEvent **xi);
-static int eventToRawEvent(RawDeviceEvent *ev, xEvent **xi);
-static int eventToBarrierEvent(BarrierEvent *ev, xEvent **xi);
-static int eventToTouchOwnershipEvent(TouchOwnershipEvent *ev, xEvent **xi);
+static int eventToKeyButtonPointer(DeviceEvent *ev, xEvent **xi, int *count,
+                                   EventConvertArenaPtr arena);
+static int eventToDeviceChanged(DeviceChangedEvent *ev, xEvent **dcce,
+                                EventConvertArenaPtr arena);
+static int eventToDeviceEvent(DeviceEvent *ev, xEvent **xi,
+                              EventConvertArenaPtr arena);
+static int eventToRawEvent(RawDeviceEvent *ev, xEvent **xi,
+                           EventConvertArenaPtr arena);
+static int eventToBarrierEvent(BarrierEvent *ev, xEvent **xi,
+                               EventConvertArenaPtr arena);
+static int eventToTouchOwnershipEvent(TouchOwnershipEvent *ev, xEvent **xi,
+                                      EventConvertArenaPtr arena);
 
 /* Do not use, read comments below */
 BOOL EventIsKeyRepeat(xEvent *event);
@@ -88,6 +94,92 @@ EventIsKeyRepeat(xEvent *event)
     return ! !event->u.u.sequenceNumber;
 }
 
+/**
+ * Get zeroed storage for a converted event.  With an arena, a free slot
+ * is claimed and grown if it is too small; without one, or when all slots
+ * are busy, the storage is allocated.  Either way it is released with
+ * FreeConvertedEvent().
+ */
+static void *
+AllocConvertedEvent(EventConvertArenaPtr arena, size_t len)
+{
+    int i;
+
+    for (i = 0; arena && i < EVENT_CONVERT_SLOTS; i++) {
+        void *data;
+        size_t size;
+
+        if (arena->slot[i].inuse)
+            continue;
+        if (arena->slot[i].size < len) {
+            /* grow geometrically so sizes settle quickly */
+            size = max(len, 2 * arena->slot[i].size);
+            data = malloc(size);
+            if (!data)
+                break;
+            free(arena->slot[i].data);
+            arena->slot[i].data = data;
+            arena->slot[i].size = size;
+        }
+        memset(arena->slot[i].data, 0, len);
+        arena->slot[i].inuse = TRUE;
+        return arena->slot[i].data;
+    }
+
+    return calloc(1, len);
+}
+
+/**
+ * Release an event returned by one of the EventTo*Arena() conversions,
+ * or by EventToCore(), EventToXI() or EventToXI2() if arena is NULL.
+ */
+void
+FreeConvertedEvent(EventConvertArenaPtr arena, xEvent *event)
+{
+    int i;
+
+    for (i = 0; arena && i < EVENT_CONVERT_SLOTS; i++) {
+        if (arena->slot[i].inuse && arena->slot[i].data == event) {
+            arena->slot[i].inuse = FALSE;
+            return;
+        }
+    }
+    free(event);
+}
+
+/**
+ * Free the storage held by the arena.  None of its slots may be in use.
+ */
+void
+FreeEventConvertArena(EventConvertArenaPtr arena)
+{
+    int i;
+
+    for (i = 0; i < EVENT_CONVERT_SLOTS; i++) {
+        BUG_WARN(arena->slot[i].inuse);
+        free(arena->slot[i].data);
+    }
+    memset(arena, 0, sizeof(*arena));
+}
+
+int
+EventToCore(InternalEvent *event, xEvent **core, int *count)
+{
+    return EventToCoreArena(event, core, count, NULL);
+}
+
+int
+EventToXI(InternalEvent *ev, xEvent **xi, int *count)
+{
+    return EventToXIArena(ev, xi, count, NULL);
+}
+
+int
+EventToXI2(InternalEvent *ev, xEvent **xi)
+{
+    return EventToXI2Arena(ev, xi, NULL);
+}
+
 /**
  * Convert the given event to the respective core event.
  *
@@ -98,10 +190,12 @@ EventIsKeyRepeat(xEvent *event)
  *
  * @param[in] event The event to convert into a core event.
  * @param[in] core The memory location to store the core event at.
+ * @param[in] arena Storage to reuse for core, or NULL to allocate it.
  * @return Success or the matching error code.
  */
 int
-EventToCore(InternalEvent *event, xEvent **core_out, int *count_out)
+EventToCoreArena(InternalEvent *event, xEvent **core_out, int *count_out,
+                 EventConvertArenaPtr arena)
 {
     xEvent *core = NULL;
     int count = 0;
@@ -132,7 +226,7 @@ EventToCore(InternalEvent *event, xEvent **core_out, int *count_out)
             goto out;
         }
 
-        core = calloc(1, sizeof(*core));
+        core = AllocConvertedEvent(arena, sizeof(*core));
         if (!core)
             return BadAlloc;
         count = 1;
@@ -179,7 +273,8 @@ EventToCore(InternalEvent *event, xEvent **core_out, int *count_out)
 
 /**
  * Convert the given event to the respective XI 1.x event and store it in
- * xi. xi is allocated on demand and must be freed by the caller.
+ * xi. xi is taken from arena or allocated on demand and must be released
+ * by the caller with FreeConvertedEvent().
  * count returns the number of events in xi. If count is 1, and the type of
  * xi is GenericEvent, then xi may be larger than 32 bytes.
  *
@@ -191,11 +286,13 @@ EventToCore(InternalEvent *event, xEvent **core_out, int *count_out)
  * @param[in] ev The event to convert into an XI 1 event.
  * @param[out] xi Future memory location for the XI event.
  * @param[out] count Number of elements in xi.
+ * @param[in] arena Storage to reuse for xi, or NULL to allocate it.
  *
  * @return Success or the error code.
  */
 int
-EventToXI(InternalEvent *ev, xEvent **xi, int *count)
+EventToXIArena(InternalEvent *ev, xEvent **xi, int *count,
+               EventConvertArenaPtr arena)
 {
     switch (ev->any.type) {
     case ET_Motion:
@@ -205,7 +302,7 @@ EventToXI(InternalEvent *ev, xEvent **xi, int *count)
     case ET_KeyRelease:
     case ET_ProximityIn:
     case ET_ProximityOut:
-        return eventToKeyButtonPointer(&ev->device_event, xi, count);
+        return eventToKeyButtonPointer(&ev->device_event, xi, count, arena);
     case ET_DeviceChanged:
     case ET_RawKeyPress:
     case ET_RawKeyRelease:
@@ -234,7 +331,8 @@ EventToXI(InternalEvent *ev, xEvent **xi, int *count)
 
 /**
  * Convert the given event to the respective XI 2.x event and store it in xi.
- * xi is allocated on demand and must be freed by the caller.
+ * xi is taken from arena or allocated on demand and must be released by
+ * the caller with FreeConvertedEvent().
  *
  * Return values:
  * Success ... core contains the matching core event.
@@ -243,11 +341,12 @@ EventToXI(InternalEvent *ev, xEvent **xi, int *count)
  *
  * @param[in] ev The event to convert into an XI2 event
  * @param[out] xi Future memory location for the XI2 event.
+ * @param[in] arena Storage to reuse for xi, or NULL to allocate it.
  *
  * @return Success or the error code.
  */
 int
-EventToXI2(InternalEvent *ev, xEvent **xi)
+EventToXI2Arena(InternalEvent *ev, xEvent **xi, EventConvertArenaPtr arena)
 {
     switch (ev->any.type) {
         /* Enter/FocusIn are for grabs. We don't need an actual event, since
@@ -264,15 +363,16 @@ EventToXI2(InternalEvent *ev, xEvent **xi)
     case ET_TouchBegin:
     case ET_TouchUpdate:
     case ET_TouchEnd:
-        return eventToDeviceEvent(&ev->device_event, xi);
+        return eventToDeviceEvent(&ev->device_event, xi, arena);
     case ET_TouchOwnership:
-        return eventToTouchOwnershipEvent(&ev->touch_ownership_event, xi);
+        return eventToTouchOwnershipEvent(&ev->touch_ownership_event, xi,
+                                          arena);
     case ET_ProximityIn:
     case ET_ProximityOut:
         *xi = NULL;
         return BadMatch;
     case ET_DeviceChanged:
-        return eventToDeviceChanged(&ev->changed_event, xi);
+        return eventToDeviceChanged(&ev->changed_event, xi, arena);
     case ET_RawKeyPress:
     case ET_RawKeyRelease:
     case ET_RawButtonPress:
@@ -281,10 +381,10 @@ EventToXI2(InternalEvent *ev, xEvent **xi)
     case ET_RawTouchBegin:
     case ET_RawTouchUpdate:
     case ET_RawTouchEnd:
-        return eventToRawEvent(&ev->raw_event, xi);
+        return eventToRawEvent(&ev->raw_event, xi, arena);
     case ET_BarrierHit:
     case ET_BarrierLeave:
-        return eventToBarrierEvent(&ev->barrier_event, xi);
+        return eventToBarrierEvent(&ev->barrier_event, xi, arena);
     default:
         break;
     }
@@ -294,7 +394,8 @@ EventToXI2(InternalEvent *ev, xEvent **xi)
 }
 
 static int
-eventToKeyButtonPointer(DeviceEvent *ev, xEvent **xi, int *count)
+eventToKeyButtonPointer(DeviceEvent *ev, xEvent **xi, int *count,
+                        EventConvertArenaPtr arena)
 {
     int num_events;
     int first;                  /* dummy */
@@ -328,7 +429,7 @@ eventToKeyButtonPointer(DeviceEvent *ev, xEvent **xi, int *count)
 
     num_events++;               /* the actual event event */
 
-    *xi = calloc(num_events, sizeof(xEvent));
+    *xi = AllocConvertedEvent(arena, num_events * sizeof(xEvent));
     if (!(*xi)) {
         return BadAlloc;
     }
@@ -546,7 +647,8 @@ appendScrollInfo(DeviceChangedEvent *dce, xXIScrollInfo * info, int axisnumber)
 }
 
 static int
-eventToDeviceChanged(DeviceChangedEvent *dce, xEvent **xi)
+eventToDeviceChanged(DeviceChangedEvent *dce, xEvent **xi,
+                     EventConvertArenaPtr arena)
 {
     xXIDeviceChangedEvent *dcce;
     int len = sizeof(xXIDeviceChangedEvent);
@@ -575,7 +677,7 @@ eventToDeviceChanged(DeviceChangedEvent *dce, xEvent **xi)
         len += sizeof(CARD32) * nkeys;  /* keycodes */
     }
 
-    dcce = calloc(1, len);
+    dcce = AllocConvertedEvent(arena, len);
     if (!dcce) {
         ErrorF("[Xi] BadAlloc in SendDeviceChangedEvent.\n");
         return BadAlloc;
@@ -641,7 +743,7 @@ count_bits(unsigned char *ptr, int len)
 }
 
 static int
-eventToDeviceEvent(DeviceEvent *ev, xEvent **xi)
+eventToDeviceEvent(DeviceEvent *ev, xEvent **xi, EventConvertArenaPtr arena)
 {
     int len = sizeof(xXIDeviceEvent);
     xXIDeviceEvent *xde;
@@ -662,7 +764,7 @@ eventToDeviceEvent(DeviceEvent *ev, xEvent **xi)
     vallen = bytes_to_int32(bits_to_bytes(MAX_VALUATORS));
     len += vallen * 4;          /* valuators mask */
 
-    *xi = calloc(1, len);
+    *xi = AllocConvertedEvent(arena, len);
     xde = (xXIDeviceEvent *) * xi;
     xde->type = GenericEvent;
     xde->extension = IReqCode;
@@ -725,12 +827,13 @@ eventToDeviceEvent(DeviceEvent *ev, xEvent **xi)
 }
 
 static int
-eventToTouchOwnershipEvent(TouchOwnershipEvent *ev, xEvent **xi)
+eventToTouchOwnershipEvent(TouchOwnershipEvent *ev, xEvent **xi,
+                           EventConvertArenaPtr arena)
 {
     int len = sizeof(xXITouchOwnershipEvent);
     xXITouchOwnershipEvent *xtoe;
 
-    *xi = calloc(1, len);
+    *xi = AllocConvertedEvent(arena, len);
     xtoe = (xXITouchOwnershipEvent *) * xi;
     xtoe->type = GenericEvent;
     xtoe->extension = IReqCode;
@@ -746,7 +849,7 @@ eventToTouchOwnershipEvent(TouchOwnershipEvent *ev, xEvent **xi)
 }
 
 static int
-eventToRawEvent(RawDeviceEvent *ev, xEvent **xi)
+eventToRawEvent(RawDeviceEvent *ev, xEvent **xi, EventConvertArenaPtr arena)
 {
     xXIRawEvent *raw;
     int vallen, nvals;
@@ -760,7 +863,7 @@ eventToRawEvent(RawDeviceEvent *ev, xEvent **xi)
     vallen = bytes_to_int32(bits_to_bytes(MAX_VALUATORS));
     len += vallen * 4;          /* valuators mask */
 
-    *xi = calloc(1, len);
+    *xi = AllocConvertedEvent(arena, len);
     raw = (xXIRawEvent *) * xi;
     raw->type = GenericEvent;
     raw->extension = IReqCode;
@@ -790,12 +893,12 @@ eventToRawEvent(RawDeviceEvent *ev, xEvent **xi)
 }
 
 static int
-eventToBarrierEvent(BarrierEvent *ev, xEvent **xi)
+eventToBarrierEvent(BarrierEvent *ev, xEvent **xi, EventConvertArenaPtr arena)
 {
     xXIBarrierEvent *barrier;
     int len = sizeof(xXIBarrierEvent);
 
-    *xi = calloc(1, len);
+    *xi = AllocConvertedEvent(arena, len);
     barrier = (xXIBarrierEvent*) *xi;
     barrier->type = GenericEvent;
     barrier->extension = IReqCode;
@@ -153,6 +153,7 @@ typedef const char *string;
 #include "enterleave.h"
 #include "eventconvert.h"
 #include "mi.h"
+#include "syncsrv.h"
 
 /* Extension events type numbering starts at EXTENSION_EVENT_BASE.  */
 #define NoSuchEvent 0x80000000  /* so doesn't match NoEventMask */
@@ -1068,6 +1069,7 @@ NoticeTime(const DeviceIntPtr dev, TimeStamp time)
 
     LastEventTimeToggleResetFlag(dev->id, TRUE);
     LastEventTimeToggleResetFlag(XIAllDevices, TRUE);
+    SyncNoticeInputActivity(dev);
 }
 
 static void
@@ -2086,7 +2088,7 @@ DeliverToWindowOwner(DeviceIntPtr dev, WindowPtr win,
     if (IsInterferingGrab(wClient(win), dev, events))
         return EVENT_SKIP;
 
-    if (!XaceHook(XACE_RECEIVE_ACCESS, wClient(win), win, events, count)) {
+    if (!XaceHookReceiveAccess(wClient(win), win, events, count)) {
         int attempt = TryClientEvents(wClient(win), dev, events,
                                       count, win->eventMask,
                                       filter, grab);
@@ -2164,7 +2166,7 @@ DeliverEventToInputClients(DeviceIntPtr dev, InputClients * inputclients,
 
         mask = GetEventMask(dev, events, inputclients);
 
-        if (XaceHook(XACE_RECEIVE_ACCESS, client, win, events, count))
+        if (XaceHookReceiveAccess(client, win, events, count))
             /* do nothing */ ;
         else if ((attempt = TryClientEvents(client, dev,
                                             events, count,
@@ -2357,7 +2359,8 @@ DeliverRawEvent(RawDeviceEvent *ev, DeviceIntPtr device)
     int i, rc;
     int filter;
 
-    rc = EventToXI2((InternalEvent *) ev, (xEvent **) &xi);
+    rc = EventToXI2Arena((InternalEvent *) ev, (xEvent **) &xi,
+                         &device->convertArena);
     if (rc != Success) {
         ErrorF("[Xi] %s: XI2 conversion failed in %s (%d)\n",
                __func__, device->name, rc);
@@ -2396,7 +2399,7 @@ DeliverRawEvent(RawDeviceEvent *ev, DeviceIntPtr device)
         }
     }
 
-    free(xi);
+    FreeConvertedEvent(&device->convertArena, xi);
 }
 
 /* If the event goes to dontClient, don't send it and return 0.  if
@@ -2443,7 +2446,7 @@ MaybeDeliverEventsToClient(WindowPtr pWin, xEvent *pEvents,
             return XineramaTryClientEventsResult(wClient(pWin), NullGrab,
                                                  pWin->eventMask, filter);
 #endif
-        if (XaceHook(XACE_RECEIVE_ACCESS, wClient(pWin), pWin, pEvents, count))
+        if (XaceHookReceiveAccess(wClient(pWin), pWin, pEvents, count))
             return 1;           /* don't send, but pretend we did */
         return TryClientEvents(wClient(pWin), NULL, pEvents, count,
                                pWin->eventMask, filter, NullGrab);
@@ -2457,8 +2460,8 @@ MaybeDeliverEventsToClient(WindowPtr pWin, xEvent *pEvents,
                 return XineramaTryClientEventsResult(rClient(other), NullGrab,
                                                      other->mask, filter);
 #endif
-            if (XaceHook(XACE_RECEIVE_ACCESS, rClient(other), pWin, pEvents,
-                         count))
+            if (XaceHookReceiveAccess(rClient(other), pWin, pEvents,
+                                      count))
                 return 1;       /* don't send, but pretend we did */
             return TryClientEvents(rClient(other), NULL, pEvents, count,
                                    other->mask, filter, NullGrab);
@@ -2577,6 +2580,27 @@ FixUpEventFromWindow(SpritePtr pSprite,
     }
 }
 
+/**
+ * @return FALSE if neither win nor any of its ancestors can possibly want
+ * an event of type evtype from dev, TRUE if one of them may.
+ */
+static Bool
+EventMayPropagate(DeviceIntPtr dev, int evtype, WindowPtr win)
+{
+    int type;
+
+    if ((type = GetXI2Type(evtype)) != 0 &&
+        (win->xi2Deliverable & (1 << type)))
+        return TRUE;
+    if ((type = GetXIType(evtype)) != 0 &&
+        (win->xiDeliverable & event_get_filter_from_type(dev, type)))
+        return TRUE;
+    if ((type = GetCoreType(evtype)) != 0 &&
+        (win->deliverableEvents & event_get_filter_from_type(dev, type)))
+        return TRUE;
+    return FALSE;
+}
+
 /**
  * Check if a given event is deliverable at all on a given window.
  *
@@ -2642,7 +2666,7 @@ DeliverEvent(DeviceIntPtr dev, xEvent *xE, int count,
     Mask filter;
     int deliveries = 0;
 
-    if (XaceHook(XACE_SEND_ACCESS, NULL, dev, win, xE, count) == Success) {
+    if (XaceHookSendAccess(NULL, dev, win, xE, count) == Success) {
         filter = GetEventFilter(dev, xE);
         FixUpEventFromWindow(pSprite, xE, win, child, FALSE);
         deliveries = DeliverEventsToWindow(dev, win, xE, count, filter, grab);
@@ -2662,14 +2686,14 @@ DeliverOneEvent(InternalEvent *event, DeviceIntPtr dev, enum InputLevel level,
 
     switch (level) {
     case XI2:
-        rc = EventToXI2(event, &xE);
+        rc = EventToXI2Arena(event, &xE, &dev->convertArena);
         count = 1;
         break;
     case XI:
-        rc = EventToXI(event, &xE, &count);
+        rc = EventToXIArena(event, &xE, &count, &dev->convertArena);
         break;
     case CORE:
-        rc = EventToCore(event, &xE, &count);
+        rc = EventToCoreArena(event, &xE, &count, &dev->convertArena);
         break;
     default:
         rc = BadImplementation;
@@ -2678,7 +2702,7 @@ DeliverOneEvent(InternalEvent *event, DeviceIntPtr dev, enum InputLevel level,
 
     if (rc == Success) {
         deliveries = DeliverEvent(dev, xE, count, win, child, grab);
-        free(xE);
+        FreeConvertedEvent(&dev->convertArena, xE);
     }
     else
         BUG_WARN_MSG(rc != BadMatch,
@@ -2717,6 +2741,10 @@ DeliverDeviceEvents(WindowPtr pWin, InternalEvent *event, GrabPtr grab,
     verify_internal_event(event);
 
     while (pWin) {
+        /* nobody from here up is listening */
+        if (!EventMayPropagate(dev, event->any.type, pWin))
+            break;
+
         if ((mask = EventIsDeliverable(dev, event->any.type, pWin))) {
             /* XI2 events first */
             if (mask & EVENT_XI2_MASK) {
@@ -2835,18 +2863,23 @@ DeliverEvents(WindowPtr pWin, xEvent *xE, int count, WindowPtr otherParent)
     return deliveries;
 }
 
+/**
+ * Bumped whenever the windows under some position may have changed, which
+ * invalidates every sprite's XYToWindow cache.
+ */
+static unsigned long windowTreeStamp = 1;
+
 static Bool
-PointInBorderSize(WindowPtr pWin, int x, int y)
+PointInBorderSize(WindowPtr pWin, int x, int y, BoxPtr pBox)
 {
-    BoxRec box;
-
-    if (RegionContainsPoint(&pWin->borderSize, x, y, &box))
+    if (RegionContainsPoint(&pWin->borderSize, x, y, pBox))
         return TRUE;
 
 #ifdef PANORAMIX
     if (!noPanoramiXExtension &&
         XineramaSetWindowPntrs(inputInfo.pointer, pWin)) {
         SpritePtr pSprite = inputInfo.pointer->spriteInfo->sprite;
+        BoxRec box;
         int i;
 
         FOR_NSCREENS_FORWARD_SKIP(i) {
@@ -2854,14 +2887,225 @@ PointInBorderSize(WindowPtr pWin, int x, int y)
                                     x + screenInfo.screens[0]->x -
                                     screenInfo.screens[i]->x,
                                     y + screenInfo.screens[0]->y -
-                                    screenInfo.screens[i]->y, &box))
+                                    screenInfo.screens[i]->y, &box)) {
+                /* not worth translating back, only vouch for this point */
+                pBox->x1 = x;
+                pBox->y1 = y;
+                pBox->x2 = x + 1;
+                pBox->y2 = y + 1;
                 return TRUE;
+            }
         }
     }
 #endif
     return FALSE;
 }
 
+/*
+ * Parents with many mapped children get a grid over their border box,
+ * listing for each cell the children which overlap it, in stacking order.
+ * XYToWindow then only looks at the children in the cell under the
+ * pointer.  A grid is built the second time XYToWindow walks the same
+ * parent's children without the window tree changing in between, and is
+ * stale as soon as windowTreeStamp moves on.  That stamp already follows
+ * every map, unmap, configure, restack, reparent, shape change and
+ * deletion, so the grid needs no hooks of its own.
+ */
+#define XY_INDEX_MIN_CHILDREN	32      /* siblings walked before indexing */
+#define XY_INDEX_GRID		8       /* cells per side */
+#define XY_INDEX_CELLS		(XY_INDEX_GRID * XY_INDEX_GRID)
+#define XY_INDEX_ENTRIES	4       /* parents indexed at once */
+
+typedef struct _XYIndex {
+    WindowPtr parent;
+    unsigned long stamp;        /* windowTreeStamp the grid is for */
+    unsigned long walked;       /* windowTreeStamp of the last walk */
+    int x, y, width, height;    /* parent's border box */
+    int cellWidth, cellHeight;
+    int first[XY_INDEX_CELLS + 1];      /* each cell's run of children */
+    WindowPtr *children;
+    int size;
+} XYIndexRec, *XYIndexPtr;
+
+static XYIndexRec xyIndex[XY_INDEX_ENTRIES];
+static int xyIndexNext;         /* entry to reuse next */
+
+static XYIndexPtr
+XYIndexFind(WindowPtr pParent)
+{
+    int i;
+
+    for (i = 0; i < XY_INDEX_ENTRIES; i++) {
+        if (xyIndex[i].parent == pParent)
+            return &xyIndex[i];
+    }
+    return NULL;
+}
+
+/*
+ * Finds the cells a child's border box overlaps, as an inclusive range
+ * of columns and rows in pBox.  FALSE if it is outside the grid.
+ */
+static Bool
+XYIndexCells(XYIndexPtr index, WindowPtr pChild, BoxPtr pBox)
+{
+    int bw = wBorderWidth(pChild);
+    int x1 = max(pChild->drawable.x - bw, index->x);
+    int y1 = max(pChild->drawable.y - bw, index->y);
+    int x2 = min(pChild->drawable.x + (int) pChild->drawable.width + bw,
+                 index->x + index->width);
+    int y2 = min(pChild->drawable.y + (int) pChild->drawable.height + bw,
+                 index->y + index->height);
+
+    if (x1 >= x2 || y1 >= y2)
+        return FALSE;
+    pBox->x1 = (x1 - index->x) / index->cellWidth;
+    pBox->y1 = (y1 - index->y) / index->cellHeight;
+    pBox->x2 = (x2 - 1 - index->x) / index->cellWidth;
+    pBox->y2 = (y2 - 1 - index->y) / index->cellHeight;
+    return TRUE;
+}
+
+static void
+XYIndexBuild(XYIndexPtr index)
+{
+    WindowPtr pParent = index->parent, pChild;
+    int bw = wBorderWidth(pParent);
+    int pos[XY_INDEX_CELLS];
+    int cell, cx, cy, total = 0;
+    BoxRec box;
+
+    index->stamp = 0;
+    index->x = pParent->drawable.x - bw;
+    index->y = pParent->drawable.y - bw;
+    index->width = pParent->drawable.width + 2 * bw;
+    index->height = pParent->drawable.height + 2 * bw;
+    index->cellWidth = (index->width + XY_INDEX_GRID - 1) / XY_INDEX_GRID;
+    index->cellHeight = (index->height + XY_INDEX_GRID - 1) / XY_INDEX_GRID;
+    if (index->cellWidth <= 0 || index->cellHeight <= 0)
+        return;
+
+    memset(pos, 0, sizeof(pos));
+    for (pChild = pParent->firstChild; pChild; pChild = pChild->nextSib) {
+        if (!pChild->mapped || !XYIndexCells(index, pChild, &box))
+            continue;
+        for (cy = box.y1; cy <= box.y2; cy++)
+            for (cx = box.x1; cx <= box.x2; cx++)
+                pos[cy * XY_INDEX_GRID + cx]++;
+        total += (box.x2 - box.x1 + 1) * (box.y2 - box.y1 + 1);
+    }
+
+    if (total > index->size) {
+        WindowPtr *children = realloc(index->children,
+                                      total * sizeof(WindowPtr));
+
+        if (!children)
+            return;
+        index->children = children;
+        index->size = total;
+    }
+
+    /* pos[] goes from the counts to where the next child of a cell goes */
+    index->first[0] = 0;
+    for (cell = 0; cell < XY_INDEX_CELLS; cell++) {
+        index->first[cell + 1] = index->first[cell] + pos[cell];
+        pos[cell] = index->first[cell];
+    }
+    for (pChild = pParent->firstChild; pChild; pChild = pChild->nextSib) {
+        if (!pChild->mapped || !XYIndexCells(index, pChild, &box))
+            continue;
+        for (cy = box.y1; cy <= box.y2; cy++)
+            for (cx = box.x1; cx <= box.x2; cx++)
+                index->children[pos[cy * XY_INDEX_GRID + cx]++] = pChild;
+    }
+    index->stamp = windowTreeStamp;
+}
+
+/*
+ * Notes that XYToWindow walked many of pParent's children one by one,
+ * and indexes them if it did so before with the same window tree.
+ */
+static void
+XYIndexWalked(WindowPtr pParent)
+{
+    XYIndexPtr index = XYIndexFind(pParent);
+
+    if (!index) {
+        index = &xyIndex[xyIndexNext];
+        xyIndexNext = (xyIndexNext + 1) % XY_INDEX_ENTRIES;
+        index->parent = pParent;
+        index->stamp = 0;
+        index->walked = windowTreeStamp;
+    }
+    else if (index->walked != windowTreeStamp)
+        index->walked = windowTreeStamp;
+    else
+        XYIndexBuild(index);
+}
+
+typedef struct _XYCursor {
+    WindowPtr parent;
+    WindowPtr *cell;            /* rest of the grid cell, NULL for nextSib */
+    int left;                   /* children left in cell */
+    int walked;                 /* children looked at */
+} XYCursor;
+
+/*
+ * Starts looking at pParent's children for x/y, returning the first one.
+ * With a grid, only the children in the cell of x/y are looked at, and
+ * the hit rectangle is clipped to the cell, as the other children can't
+ * change what is under any point of it.
+ */
+static WindowPtr
+XYFirstChild(XYCursor *cursor, WindowPtr pParent, int x, int y,
+             int *x1, int *y1, int *x2, int *y2)
+{
+    XYIndexPtr index = XYIndexFind(pParent);
+    int cx, cy, cell;
+
+    cursor->parent = pParent;
+    cursor->cell = NULL;
+    cursor->walked = 0;
+    if (!index || index->stamp != windowTreeStamp ||
+        x < index->x || x >= index->x + index->width ||
+        y < index->y || y >= index->y + index->height)
+        return pParent->firstChild;
+
+    cx = (x - index->x) / index->cellWidth;
+    cy = (y - index->y) / index->cellHeight;
+    *x1 = max(*x1, index->x + cx * index->cellWidth);
+    *y1 = max(*y1, index->y + cy * index->cellHeight);
+    *x2 = min(*x2, index->x + (cx + 1) * index->cellWidth);
+    *y2 = min(*y2, index->y + (cy + 1) * index->cellHeight);
+
+    cell = cy * XY_INDEX_GRID + cx;
+    cursor->cell = &index->children[index->first[cell]];
+    cursor->left = index->first[cell + 1] - index->first[cell];
+    if (!cursor->left--)
+        return NullWindow;
+    return *cursor->cell++;
+}
+
+static WindowPtr
+XYNextChild(XYCursor *cursor, WindowPtr pWin)
+{
+    if (!cursor->cell) {
+        cursor->walked++;
+        return pWin->nextSib;
+    }
+    if (!cursor->left--)
+        return NullWindow;
+    return *cursor->cell++;
+}
+
+/* Ends looking at the children of cursor's parent */
+static void
+XYLastChild(XYCursor *cursor)
+{
+    if (!cursor->cell && cursor->walked >= XY_INDEX_MIN_CHILDREN)
+        XYIndexWalked(cursor->parent);
+}
+
 /**
  * Traversed from the root window to the window at the position x/y. While
  * traversing, it sets up the traversal history in the spriteTrace array.
@@ -2871,50 +3115,107 @@ PointInBorderSize(WindowPtr pWin, int x, int y)
  *       ...
  *   spriteTrace[spriteTraceGood - 1] ... window at x/y
  *
+ * On the way down, the area around x/y over which the same windows would
+ * have been picked is narrowed to a rectangle: each window passed over
+ * leaves the side of it that x/y is on, each window entered clips it to
+ * its extents (or the shape box x/y hit).  As long as the pointer stays in
+ * that rectangle and nothing in the window tree changes, the trace is
+ * reused without walking the tree again.  Parents with many children are
+ * indexed by a grid, see XYIndexRec.
+ *
  * @returns the window at the given coordinates.
  */
 WindowPtr
 XYToWindow(SpritePtr pSprite, int x, int y)
 {
-    WindowPtr pWin;
-    BoxRec box;
+    WindowPtr pWin, pParent;
+    XYCursor cursor;
+    BoxRec sbox, ibox;
+    int x1, y1, x2, y2;
+    int bw, wx1, wy1, wx2, wy2;
+
+    if (pSprite->hitStamp == windowTreeStamp &&
+        pSprite->spriteTraceGood > 0 &&
+        pSprite->hitRedirect == pSprite->redirectWindow &&
+        x >= pSprite->hitBox.x1 && x < pSprite->hitBox.x2 &&
+        y >= pSprite->hitBox.y1 && y < pSprite->hitBox.y2)
+        return DeepestSpriteWin(pSprite);
 
+    pSprite->hitStamp = 0;
     pSprite->spriteTraceGood = 1;       /* root window still there */
     if (pSprite->redirectWindow == PointerRootWin) {
         return RootWindow(pSprite);
     }
     else if (pSprite->redirectWindow) {
-        pWin = pSprite->redirectWindow;
-        pSprite->spriteTrace[pSprite->spriteTraceGood++] = pWin;
-        pWin = pWin->firstChild;
+        pParent = pSprite->redirectWindow;
+        pSprite->spriteTrace[pSprite->spriteTraceGood++] = pParent;
     }
     else
-        pWin = RootWindow(pSprite)->firstChild;
+        pParent = RootWindow(pSprite);
+
+    x1 = MINSHORT;
+    y1 = MINSHORT;
+    x2 = MAXSHORT;
+    y2 = MAXSHORT;
+    pWin = XYFirstChild(&cursor, pParent, x, y, &x1, &y1, &x2, &y2);
     while (pWin) {
-        if ((pWin->mapped) &&
-            (x >= pWin->drawable.x - wBorderWidth(pWin)) &&
-            (x < pWin->drawable.x + (int) pWin->drawable.width +
-             wBorderWidth(pWin)) &&
-            (y >= pWin->drawable.y - wBorderWidth(pWin)) &&
-            (y < pWin->drawable.y + (int) pWin->drawable.height +
-             wBorderWidth(pWin))
-            /* When a window is shaped, a further check
-             * is made to see if the point is inside
-             * borderSize
-             */
-            && (!wBoundingShape(pWin) || PointInBorderSize(pWin, x, y))
-            && (!wInputShape(pWin) ||
-                RegionContainsPoint(wInputShape(pWin),
-                                    x - pWin->drawable.x,
-                                    y - pWin->drawable.y, &box))
+        if (!pWin->mapped) {
+            pWin = XYNextChild(&cursor, pWin);
+            continue;
+        }
+
+        bw = wBorderWidth(pWin);
+        wx1 = pWin->drawable.x - bw;
+        wy1 = pWin->drawable.y - bw;
+        wx2 = pWin->drawable.x + (int) pWin->drawable.width + bw;
+        wy2 = pWin->drawable.y + (int) pWin->drawable.height + bw;
+
+        if (x < wx1)
+            x2 = min(x2, wx1);
+        else if (x >= wx2)
+            x1 = max(x1, wx2);
+        else if (y < wy1)
+            y2 = min(y2, wy1);
+        else if (y >= wy2)
+            y1 = max(y1, wy2);
+        /* When a window is shaped, a further check
+         * is made to see if the point is inside
+         * borderSize
+         */
+        else if (wBoundingShape(pWin) &&
+                 !PointInBorderSize(pWin, x, y, &sbox))
+            goto miss;
+        else if (wInputShape(pWin) &&
+                 !RegionContainsPoint(wInputShape(pWin),
+                                      x - pWin->drawable.x,
+                                      y - pWin->drawable.y, &ibox))
+            goto miss;
 #ifdef ROOTLESS
-            /* In rootless mode windows may be offscreen, even when
-             * they're in X's stack. (E.g. if the native window system
-             * implements some form of virtual desktop system).
-             */
-            && !pWin->rootlessUnhittable
+        /* In rootless mode windows may be offscreen, even when
+         * they're in X's stack. (E.g. if the native window system
+         * implements some form of virtual desktop system).
+         */
+        else if (pWin->rootlessUnhittable)
+            goto miss;
 #endif
-            ) {
+        else {
+            x1 = max(x1, wx1);
+            y1 = max(y1, wy1);
+            x2 = min(x2, wx2);
+            y2 = min(y2, wy2);
+            if (wBoundingShape(pWin)) {
+                x1 = max(x1, sbox.x1);
+                y1 = max(y1, sbox.y1);
+                x2 = min(x2, sbox.x2);
+                y2 = min(y2, sbox.y2);
+            }
+            if (wInputShape(pWin)) {
+                x1 = max(x1, pWin->drawable.x + ibox.x1);
+                y1 = max(y1, pWin->drawable.y + ibox.y1);
+                x2 = min(x2, pWin->drawable.x + ibox.x2);
+                y2 = min(y2, pWin->drawable.y + ibox.y2);
+            }
+
             if (pSprite->spriteTraceGood >= pSprite->spriteTraceSize) {
                 pSprite->spriteTraceSize += 10;
                 pSprite->spriteTrace = realloc(pSprite->spriteTrace,
@@ -2922,11 +3223,29 @@ XYToWindow(SpritePtr pSprite, int x, int y)
                                                sizeof(WindowPtr));
             }
             pSprite->spriteTrace[pSprite->spriteTraceGood++] = pWin;
-            pWin = pWin->firstChild;
+            XYLastChild(&cursor);
+            pWin = XYFirstChild(&cursor, pWin, x, y, &x1, &y1, &x2, &y2);
+            continue;
         }
-        else
-            pWin = pWin->nextSib;
-    }
+        pWin = XYNextChild(&cursor, pWin);
+        continue;
+
+ miss:
+        /* Inside the extents but not the shape: only this point is known */
+        x1 = x2 = x;
+        y1 = y2 = y;
+        x2++;
+        y2++;
+        pWin = XYNextChild(&cursor, pWin);
+    }
+    XYLastChild(&cursor);
+
+    pSprite->hitStamp = windowTreeStamp;
+    pSprite->hitRedirect = pSprite->redirectWindow;
+    pSprite->hitBox.x1 = x1;
+    pSprite->hitBox.y1 = y1;
+    pSprite->hitBox.x2 = min(x2, MAXSHORT);
+    pSprite->hitBox.y2 = min(y2, MAXSHORT);
     return DeepestSpriteWin(pSprite);
 }
 
@@ -3141,6 +3460,8 @@ WindowsRestructured(void)
 {
     DeviceIntPtr pDev = inputInfo.devices;
 
+    windowTreeStamp++;
+
     while (pDev) {
         if (IsMaster(pDev) || IsFloating(pDev))
             CheckMotion(NULL, pDev);
@@ -3164,6 +3485,8 @@ ReinitializeRootWindow(WindowPtr win, int xoff, int yoff)
     if (noPanoramiXExtension)
         return;
 
+    windowTreeStamp++;
+
     pDev = inputInfo.devices;
     while (pDev) {
         if (DevHasCursor(pDev)) {
@@ -3270,6 +3593,7 @@ InitializeSprite(DeviceIntPtr pDev, WindowPtr pWin)
 
         RootWindow(pDev->spriteInfo->sprite) = pWin;
         pSprite->spriteTraceGood = 1;
+        pSprite->hitStamp = 0;
 
         pSprite->pEnqueueScreen = pScreen;
         pSprite->pDequeueScreen = pSprite->pEnqueueScreen;
@@ -3280,6 +3604,7 @@ InitializeSprite(DeviceIntPtr pDev, WindowPtr pWin)
         pSprite->spriteTrace = NULL;
         pSprite->spriteTraceSize = 0;
         pSprite->spriteTraceGood = 0;
+        pSprite->hitStamp = 0;
         pSprite->pEnqueueScreen = screenInfo.screens[0];
         pSprite->pDequeueScreen = pSprite->pEnqueueScreen;
     }
@@ -3371,6 +3696,7 @@ UpdateSpriteForScreen(DeviceIntPtr pDev, ScreenPtr pScreen)
     pSprite->current = pCursor;
     pSprite->spriteTraceGood = 1;
     pSprite->spriteTrace[0] = win;
+    pSprite->hitStamp = 0;
     (*pScreen->CursorLimits) (pDev,
                               pScreen,
                               pSprite->current,
@@ -3582,7 +3908,7 @@ ProcWarpPointer(ClientPtr client)
 
     for (tmp = inputInfo.devices; tmp; tmp = tmp->next) {
         if (GetMaster(tmp, MASTER_ATTACHED) == dev) {
-            rc = XaceHook(XACE_DEVICE_ACCESS, client, dev, DixWriteAccess);
+            rc = XaceHookDeviceAccess(client, dev, DixWriteAccess);
             if (rc != Success)
                 return rc;
         }
@@ -3725,7 +4051,7 @@ ActivatePassiveGrab(DeviceIntPtr device, GrabPtr grab, InternalEvent *event,
     }
 
     if (grab->grabtype == CORE) {
-        rc = EventToCore(event, &xE, &count);
+        rc = EventToCoreArena(event, &xE, &count, &device->convertArena);
         if (rc != Success) {
             BUG_WARN_MSG(rc != BadMatch, "[dix] %s: core conversion failed"
                          "(%d, %d).\n", device->name, event->any.type, rc);
@@ -3733,7 +4059,7 @@ ActivatePassiveGrab(DeviceIntPtr device, GrabPtr grab, InternalEvent *event,
         }
     }
     else if (grab->grabtype == XI2) {
-        rc = EventToXI2(event, &xE);
+        rc = EventToXI2Arena(event, &xE, &device->convertArena);
         if (rc != Success) {
             if (rc != BadMatch)
                 BUG_WARN_MSG(rc != BadMatch, "[dix] %s: XI2 conversion failed"
@@ -3743,7 +4069,7 @@ ActivatePassiveGrab(DeviceIntPtr device, GrabPtr grab, InternalEvent *event,
         count = 1;
     }
     else {
-        rc = EventToXI(event, &xE, &count);
+        rc = EventToXIArena(event, &xE, &count, &device->convertArena);
         if (rc != Success) {
             if (rc != BadMatch)
                 BUG_WARN_MSG(rc != BadMatch, "[dix] %s: XI conversion failed"
@@ -3768,7 +4094,7 @@ ActivatePassiveGrab(DeviceIntPtr device, GrabPtr grab, InternalEvent *event,
         grabinfo->sync.state = FROZEN_WITH_EVENT;
     *grabinfo->sync.event = real_event->device_event;
 
-    free(xE);
+    FreeConvertedEvent(&device->convertArena, xE);
     return TRUE;
 }
 
@@ -4132,7 +4458,7 @@ DeliverFocusedEvent(DeviceIntPtr keybd, InternalEvent *event, WindowPtr window)
     /* just deliver it to the focus window */
     ptr = GetMaster(keybd, POINTER_OR_FLOAT);
 
-    rc = EventToXI2(event, &xi2);
+    rc = EventToXI2Arena(event, &xi2, &keybd->convertArena);
     if (rc == Success) {
         /* XXX: XACE */
         int filter = GetEventFilter(keybd, xi2);
@@ -4148,9 +4474,9 @@ DeliverFocusedEvent(DeviceIntPtr keybd, InternalEvent *event, WindowPtr window)
             ("[dix] %s: XI2 conversion failed in DFE (%d, %d). Skipping delivery.\n",
              keybd->name, event->any.type, rc);
 
-    rc = EventToXI(event, &xE, &count);
+    rc = EventToXIArena(event, &xE, &count, &keybd->convertArena);
     if (rc == Success &&
-        XaceHook(XACE_SEND_ACCESS, NULL, keybd, focus, xE, count) == Success) {
+        XaceHookSendAccess(NULL, keybd, focus, xE, count) == Success) {
         FixUpEventFromWindow(ptr->spriteInfo->sprite, xE, focus, None, FALSE);
         deliveries = DeliverEventsToWindow(keybd, focus, xE, count,
                                            GetEventFilter(keybd, xE), NullGrab);
@@ -4164,9 +4490,9 @@ DeliverFocusedEvent(DeviceIntPtr keybd, InternalEvent *event, WindowPtr window)
              keybd->name, event->any.type, rc);
 
     if (sendCore) {
-        rc = EventToCore(event, &core, &count);
+        rc = EventToCoreArena(event, &core, &count, &keybd->convertArena);
         if (rc == Success) {
-            if (XaceHook(XACE_SEND_ACCESS, NULL, keybd, focus, core, count) ==
+            if (XaceHookSendAccess(NULL, keybd, focus, core, count) ==
                 Success) {
                 FixUpEventFromWindow(keybd->spriteInfo->sprite, core, focus,
                                      None, FALSE);
@@ -4183,9 +4509,9 @@ DeliverFocusedEvent(DeviceIntPtr keybd, InternalEvent *event, WindowPtr window)
     }
 
  unwind:
-    free(core);
-    free(xE);
-    free(xi2);
+    FreeConvertedEvent(&keybd->convertArena, core);
+    FreeConvertedEvent(&keybd->convertArena, xE);
+    FreeConvertedEvent(&keybd->convertArena, xi2);
     return;
 }
 
@@ -4208,7 +4534,7 @@ DeliverOneGrabbedEvent(InternalEvent *event, DeviceIntPtr dev,
 
     switch (level) {
     case XI2:
-        rc = EventToXI2(event, &xE);
+        rc = EventToXI2Arena(event, &xE, &dev->convertArena);
         count = 1;
         if (rc == Success) {
             int evtype = xi2_get_type(xE);
@@ -4222,12 +4548,12 @@ DeliverOneGrabbedEvent(InternalEvent *event, DeviceIntPtr dev,
             mask = grab->deviceMask;
         else
             mask = grab->eventMask;
-        rc = EventToXI(event, &xE, &count);
+        rc = EventToXIArena(event, &xE, &count, &dev->convertArena);
         if (rc == Success)
             filter = GetEventFilter(dev, xE);
         break;
     case CORE:
-        rc = EventToCore(event, &xE, &count);
+        rc = EventToCoreArena(event, &xE, &count, &dev->convertArena);
         mask = grab->eventMask;
         if (rc == Success)
             filter = GetEventFilter(dev, xE);
@@ -4239,10 +4565,10 @@ DeliverOneGrabbedEvent(InternalEvent *event, DeviceIntPtr dev,
 
     if (rc == Success) {
         FixUpEventFromWindow(pSprite, xE, grab->window, None, TRUE);
-        if (XaceHook(XACE_SEND_ACCESS, 0, dev,
-                     grab->window, xE, count) ||
-            XaceHook(XACE_RECEIVE_ACCESS, rClient(grab),
-                     grab->window, xE, count))
+        if (XaceHookSendAccess(0, dev,
+                               grab->window, xE, count) ||
+            XaceHookReceiveAccess(rClient(grab),
+                                  grab->window, xE, count))
             deliveries = 1;     /* don't send, but pretend we did */
         else if (level != CORE || !IsInterferingGrab(rClient(grab), dev, xE)) {
             deliveries = TryClientEvents(rClient(grab), dev,
@@ -4254,7 +4580,7 @@ DeliverOneGrabbedEvent(InternalEvent *event, DeviceIntPtr dev,
                      "%s: conversion to mode %d failed on %d with %d\n",
                      dev->name, level, event->any.type, rc);
 
-    free(xE);
+    FreeConvertedEvent(&dev->convertArena, xE);
     return deliveries;
 }
 
@@ -4411,6 +4737,7 @@ RecalculateDeliverableEvents(WindowPtr pWin)
             pChild->deliverableEvents |=
                 (pChild->parent->deliverableEvents &
                  ~wDontPropagateMask(pChild) & PropagateMask);
+        RecalculateInputInterest(pChild);
         if (pChild->firstChild) {
             pChild = pChild->firstChild;
             continue;
@@ -4423,6 +4750,48 @@ RecalculateDeliverableEvents(WindowPtr pWin)
     }
 }
 
+#if XI2LASTEVENT >= 32
+#error "XI2 event types no longer fit into xi2Deliverable"
+#endif
+
+/**
+ * Fold the XI and XI2 selections of all clients for all devices on pWin
+ * into what its parent has collected from further up the tree.  Unlike
+ * the deliverableEvents masks, these ignore do-not-propagate masks; they
+ * only need to be a superset, to tell that no window from pWin up to the
+ * root wants an event.
+ *
+ * The parent's masks must be up to date.
+ */
+void
+RecalculateInputInterest(WindowPtr pWin)
+{
+    OtherInputMasks *inputMasks = wOtherInputMasks(pWin);
+    Mask xi = 0, xi2 = 0;
+    int i, j, size;
+
+    if (inputMasks) {
+        for (i = 0; i < EMASKSIZE; i++)
+            xi |= inputMasks->inputEvents[i];
+
+        size = min(xi2mask_mask_size(inputMasks->xi2mask), sizeof(Mask));
+        for (i = 0; i < xi2mask_num_masks(inputMasks->xi2mask); i++) {
+            const unsigned char *m =
+                xi2mask_get_one_mask(inputMasks->xi2mask, i);
+
+            for (j = 0; j < size; j++)
+                xi2 |= (Mask) m[j] << (8 * j);
+        }
+    }
+
+    if (pWin->parent) {
+        xi |= pWin->parent->xiDeliverable;
+        xi2 |= pWin->parent->xi2Deliverable;
+    }
+    pWin->xiDeliverable = xi;
+    pWin->xi2Deliverable = xi2;
+}
+
 /**
  *
  *  \param value must conform to DeleteType
@@ -4465,8 +4834,9 @@ EventSelectForWindow(WindowPtr pWin, ClientPtr client, Mask mask)
     }
     check = (mask & ManagerMask);
     if (check) {
-        rc = XaceHook(XACE_RESOURCE_ACCESS, client, pWin->drawable.id,
-                      RT_WINDOW, pWin, RT_NONE, NULL, DixManageAccess);
+        rc = XaceHookResourceAccess(client, pWin->drawable.id,
+                                    RT_WINDOW, pWin, RT_NONE, NULL,
+                                    DixManageAccess);
         if (rc != Success)
             return rc;
     }
@@ -4639,7 +5009,7 @@ CoreEnterLeaveEvent(DeviceIntPtr mouse,
         ClientPtr client = grab ? rClient(grab) : wClient(pWin);
         int rc;
 
-        rc = XaceHook(XACE_DEVICE_ACCESS, client, keybd, DixReadAccess);
+        rc = XaceHookDeviceAccess(client, keybd, DixReadAccess);
         if (rc == Success)
             memcpy((char *) &ke.map[0], (char *) &keybd->key->down[1], 31);
 
@@ -4750,7 +5120,7 @@ CoreFocusEvent(DeviceIntPtr dev, int type, int mode, int detail, WindowPtr pWin)
         ClientPtr client = wClient(pWin);
         int rc;
 
-        rc = XaceHook(XACE_DEVICE_ACCESS, client, dev, DixReadAccess);
+        rc = XaceHookDeviceAccess(client, dev, DixReadAccess);
         if (rc == Success)
             memcpy((char *) &ke.map[0], (char *) &dev->key->down[1], 31);
 
@@ -4813,7 +5183,7 @@ SetInputFocus(ClientPtr client,
         if (!focusWin->realized)
             return BadMatch;
     }
-    rc = XaceHook(XACE_DEVICE_ACCESS, client, dev, DixSetFocusAccess);
+    rc = XaceHookDeviceAccess(client, dev, DixSetFocusAccess);
     if (rc != Success)
         return Success;
 
@@ -4891,7 +5261,7 @@ ProcGetInputFocus(ClientPtr client)
     /* REQUEST(xReq); */
     REQUEST_SIZE_MATCH(xReq);
 
-    rc = XaceHook(XACE_DEVICE_ACCESS, client, kbd, DixGetFocusAccess);
+    rc = XaceHookDeviceAccess(client, kbd, DixGetFocusAccess);
     if (rc != Success)
         return rc;
 
@@ -5124,7 +5494,7 @@ GrabDevice(ClientPtr client, DeviceIntPtr dev,
 
     if (keyboard_mode == GrabModeSync || pointer_mode == GrabModeSync)
         access_mode |= DixFreezeAccess;
-    rc = XaceHook(XACE_DEVICE_ACCESS, client, dev, access_mode);
+    rc = XaceHookDeviceAccess(client, dev, access_mode);
     if (rc != Success)
         return rc;
 
@@ -5262,7 +5632,7 @@ ProcQueryPointer(ClientPtr client)
     rc = dixLookupWindow(&pWin, stuff->id, client, DixGetAttrAccess);
     if (rc != Success)
         return rc;
-    rc = XaceHook(XACE_DEVICE_ACCESS, client, mouse, DixReadAccess);
+    rc = XaceHookDeviceAccess(client, mouse, DixReadAccess);
     if (rc != Success && rc != BadAccess)
         return rc;
 
@@ -5342,6 +5712,8 @@ InitEvents(void)
         DeviceIntRec dummy;
         memcpy(&event_filters[i], default_filter, sizeof(default_filter));
 
+        /* no idle_counter, so SYNC's idle timers aren't touched */
+        memset(&dummy, 0, sizeof(dummy));
         dummy.id = i;
         NoticeTime(&dummy, currentTime);
         LastEventTimeToggleResetFlag(i, FALSE);
@@ -5458,8 +5830,8 @@ ProcSendEvent(ClientPtr client)
     stuff->event.u.u.type |= SEND_EVENT_BIT;
     if (stuff->propagate) {
         for (; pWin; pWin = pWin->parent) {
-            if (XaceHook(XACE_SEND_ACCESS, client, NULL, pWin,
-                         &stuff->event, 1))
+            if (XaceHookSendAccess(client, NULL, pWin,
+                                   &stuff->event, 1))
                 return Success;
             if (DeliverEventsToWindow(dev, pWin,
                                       &stuff->event, 1, stuff->eventMask,
@@ -5472,7 +5844,7 @@ ProcSendEvent(ClientPtr client)
                 break;
         }
     }
-    else if (!XaceHook(XACE_SEND_ACCESS, client, NULL, pWin, &stuff->event, 1))
+    else if (!XaceHookSendAccess(client, NULL, pWin, &stuff->event, 1))
         DeliverEventsToWindow(dev, pWin, &stuff->event,
                               1, stuff->eventMask, NullGrab);
     return Success;
@@ -5655,7 +6027,7 @@ ProcGrabButton(ClientPtr client)
     if (stuff->pointerMode == GrabModeSync ||
         stuff->keyboardMode == GrabModeSync)
         access_mode |= DixFreezeAccess;
-    rc = XaceHook(XACE_DEVICE_ACCESS, client, ptr, access_mode);
+    rc = XaceHookDeviceAccess(client, ptr, access_mode);
     if (rc != Success)
         return rc;
 
@@ -5747,6 +6119,8 @@ DeleteWindowFromAnyEvents(WindowPtr pWin, Bool freeResources)
     GrabPtr passive;
     GrabPtr grab;
 
+    windowTreeStamp++;
+
     /* Deactivate any grabs performed on this window, before making any
        input focus changes. */
     grab = mouse->deviceGrab.grab;
@@ -5924,6 +6298,71 @@ ProcRecolorCursor(ClientPtr client)
     return Success;
 }
 
+/**
+ * @return TRUE if ev is a pointer motion event generated by the server, of
+ * a kind that a later one may stand in for.
+ */
+static Bool
+IsCompressibleMotion(const xEvent *ev)
+{
+    if (ev->u.u.type == MotionNotify)
+        return ev->u.u.detail == NotifyNormal;
+    return xi2_get_type(ev) == XI_Motion;
+}
+
+/**
+ * Replace the motion event last written to the client by the motion event
+ * next, if the older one is still waiting in the output buffer with
+ * nothing written after it, and both are for the same windows, device and
+ * button and modifier state.  Only the positions (and time) differ.
+ *
+ * @param native next in server byte order
+ * @param next next in the client's byte order
+ * @return TRUE if the event was written, FALSE if it's up to the caller
+ */
+static Bool
+CoalesceMotion(ClientPtr pClient, const xEvent *native, const xEvent *next,
+               int len)
+{
+    xEvent *prev;
+
+    prev = PendingClientOutput(pClient, pClient->motionSerial, len);
+    if (!prev || prev->u.u.type != next->u.u.type)
+        return FALSE;
+
+    if (native->u.u.type == MotionNotify) {
+        if (prev->u.u.detail != next->u.u.detail ||
+            prev->u.keyButtonPointer.root != next->u.keyButtonPointer.root ||
+            prev->u.keyButtonPointer.event != next->u.keyButtonPointer.event ||
+            prev->u.keyButtonPointer.child != next->u.keyButtonPointer.child ||
+            prev->u.keyButtonPointer.state != next->u.keyButtonPointer.state ||
+            prev->u.keyButtonPointer.sameScreen !=
+            next->u.keyButtonPointer.sameScreen)
+            return FALSE;
+    }
+    else {
+        const xXIDeviceEvent *nev = (const xXIDeviceEvent *) native;
+        const xXIDeviceEvent *p = (const xXIDeviceEvent *) prev;
+        const xXIDeviceEvent *n = (const xXIDeviceEvent *) next;
+        int masks = (nev->buttons_len + nev->valuators_len) * 4;
+
+        /* button and valuator masks follow the event, values after them */
+        if (p->extension != n->extension || p->evtype != n->evtype ||
+            p->deviceid != n->deviceid || p->sourceid != n->sourceid ||
+            p->root != n->root || p->event != n->event ||
+            p->child != n->child || p->flags != n->flags ||
+            p->buttons_len != n->buttons_len ||
+            p->valuators_len != n->valuators_len ||
+            memcmp(&p->mods, &n->mods, sizeof(p->mods)) != 0 ||
+            memcmp(&p->group, &n->group, sizeof(p->group)) != 0 ||
+            memcmp(&p[1], &n[1], masks) != 0)
+            return FALSE;
+    }
+
+    memcpy(prev, next, len);
+    return TRUE;
+}
+
 /**
  * Write the given events to a client, swapping the byte order if necessary.
  * To swap the byte ordering, a callback is called that has to be set up for
@@ -5946,6 +6385,7 @@ WriteEventsToClient(ClientPtr pClient, int count, xEvent *events)
 #endif
     xEvent *eventTo, *eventFrom;
     int i, eventlength = sizeof(xEvent);
+    Bool compress;
 
     if (!pClient || pClient == serverClient || pClient->clientGone)
         return;
@@ -6018,6 +6458,8 @@ WriteEventsToClient(ClientPtr pClient, int count, xEvent *events)
         eventlength += ((xGenericEvent *) events)->length * 4;
     }
 
+    compress = compressMotion && count == 1 && IsCompressibleMotion(events);
+
     if (pClient->swapped) {
         if (eventlength > swapEventLen) {
             swapEventLen = eventlength;
@@ -6037,15 +6479,21 @@ WriteEventsToClient(ClientPtr pClient, int count, xEvent *events)
             (*EventSwapVector[eventFrom->u.u.type & 0177])
                 (eventFrom, eventTo);
 
-            WriteToClient(pClient, eventlength, eventTo);
+            if (!compress ||
+                !CoalesceMotion(pClient, events, eventTo, eventlength))
+                WriteToClient(pClient, eventlength, eventTo);
         }
     }
     else {
         /* only one GenericEvent, remember? that means either count is 1 and
          * eventlength is arbitrary or eventlength is 32 and count doesn't
          * matter. And we're all set. Woohoo. */
-        WriteToClient(pClient, count * eventlength, events);
+        if (!compress || !CoalesceMotion(pClient, events, events, eventlength))
+            WriteToClient(pClient, count * eventlength, events);
     }
+
+    if (compress)
+        pClient->motionSerial = PendingClientOutputSerial(pClient);
 }
 
 /*
@@ -6060,7 +6508,7 @@ WriteEventsToClient(ClientPtr pClient, int count, xEvent *events)
 int
 SetClientPointer(ClientPtr client, DeviceIntPtr device)
 {
-    int rc = XaceHook(XACE_DEVICE_ACCESS, client, device, DixUseAccess);
+    int rc = XaceHookDeviceAccess(client, device, DixUseAccess);
 
     if (rc != Success)
         return rc;
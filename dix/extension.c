@@ -263,7 +263,7 @@ ProcQueryExtension(ClientPtr client)
         reply.present = xFalse;
     else {
         i = FindExtension((char *) &stuff[1], stuff->nbytes);
-        if (i < 0 || XaceHook(XACE_EXT_ACCESS, client, extensions[i]))
+        if (i < 0 || XaceHookExtAccess(client, extensions[i]))
             reply.present = xFalse;
         else {
             reply.present = xTrue;
@@ -298,7 +298,7 @@ ProcListExtensions(ClientPtr client)
 
         for (i = 0; i < NumExtensions; i++) {
             /* call callbacks to find out whether to show extension */
-            if (XaceHook(XACE_EXT_ACCESS, client, extensions[i]) != Success)
+            if (XaceHookExtAccess(client, extensions[i]) != Success)
                 continue;
 
             total_length += strlen(extensions[i]->name) + 1;
@@ -313,7 +313,7 @@ ProcListExtensions(ClientPtr client)
         for (i = 0; i < NumExtensions; i++) {
             int len;
 
-            if (XaceHook(XACE_EXT_ACCESS, client, extensions[i]) != Success)
+            if (XaceHookExtAccess(client, extensions[i]) != Success)
                 continue;
 
             *bufptr++ = len = strlen(extensions[i]->name);
@@ -546,8 +546,9 @@ CreateGC(DrawablePtr pDrawable, BITS32 mask, XID *pval, int *pStatus,
     }
 
     /* security creation/labeling check */
-    *pStatus = XaceHook(XACE_RESOURCE_ACCESS, client, gcid, RT_GC, pGC,
-                        RT_NONE, NULL, DixCreateAccess | DixSetAttrAccess);
+    *pStatus = XaceHookResourceAccess(client, gcid, RT_GC, pGC,
+                                      RT_NONE, NULL,
+                                      DixCreateAccess | DixSetAttrAccess);
     if (*pStatus != Success)
         goto out;
 
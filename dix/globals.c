@@ -120,6 +120,8 @@ FontPtr defaultFont;            /* not declared in dix.h to avoid including font
 CursorPtr rootCursor;
 Bool party_like_its_1989 = FALSE;
 Bool whiteRoot = FALSE;
+Bool compressMotion = FALSE;
+int damageCoalesceInterval = 0;
 
 TimeStamp currentTime;
 
@@ -154,7 +154,7 @@ CursorMetricsFromGlyph(FontPtr pfont, unsigned ch, CursorMetricPtr cm)
         if (chs[1] < pfont->info.firstCol || pfont->info.lastCol < chs[1])
             return FALSE;
     }
-    (*pfont->get_glyphs) (pfont, 1, chs, encoding, &nglyphs, &pci);
+    GetGlyphs(pfont, 1, chs, encoding, &nglyphs, &pci);
     if (nglyphs == 0)
         return FALSE;
     cm->width = pci->metrics.rightSideBearing - pci->metrics.leftSideBearing;
@@ -53,7 +53,7 @@ check_butmap_change(DeviceIntPtr dev, CARD8 *map, int len, CARD32 *errval_out,
         return BadDevice;
     }
 
-    ret = XaceHook(XACE_DEVICE_ACCESS, client, dev, DixManageAccess);
+    ret = XaceHookDeviceAccess(client, dev, DixManageAccess);
     if (ret != Success) {
         client->errorValue = dev->id;
         return ret;
@@ -134,7 +134,7 @@ check_modmap_change(ClientPtr client, DeviceIntPtr dev, KeyCode *modmap)
     int ret, i;
     XkbDescPtr xkb;
 
-    ret = XaceHook(XACE_DEVICE_ACCESS, client, dev, DixManageAccess);
+    ret = XaceHookDeviceAccess(client, dev, DixManageAccess);
     if (ret != Success)
         return ret;
 
@@ -296,7 +296,7 @@ generate_modkeymap(ClientPtr client, DeviceIntPtr dev,
     KeyCode *modkeymap = NULL;
     int i, j, ret;
 
-    ret = XaceHook(XACE_DEVICE_ACCESS, client, dev, DixGetAttrAccess);
+    ret = XaceHookDeviceAccess(client, dev, DixGetAttrAccess);
     if (ret != Success)
         return ret;
 
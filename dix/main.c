@@ -289,6 +289,9 @@ dix_main(int argc, char *argv[], char *envp[])
         pthread_mutex_unlock(&serverRunningMutex);
 #endif
 
+        /* private layouts are final once clients can create objects */
+        dixFreezePrivates();
+
         NotifyParentProcess();
 
         Dispatch();
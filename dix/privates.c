@@ -128,6 +128,17 @@ static const Bool screen_specific_private[PRIVATE_LAST] = {
     [PRIVATE_GLYPHSET] = FALSE,
 };
 
+/* Number of fixed pointer slots below the privates of each type */
+static const int fixed_slots[PRIVATE_LAST] = {
+    [PRIVATE_WINDOW] = PRIVATE_WINDOW_SLOTS,
+    [PRIVATE_PIXMAP] = PRIVATE_PIXMAP_SLOTS,
+};
+
+#define fixed_bytes(type)   (fixed_slots[type] * sizeof(void *))
+
+/* Set by dixFreezePrivates once the server starts taking clients */
+static Bool privates_frozen;
+
 typedef Bool (*FixupFunc) (PrivatePtr *privates, int offset, unsigned bytes);
 
 typedef enum { FixupMove, FixupRealloc } FixupType;
@@ -295,6 +306,34 @@ static Bool (*const allocated_early[PRIVATE_LAST]) (FixupFunc, unsigned) = {
     [PRIVATE_DEVICE] = fixupDevices,
 };
 
+/*
+ * After the freeze, only types whose fixup reaches every object may
+ * grow; the colormap and client fixups only know about the objects
+ * created during initialization.
+ */
+static const Bool grows_when_frozen[PRIVATE_LAST] = {
+    [PRIVATE_SCREEN] = TRUE,
+    [PRIVATE_EXTENSION] = TRUE,
+    [PRIVATE_DEVICE] = TRUE,
+};
+
+static Bool
+can_grow_private_set(DevPrivateType type)
+{
+    DevPrivateType t;
+
+    if (!privates_frozen)
+        return TRUE;
+
+    if (type != PRIVATE_XSELINUX)
+        return grows_when_frozen[type] || !global_keys[type].created;
+
+    for (t = PRIVATE_XSELINUX + 1; t < PRIVATE_LAST; t++)
+        if (xselinux_private[t] && !can_grow_private_set(t))
+            return FALSE;
+    return TRUE;
+}
+
 static void
 grow_private_set(DevPrivateSetPtr set, unsigned bytes)
 {
@@ -343,6 +382,12 @@ dixRegisterPrivateKey(DevPrivateKey key, DevPrivateType type, unsigned size)
         return TRUE;
     }
 
+    if (!can_grow_private_set(type)) {
+        ErrorF("Cannot register %s private key after initialization\n",
+               key_names[type]);
+        return FALSE;
+    }
+
     /* Compute required space */
     bytes = size;
     if (size == 0)
@@ -402,6 +447,36 @@ dixRegisterPrivateKey(DevPrivateKey key, DevPrivateType type, unsigned size)
     return TRUE;
 }
 
+/*
+ * Register a key for one of the fixed slots of a type. The slot lies
+ * below the object's privates, so it neither takes space from nor moves
+ * with the other keys, and the key is not kept on the type's list.
+ */
+Bool
+dixRegisterFixedPrivateKey(DevPrivateKey key, DevPrivateType type, int slot)
+{
+    int offset;
+
+    if (slot < 0 || slot >= fixed_slots[type])
+        FatalError("No fixed private slot %d for type %s\n", slot,
+                   key_names[type]);
+
+    offset = -(slot + 1) * (int) sizeof(void *);
+    if (key->initialized) {
+        assert(key->size == 0 && key->offset == offset);
+        return TRUE;
+    }
+
+    key->offset = offset;
+    key->size = 0;
+    key->initialized = TRUE;
+    key->type = type;
+    key->allocated = FALSE;
+    key->next = NULL;
+
+    return TRUE;
+}
+
 Bool
 dixRegisterScreenPrivateKey(DevScreenPrivateKey screenKey, ScreenPtr pScreen,
                             DevPrivateType type, unsigned size)
@@ -621,6 +696,12 @@ dixRegisterScreenSpecificPrivateKey(ScreenPtr pScreen, DevPrivateKey key,
     /* align to void * size */
     bytes = (bytes + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
 
+    if (privates_frozen && pScreen->screenSpecificPrivates[type].created) {
+        ErrorF("Cannot register %s private key after initialization\n",
+               key_names[type]);
+        return FALSE;
+    }
+
     assert (!allocated_early[type]);
     assert (!pScreen->screenSpecificPrivates[type].created);
     offset = pScreen->screenSpecificPrivates[type].offset;
@@ -671,10 +752,10 @@ _dixInitScreenPrivates(ScreenPtr pScreen, PrivatePtr *privates, void *addr, DevP
     global_keys[type].created++;
     if (xselinux_private[type])
         global_keys[PRIVATE_XSELINUX].created++;
-    if (privates_size == 0)
+    if (privates_size == 0 && fixed_slots[type] == 0)
         addr = 0;
-    *privates = addr;
-    memset(addr, '\0', privates_size);
+    memset(addr, '\0', fixed_bytes(type) + privates_size);
+    *privates = (PrivatePtr) ((char *) addr + fixed_bytes(type));
 }
 
 void *
@@ -699,7 +780,7 @@ _dixAllocateScreenObjectWithPrivates(ScreenPtr pScreen,
         privates_size = global_keys[type].offset;
     /* round up so that pointer is aligned */
     baseSize = (baseSize + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
-    totalSize = baseSize + privates_size;
+    totalSize = baseSize + fixed_bytes(type) + privates_size;
     object = malloc(totalSize);
     if (!object)
         return NULL;
@@ -719,7 +800,7 @@ dixScreenSpecificPrivatesSize(ScreenPtr pScreen, DevPrivateType type)
     assert(type >= PRIVATE_SCREEN && type < PRIVATE_LAST);
 
     if (screen_specific_private[type])
-        return pScreen->screenSpecificPrivates[type].offset;
+        return fixed_bytes(type) + pScreen->screenSpecificPrivates[type].offset;
     else
         return global_keys[type].offset;
 }
@@ -773,4 +854,11 @@ dixResetPrivates(void)
         global_keys[t].created = 0;
         global_keys[t].allocated = 0;
     }
+    privates_frozen = FALSE;
+}
+
+void
+dixFreezePrivates(void)
+{
+    privates_frozen = TRUE;
 }
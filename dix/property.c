@@ -86,18 +86,202 @@ PrintPropertys(WindowPtr pWin)
 }
 #endif
 
+/*
+ * Window managers and toolkits hang dozens of properties off each
+ * top-level window and poll them constantly, so once a window carries
+ * more than PROPERTY_INDEX_THRESHOLD properties an open-addressed table
+ * keyed by Atom is built alongside userProps.  The list itself stays
+ * authoritative since extensions and DDXs walk it directly; the index
+ * maps each name to the first property of that name on the list, which
+ * is the one a list walk would find (XACE modules may keep several
+ * properties under one name).
+ */
+
+#define PROPERTY_INDEX_THRESHOLD 8
+#define PROPERTY_INDEX_MIN_SIZE 32
+
+typedef struct _PropertyIndex {
+    unsigned int size;          /* number of slots, a power of two */
+    unsigned int used;          /* occupied slots, at most size / 2 */
+    PropertyPtr *slots;
+} PropertyIndexRec, *PropertyIndexPtr;
+
+static unsigned int
+PropertyHash(Atom name, unsigned int size)
+{
+    return ((uint32_t) name * 2654435761U) & (size - 1);
+}
+
+static unsigned int
+PropertyIndexSlot(PropertyIndexPtr index, Atom name)
+{
+    unsigned int i = PropertyHash(name, index->size);
+
+    while (index->slots[i] && index->slots[i]->propertyName != name)
+        i = (i + 1) & (index->size - 1);
+    return i;
+}
+
+static void
+FreePropertyIndex(WindowPtr pWin)
+{
+    PropertyIndexPtr index = wPropIndex(pWin);
+
+    if (index) {
+        pWin->optional->propIndex = NULL;
+        free(index);
+    }
+}
+
+/*
+ * (Re)build the index from the list.  Failure to allocate is not an
+ * error, lookups simply fall back to walking the list.
+ */
+static void
+BuildPropertyIndex(WindowPtr pWin)
+{
+    PropertyIndexPtr index;
+    PropertyPtr pProp;
+    unsigned int count = 0, size = PROPERTY_INDEX_MIN_SIZE, i;
+
+    FreePropertyIndex(pWin);
+
+    for (pProp = wUserProps(pWin); pProp; pProp = pProp->next)
+        count++;
+    while (size < count * 2)
+        size <<= 1;
+
+    index = calloc(1, sizeof(PropertyIndexRec) + size * sizeof(PropertyPtr));
+    if (!index)
+        return;
+    index->size = size;
+    index->slots = (PropertyPtr *) (index + 1);
+
+    for (pProp = wUserProps(pWin); pProp; pProp = pProp->next) {
+        i = PropertyIndexSlot(index, pProp->propertyName);
+        if (!index->slots[i]) {
+            index->slots[i] = pProp;
+            index->used++;
+        }
+    }
+    pWin->optional->propIndex = index;
+}
+
+/*
+ * Clear slot i, shifting later members of its probe sequence back so
+ * no tombstones are needed.
+ */
+static void
+PropertyIndexRemove(PropertyIndexPtr index, unsigned int i)
+{
+    unsigned int mask = index->size - 1, j = i, k;
+
+    index->used--;
+    for (;;) {
+        index->slots[i] = NULL;
+        do {
+            j = (j + 1) & mask;
+            if (!index->slots[j])
+                return;
+            k = PropertyHash(index->slots[j]->propertyName, index->size);
+        } while (i <= j ? (i < k && k <= j) : (i < k || k <= j));
+        index->slots[i] = index->slots[j];
+        i = j;
+    }
+}
+
+static void
+InsertWindowProperty(WindowPtr pWin, PropertyPtr pProp)
+{
+    PropertyIndexPtr index = wPropIndex(pWin);
+    unsigned int i;
+
+    pProp->next = pWin->optional->userProps;
+    pWin->optional->userProps = pProp;
+
+    if (!index)
+        return;
+    i = PropertyIndexSlot(index, pProp->propertyName);
+    if (!index->slots[i])
+        index->used++;
+    index->slots[i] = pProp;
+    if (index->used * 2 > index->size)
+        BuildPropertyIndex(pWin);
+}
+
+static void
+RemoveWindowProperty(WindowPtr pWin, PropertyPtr pProp)
+{
+    PropertyIndexPtr index = wPropIndex(pWin);
+    PropertyPtr prevProp, sameProp;
+    unsigned int i;
+
+    if (pWin->optional->userProps == pProp) {
+        /* Takes care of head */
+        pWin->optional->userProps = pProp->next;
+    }
+    else {
+        /* Need to traverse to find the previous element */
+        prevProp = pWin->optional->userProps;
+        while (prevProp->next != pProp)
+            prevProp = prevProp->next;
+        prevProp->next = pProp->next;
+    }
+
+    if (index) {
+        i = PropertyIndexSlot(index, pProp->propertyName);
+        if (index->slots[i] == pProp) {
+            for (sameProp = pProp->next; sameProp; sameProp = sameProp->next)
+                if (sameProp->propertyName == pProp->propertyName)
+                    break;
+            if (sameProp)
+                index->slots[i] = sameProp;
+            else
+                PropertyIndexRemove(index, i);
+        }
+    }
+
+    if (!pWin->optional->userProps) {
+        FreePropertyIndex(pWin);
+        CheckWindowOptionalNeed(pWin);
+    }
+}
+
+/*
+ * Size the buffer for a property growing to needed bytes.  Properties
+ * that are appended to repeatedly grow geometrically so the accumulated
+ * copying stays linear in the final size.
+ */
+static uint32_t
+PropertyGrowSize(PropertyPtr pProp, uint32_t needed)
+{
+    uint32_t allocated = pProp->allocated;
+
+    if (allocated > UINT32_MAX / 2)
+        return needed;
+    allocated *= 2;
+    return allocated > needed ? allocated : needed;
+}
+
 int
 dixLookupProperty(PropertyPtr *result, WindowPtr pWin, Atom propertyName,
                   ClientPtr client, Mask access_mode)
 {
+    PropertyIndexPtr index = wPropIndex(pWin);
     PropertyPtr pProp;
-    int rc = BadMatch;
+    int rc = BadMatch, walked = 0;
 
     client->errorValue = propertyName;
 
-    for (pProp = wUserProps(pWin); pProp; pProp = pProp->next)
-        if (pProp->propertyName == propertyName)
-            break;
+    if (index)
+        pProp = index->slots[PropertyIndexSlot(index, propertyName)];
+    else {
+        for (pProp = wUserProps(pWin); pProp; pProp = pProp->next, walked++)
+            if (pProp->propertyName == propertyName)
+                break;
+        if (walked > PROPERTY_INDEX_THRESHOLD)
+            BuildPropertyIndex(pWin);
+    }
 
     if (pProp)
         rc = XaceHookPropertyAccess(client, pWin, &pProp, access_mode);
@@ -179,6 +363,7 @@ ProcRotateProperties(ClientPtr client)
             props[j]->type = saved[i].type;
             props[j]->format = saved[i].format;
             props[j]->size = saved[i].size;
+            props[j]->allocated = saved[i].allocated;
             props[j]->data = saved[i].data;
         }
     }
@@ -247,6 +432,7 @@ dixChangeWindowProperty(ClientPtr pClient, WindowPtr pWin, Atom property,
     PropertyPtr pProp;
     PropertyRec savedProp;
     int sizeInBytes, totalSize, rc;
+    uint32_t oldSize, allocated;
     unsigned char *data;
     Mask access_mode;
 
@@ -274,6 +460,7 @@ dixChangeWindowProperty(ClientPtr pClient, WindowPtr pWin, Atom property,
         pProp->format = format;
         pProp->data = data;
         pProp->size = len;
+        pProp->allocated = totalSize;
         rc = XaceHookPropertyAccess(pClient, pWin, &pProp,
                                     DixCreateAccess | DixWriteAccess);
         if (rc != Success) {
@@ -282,8 +469,7 @@ dixChangeWindowProperty(ClientPtr pClient, WindowPtr pWin, Atom property,
             pClient->errorValue = property;
             return rc;
         }
-        pProp->next = pWin->optional->userProps;
-        pWin->optional->userProps = pProp;
+        InsertWindowProperty(pWin, pProp);
     }
     else if (rc == Success) {
         /* To append or prepend to a property the request format and type
@@ -306,6 +492,7 @@ dixChangeWindowProperty(ClientPtr pClient, WindowPtr pWin, Atom property,
             memcpy(data, value, totalSize);
             pProp->data = data;
             pProp->size = len;
+            pProp->allocated = totalSize;
             pProp->type = type;
             pProp->format = format;
         }
@@ -313,21 +500,34 @@ dixChangeWindowProperty(ClientPtr pClient, WindowPtr pWin, Atom property,
             /* do nothing */
         }
         else if (mode == PropModeAppend) {
-            data = malloc((pProp->size + len) * sizeInBytes);
-            if (!data)
-                return BadAlloc;
-            memcpy(data, pProp->data, pProp->size * sizeInBytes);
-            memcpy(data + pProp->size * sizeInBytes, value, totalSize);
-            pProp->data = data;
+            oldSize = pProp->size * sizeInBytes;
+            if (oldSize + totalSize <= pProp->allocated) {
+                /* The old bytes are untouched, so a veto below only has
+                   to restore the size. */
+                memcpy((char *) pProp->data + oldSize, value, totalSize);
+            }
+            else {
+                allocated = PropertyGrowSize(pProp, oldSize + totalSize);
+                data = malloc(allocated);
+                if (!data)
+                    return BadAlloc;
+                memcpy(data, pProp->data, oldSize);
+                memcpy(data + oldSize, value, totalSize);
+                pProp->data = data;
+                pProp->allocated = allocated;
+            }
             pProp->size += len;
         }
         else if (mode == PropModePrepend) {
-            data = malloc(sizeInBytes * (len + pProp->size));
+            oldSize = pProp->size * sizeInBytes;
+            allocated = PropertyGrowSize(pProp, oldSize + totalSize);
+            data = malloc(allocated);
             if (!data)
                 return BadAlloc;
-            memcpy(data + totalSize, pProp->data, pProp->size * sizeInBytes);
+            memcpy(data + totalSize, pProp->data, oldSize);
             memcpy(data, value, totalSize);
             pProp->data = data;
+            pProp->allocated = allocated;
             pProp->size += len;
         }
 
@@ -365,7 +565,7 @@ ChangeWindowProperty(WindowPtr pWin, Atom property, Atom type, int format,
 int
 DeleteProperty(ClientPtr client, WindowPtr pWin, Atom propName)
 {
-    PropertyPtr pProp, prevProp;
+    PropertyPtr pProp;
     int rc;
 
     rc = dixLookupProperty(&pProp, pWin, propName, client, DixDestroyAccess);
@@ -373,18 +573,7 @@ DeleteProperty(ClientPtr client, WindowPtr pWin, Atom propName)
         return Success;         /* Succeed if property does not exist */
 
     if (rc == Success) {
-        if (pWin->optional->userProps == pProp) {
-            /* Takes care of head */
-            if (!(pWin->optional->userProps = pProp->next))
-                CheckWindowOptionalNeed(pWin);
-        }
-        else {
-            /* Need to traverse to find the previous element */
-            prevProp = pWin->optional->userProps;
-            while (prevProp->next != pProp)
-                prevProp = prevProp->next;
-            prevProp->next = pProp->next;
-        }
+        RemoveWindowProperty(pWin, pProp);
 
         deliverPropertyNotifyEvent(pWin, PropertyDelete, pProp->propertyName);
         free(pProp->data);
@@ -407,8 +596,10 @@ DeleteAllWindowProperties(WindowPtr pWin)
         pProp = pNextProp;
     }
 
-    if (pWin->optional)
+    if (pWin->optional) {
         pWin->optional->userProps = NULL;
+        FreePropertyIndex(pWin);
+    }
 }
 
 static int
@@ -440,7 +631,7 @@ NullPropertyReply(ClientPtr client, ATOM propertyType, int format)
 int
 ProcGetProperty(ClientPtr client)
 {
-    PropertyPtr pProp, prevProp;
+    PropertyPtr pProp;
     unsigned long n, len, ind;
     int rc;
     WindowPtr pWin;
@@ -543,18 +734,7 @@ ProcGetProperty(ClientPtr client)
 
     if (stuff->delete && (reply.bytesAfter == 0)) {
         /* Delete the Property */
-        if (pWin->optional->userProps == pProp) {
-            /* Takes care of head */
-            if (!(pWin->optional->userProps = pProp->next))
-                CheckWindowOptionalNeed(pWin);
-        }
-        else {
-            /* Need to traverse to find the previous element */
-            prevProp = pWin->optional->userProps;
-            while (prevProp->next != pProp)
-                prevProp = prevProp->next;
-            prevProp->next = pProp->next;
-        }
+        RemoveWindowProperty(pWin, pProp);
 
         free(pProp->data);
         dixFreeObjectWithPrivates(pProp, PRIVATE_PROPERTY);
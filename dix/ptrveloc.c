@@ -66,6 +66,8 @@ SimpleSmoothProfile(DeviceIntPtr dev, DeviceVelocityPtr vel, double velocity,
                     double threshold, double acc);
 static PointerAccelerationProfileFunc
 GetAccelerationProfile(DeviceVelocityPtr vel, int profile_num);
+static void
+InitPenumbralGradient(void);
 static BOOL
 InitializePredictableAccelerationProperties(DeviceIntPtr,
                                             DeviceVelocityPtr,
@@ -108,6 +110,7 @@ InitVelocityData(DeviceVelocityPtr vel)
     vel->average_accel = TRUE;
     SetAccelerationProfile(vel, AccelProfileClassic);
     InitTrackers(vel, 16);
+    InitPenumbralGradient();
 }
 
 /**
@@ -419,12 +422,26 @@ DeletePredictableAccelerationProperties(DeviceIntPtr dev,
 void
 InitTrackers(DeviceVelocityPtr vel, int ntracker)
 {
+    MotionTrackersPtr tracker;
+
     if (ntracker < 1) {
         ErrorF("invalid number of trackers\n");
         return;
     }
+    /* one block: the header, then the per-field arrays */
+    tracker = calloc(1, sizeof(MotionTrackers) +
+                     ntracker * (2 * sizeof(double) + 2 * sizeof(int)));
+    if (!tracker) {
+        ErrorF("failed to allocate %d trackers\n", ntracker);
+        return;
+    }
+    tracker->dx = (double *) (tracker + 1);
+    tracker->dy = tracker->dx + ntracker;
+    tracker->time = (int *) (tracker->dy + ntracker);
+    tracker->dir = tracker->time + ntracker;
     free(vel->tracker);
-    vel->tracker = (MotionTrackerPtr) calloc(ntracker, sizeof(MotionTracker));
+    vel->tracker = tracker;
+    vel->cur_tracker = 0;
     vel->num_tracker = ntracker;
 }
 
@@ -545,7 +562,6 @@ GetDirection(int dx, int dy)
 
 /* convert offset (age) to array index */
 #define TRACKER_INDEX(s, d) (((s)->num_tracker + (s)->cur_tracker - (d)) % (s)->num_tracker)
-#define TRACKER(s, d) &(s)->tracker[TRACKER_INDEX(s,d)]
 
 /**
  * Add the delta motion to each tracker, then reset the latest tracker to
@@ -554,33 +570,41 @@ GetDirection(int dx, int dy)
 static inline void
 FeedTrackers(DeviceVelocityPtr vel, double dx, double dy, int cur_t)
 {
+    MotionTrackersPtr tracker = vel->tracker;
     int n;
 
-    for (n = 0; n < vel->num_tracker; n++) {
-        vel->tracker[n].dx += dx;
-        vel->tracker[n].dy += dy;
-    }
-    n = (vel->cur_tracker + 1) % vel->num_tracker;
-    vel->tracker[n].dx = 0.0;
-    vel->tracker[n].dy = 0.0;
-    vel->tracker[n].time = cur_t;
-    vel->tracker[n].dir = GetDirection(dx, dy);
+    if (!tracker)
+        return;
+
+    /* separate loops over plain arrays, so the compiler can vectorize */
+    for (n = 0; n < vel->num_tracker; n++)
+        tracker->dx[n] += dx;
+    for (n = 0; n < vel->num_tracker; n++)
+        tracker->dy[n] += dy;
+
+    n = vel->cur_tracker + 1;
+    if (n == vel->num_tracker)
+        n = 0;
+    tracker->dx[n] = 0.0;
+    tracker->dy[n] = 0.0;
+    tracker->time[n] = cur_t;
+    tracker->dir[n] = GetDirection(dx, dy);
     DebugAccelF("motion [dx: %f dy: %f dir:%d diff: %d]\n",
-                dx, dy, vel->tracker[n].dir,
-                cur_t - vel->tracker[vel->cur_tracker].time);
+                dx, dy, tracker->dir[n],
+                cur_t - tracker->time[vel->cur_tracker]);
     vel->cur_tracker = n;
 }
 
 /**
- * calc velocity for given tracker, with
- * velocity scaling.
+ * calc velocity for tracker n, without velocity scaling.
  * This assumes linear motion.
  */
 static double
-CalcTracker(const MotionTracker * tracker, int cur_t)
+CalcTracker(const MotionTrackers * tracker, int n, int cur_t)
 {
-    double dist = sqrt(tracker->dx * tracker->dx + tracker->dy * tracker->dy);
-    int dtime = cur_t - tracker->time;
+    double dist = sqrt(tracker->dx[n] * tracker->dx[n] +
+                       tracker->dy[n] * tracker->dy[n]);
+    int dtime = cur_t - tracker->time[n];
 
     if (dtime > 0)
         return dist / dtime;
@@ -598,18 +622,23 @@ CalcTracker(const MotionTracker * tracker, int cur_t)
 static double
 QueryTrackers(DeviceVelocityPtr vel, int cur_t)
 {
-    int offset, dir = UNDEFINED, used_offset = -1, age_ms;
+    MotionTrackersPtr tracker = vel->tracker;
+    int offset, n, dir = UNDEFINED, used_offset = -1, age_ms;
 
     /* initial velocity: a low-offset, valid velocity */
     double initial_velocity = 0, result = 0, velocity_diff;
     double velocity_factor = vel->corr_mul * vel->const_acceleration;   /* premultiply */
 
+    if (!tracker)
+        return 0;
+
     /* loop from current to older data */
+    n = vel->cur_tracker;
     for (offset = 1; offset < vel->num_tracker; offset++) {
-        MotionTracker *tracker = TRACKER(vel, offset);
         double tracker_velocity;
 
-        age_ms = cur_t - tracker->time;
+        n = (n == 0 ? vel->num_tracker : n) - 1;        /* TRACKER_INDEX */
+        age_ms = cur_t - tracker->time[n];
 
         /* bail out if data is too old and protect from overrun */
         if (age_ms >= vel->reset_time || age_ms < 0) {
@@ -624,7 +653,7 @@ QueryTrackers(DeviceVelocityPtr vel, int cur_t)
          * even more precision we could subdivide as a final step, so possible
          * non-linearities are accounted for.
          */
-        dir &= tracker->dir;
+        dir &= tracker->dir[n];
         if (dir == 0) {         /* we've changed octant of movement (e.g. NE → NW) */
             DebugAccelF("query: no longer linear\n");
             /* instead of breaking it we might also inspect the partition after,
@@ -632,7 +661,7 @@ QueryTrackers(DeviceVelocityPtr vel, int cur_t)
             break;
         }
 
-        tracker_velocity = CalcTracker(tracker, cur_t) * velocity_factor;
+        tracker_velocity = CalcTracker(tracker, n, cur_t) * velocity_factor;
 
         if ((initial_velocity == 0 || offset <= vel->initial_range) &&
             tracker_velocity != 0) {
@@ -665,18 +694,17 @@ QueryTrackers(DeviceVelocityPtr vel, int cur_t)
     }
     if (used_offset >= 0) {
 #ifdef PTRACCEL_DEBUGGING
-        MotionTracker *tracker = TRACKER(vel, used_offset);
+        n = TRACKER_INDEX(vel, used_offset);
 
         DebugAccelF("result: offset %i [dx: %f dy: %f diff: %i]\n",
-                    used_offset, tracker->dx, tracker->dy,
-                    cur_t - tracker->time);
+                    used_offset, tracker->dx[n], tracker->dy[n],
+                    cur_t - tracker->time[n]);
 #endif
     }
     return result;
 }
 
 #undef TRACKER_INDEX
-#undef TRACKER
 
 /**
  * Perform velocity approximation based on 2D 'mickeys' (mouse motion delta).
@@ -869,14 +897,51 @@ PowerProfile(DeviceIntPtr dev,
  *  - starts faster than a sinoid
  *  - smoothness C1 (Cinf if you dare to ignore endpoints)
  */
-static inline double
-CalcPenumbralGradient(double x)
+static double
+DoCalcPenumbralGradient(double x)
 {
     x *= 2.0f;
     x -= 1.0f;
     return 0.5f + (x * sqrt(1.0 - x * x) + asin(x)) / M_PI;
 }
 
+/*
+ * The smooth profiles evaluate the gradient for every motion event, so
+ * it is sampled once and linearly interpolated; the difference to the
+ * exact curve stays well below what a pointer can resolve.
+ */
+#define PENUMBRAL_STEPS 1024
+
+static double penumbral_table[PENUMBRAL_STEPS + 1];
+
+static void
+InitPenumbralGradient(void)
+{
+    int i;
+
+    if (penumbral_table[PENUMBRAL_STEPS] != 0)
+        return;
+    for (i = 0; i <= PENUMBRAL_STEPS; i++)
+        penumbral_table[i] = DoCalcPenumbralGradient((double) i /
+                                                     PENUMBRAL_STEPS);
+}
+
+static inline double
+CalcPenumbralGradient(double x)
+{
+    double pos;
+    int i;
+
+    if (x <= 0)
+        return penumbral_table[0];
+    if (x >= 1)
+        return penumbral_table[PENUMBRAL_STEPS];
+    pos = x * PENUMBRAL_STEPS;
+    i = (int) pos;
+    return penumbral_table[i] +
+        (penumbral_table[i + 1] - penumbral_table[i]) * (pos - i);
+}
+
 /**
  * acceleration function similar to classic accelerated/unaccelerated,
  * but with smooth transition in between (and towards zero for adaptive dec.).
@@ -1203,8 +1203,8 @@ dixLookupResourceByType(void **result, XID id, RESTYPE rtype,
 
     if (client) {
         client->errorValue = id;
-        cid = XaceHook(XACE_RESOURCE_ACCESS, client, id, res->type,
-                       res->value, RT_NONE, NULL, mode);
+        cid = XaceHookResourceAccess(client, id, res->type,
+                                     res->value, RT_NONE, NULL, mode);
         if (cid == BadValue)
             return resourceTypes[rtype & TypeMask].errorValue;
         if (cid != Success)
@@ -1236,8 +1236,8 @@ dixLookupResourceByClass(void **result, XID id, RESTYPE rclass,
 
     if (client) {
         client->errorValue = id;
-        cid = XaceHook(XACE_RESOURCE_ACCESS, client, id, res->type,
-                       res->value, RT_NONE, NULL, mode);
+        cid = XaceHookResourceAccess(client, id, res->type,
+                                     res->value, RT_NONE, NULL, mode);
         if (cid != Success)
             return cid;
     }
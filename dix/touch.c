@@ -251,6 +251,7 @@ TouchInitTouchPoint(TouchClassPtr t, ValuatorClassPtr v, int index)
     }
     ti->sprite.spriteTraceSize = 32;
     ti->sprite.spriteTrace[0] = screenInfo.screens[0]->root;
+    ti->sprite.hitStamp = 0;
     ti->sprite.hot.pScreen = screenInfo.screens[0];
     ti->sprite.hotPhys.pScreen = screenInfo.screens[0];
 
@@ -388,6 +389,7 @@ TouchEndTouch(DeviceIntPtr dev, TouchPointInfoPtr ti)
     ti->active = FALSE;
     ti->pending_finish = FALSE;
     ti->sprite.spriteTraceGood = 0;
+    ti->sprite.hitStamp = 0;
     free(ti->listeners);
     ti->listeners = NULL;
     ti->num_listeners = 0;
@@ -546,6 +548,8 @@ TouchBuildDependentSpriteTrace(DeviceIntPtr dev, SpritePtr sprite)
     else
         return FALSE;
 
+    /* the trace is copied, not hit-tested, so it can't be reused */
+    sprite->hitStamp = 0;
     if (srcsprite->spriteTraceGood > sprite->spriteTraceSize) {
         trace = realloc(sprite->spriteTrace,
                         srcsprite->spriteTraceSize * sizeof(*trace));
@@ -579,6 +583,7 @@ TouchBuildSprite(DeviceIntPtr sourcedev, TouchPointInfoPtr ti,
          * XXX: Do we need to handle crossing screens here? */
         sprite->spriteTrace[0] =
             sourcedev->spriteInfo->sprite->hotPhys.pScreen->root;
+        sprite->hitStamp = 0;
         XYToWindow(sprite, ev->device_event.root_x, ev->device_event.root_y);
     }
     else if (!TouchBuildDependentSpriteTrace(sourcedev, sprite))
@@ -592,6 +597,7 @@ TouchBuildSprite(DeviceIntPtr sourcedev, TouchPointInfoPtr ti,
     ti->listeners = calloc(sprite->spriteTraceGood + 2, sizeof(*ti->listeners));
     if (!ti->listeners) {
         sprite->spriteTraceGood = 0;
+        sprite->hitStamp = 0;
         return FALSE;
     }
     ti->num_listeners = 0;
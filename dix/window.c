@@ -377,6 +377,8 @@ SetWindowToDefaults(WindowPtr pWin)
 
     pWin->eventMask = 0;
     pWin->deliverableEvents = 0;
+    pWin->xiDeliverable = 0;
+    pWin->xi2Deliverable = 0;
     pWin->dontPropagate = 0;
     pWin->forcedBS = FALSE;
     pWin->redirectDraw = RedirectDrawNone;
@@ -480,6 +482,7 @@ CreateRootWindow(ScreenPtr pScreen)
     pWin->optional->otherClients = NULL;
     pWin->optional->passiveGrabs = NULL;
     pWin->optional->userProps = NULL;
+    pWin->optional->propIndex = NULL;
     pWin->optional->backingBitPlanes = ~0L;
     pWin->optional->backingPixel = 0;
     pWin->optional->boundingShape = NULL;
@@ -520,8 +523,8 @@ CreateRootWindow(ScreenPtr pScreen)
 
     /*  security creation/labeling check
      */
-    if (XaceHook(XACE_RESOURCE_ACCESS, serverClient, pWin->drawable.id,
-                 RT_WINDOW, pWin, RT_NONE, NULL, DixCreateAccess))
+    if (XaceHookResourceAccess(serverClient, pWin->drawable.id,
+                               RT_WINDOW, pWin, RT_NONE, NULL, DixCreateAccess))
         return FALSE;
 
     if (!AddResource(pWin->drawable.id, RT_WINDOW, (void *) pWin))
@@ -750,9 +753,9 @@ CreateWindow(Window wid, WindowPtr pParent, int x, int y, unsigned w,
 
     /*  security creation/labeling check
      */
-    *error = XaceHook(XACE_RESOURCE_ACCESS, client, wid, RT_WINDOW, pWin,
-                      RT_WINDOW, pWin->parent,
-                      DixCreateAccess | DixSetAttrAccess);
+    *error = XaceHookResourceAccess(client, wid, RT_WINDOW, pWin,
+                                    RT_WINDOW, pWin->parent,
+                                    DixCreateAccess | DixSetAttrAccess);
     if (*error != Success) {
         dixFreeObjectWithPrivates(pWin, PRIVATE_WINDOW);
         return NullWindow;
@@ -1005,9 +1008,10 @@ DestroySubwindows(WindowPtr pWin, ClientPtr client)
      */
     UnmapSubwindows(pWin);
     while (pWin->lastChild) {
-        int rc = XaceHook(XACE_RESOURCE_ACCESS, client,
-                          pWin->lastChild->drawable.id, RT_WINDOW,
-                          pWin->lastChild, RT_NONE, NULL, DixDestroyAccess);
+        int rc = XaceHookResourceAccess(client,
+                                        pWin->lastChild->drawable.id, RT_WINDOW,
+                                        pWin->lastChild, RT_NONE, NULL,
+                                        DixDestroyAccess);
 
         if (rc != Success)
             return rc;
@@ -1282,8 +1286,9 @@ ChangeWindowAttributes(WindowPtr pWin, Mask vmask, XID *vlist, ClientPtr client)
                 goto PatchUp;
             }
             if (val == xTrue) {
-                rc = XaceHook(XACE_RESOURCE_ACCESS, client, pWin->drawable.id,
-                              RT_WINDOW, pWin, RT_NONE, NULL, DixGrabAccess);
+                rc = XaceHookResourceAccess(client, pWin->drawable.id,
+                                            RT_WINDOW, pWin, RT_NONE, NULL,
+                                            DixGrabAccess);
                 if (rc != Success) {
                     error = rc;
                     client->errorValue = pWin->drawable.id;
@@ -2555,8 +2560,8 @@ MapWindow(WindowPtr pWin, ClientPtr client)
         return Success;
 
     /* general check for permission to map window */
-    if (XaceHook(XACE_RESOURCE_ACCESS, client, pWin->drawable.id, RT_WINDOW,
-                 pWin, RT_NONE, NULL, DixShowAccess) != Success)
+    if (XaceHookResourceAccess(client, pWin->drawable.id, RT_WINDOW,
+                               pWin, RT_NONE, NULL, DixShowAccess) != Success)
         return Success;
 
     pScreen = pWin->drawable.pScreen;
@@ -3012,8 +3017,8 @@ dixSaveScreens(ClientPtr client, int on, int mode)
     }
 
     for (i = 0; i < screenInfo.numScreens; i++) {
-        rc = XaceHook(XACE_SCREENSAVER_ACCESS, client, screenInfo.screens[i],
-                      DixShowAccess | DixHideAccess);
+        rc = XaceHookScreensaverAccess(client, screenInfo.screens[i],
+                                       DixShowAccess | DixHideAccess);
         if (rc != Success)
             return rc;
     }
@@ -3307,6 +3312,7 @@ MakeWindowOptional(WindowPtr pWin)
     optional->otherClients = NULL;
     optional->passiveGrabs = NULL;
     optional->userProps = NULL;
+    optional->propIndex = NULL;
     optional->backingBitPlanes = ~0L;
     optional->backingPixel = 0;
     optional->boundingShape = NULL;
@@ -161,8 +161,8 @@ proc_dri3_pixmap_from_buffer(ClientPtr client)
     pixmap->drawable.id = stuff->pixmap;
 
     /* security creation/labeling check */
-    rc = XaceHook(XACE_RESOURCE_ACCESS, client, stuff->pixmap, RT_PIXMAP,
-                  pixmap, RT_NONE, NULL, DixCreateAccess);
+    rc = XaceHookResourceAccess(client, stuff->pixmap, RT_PIXMAP,
+                                pixmap, RT_NONE, NULL, DixCreateAccess);
 
     if (rc != Success) {
         (*drawable->pScreen->DestroyPixmap) (pixmap);
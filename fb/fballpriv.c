@@ -46,7 +46,7 @@ fbAllocatePrivates(ScreenPtr pScreen)
 
     if (!dixRegisterScreenSpecificPrivateKey (pScreen, &pScrPriv->gcPrivateKeyRec, PRIVATE_GC, sizeof(FbGCPrivRec)))
         return FALSE;
-    if (!dixRegisterScreenSpecificPrivateKey (pScreen, &pScrPriv->winPrivateKeyRec, PRIVATE_WINDOW, 0))
+    if (!dixRegisterFixedPrivateKey (&pScrPriv->winPrivateKeyRec, PRIVATE_WINDOW, PRIVATE_SLOT_FB_WINDOW_PIXMAP))
         return FALSE;
 
     return TRUE;
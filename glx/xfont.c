@@ -122,8 +122,7 @@ MakeBitmapsFromFont(FontPtr pFont, int first, int count, int list_base)
         chs[0] = (first + i) >> 8;      /* high byte is first byte */
         chs[1] = first + i;
 
-        (*pFont->get_glyphs) (pFont, 1, chs, (FontEncoding) encoding,
-                              &nglyphs, &pci);
+        GetGlyphs(pFont, 1, chs, (FontEncoding) encoding, &nglyphs, &pci);
 
         /*
          ** Define a display list containing just a glBitmap() call.
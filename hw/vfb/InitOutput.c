@@ -66,6 +66,9 @@ from The Open Group.
 #include "dix.h"
 #include "miline.h"
 #include "glx_extinit.h"
+#ifdef PRESENT
+#include "present.h"
+#endif
 
 #define VFB_DEFAULT_WIDTH      1280
 #define VFB_DEFAULT_HEIGHT     1024
@@ -90,6 +93,7 @@ typedef struct {
     Pixel blackPixel;
     Pixel whitePixel;
     unsigned int lineBias;
+    unsigned int vblankRate;    /* mHz, 0 for the default */
     CloseScreenProcPtr closeScreen;
 
 #ifdef HAVE_MMAP
@@ -241,6 +245,9 @@ ddxUseMsg(void)
     ErrorF("-linebias n            adjust thin line pixelization\n");
     ErrorF("-blackpixel n          pixel value for black\n");
     ErrorF("-whitepixel n          pixel value for white\n");
+#ifdef PRESENT
+    ErrorF("-vblankrate hz         refresh rate of the Present vblank clock\n");
+#endif
 
 #ifdef HAVE_MMAP
     ErrorF
@@ -361,6 +368,23 @@ ddxProcessArgument(int argc, char *argv[], int i)
         return 2;
     }
 
+#ifdef PRESENT
+    if (strcmp(argv[i], "-vblankrate") == 0) {  /* -vblankrate hz */
+        double rate;
+
+        CHECK_FOR_REQUIRED_ARGUMENTS(1);
+        rate = atof(argv[++i]);
+        if (rate < 1 || rate > 10000) {
+            ErrorF("Invalid vblank rate %s\n", argv[i]);
+            UseMsg();
+            FatalError("Invalid vblank rate %s passed to -vblankrate\n",
+                       argv[i]);
+        }
+        currentScreen->vblankRate = rate * 1000 + 0.5;
+        return 2;
+    }
+#endif
+
 #ifdef HAVE_MMAP
     if (strcmp(argv[i], "-fbdir") == 0) {       /* -fbdir directory */
         CHECK_FOR_REQUIRED_ARGUMENTS(1);
@@ -876,6 +900,10 @@ vfbScreenInit(ScreenPtr pScreen, int argc, char **argv)
 
     miSetZeroLineBias(pScreen, pvfb->lineBias);
 
+#ifdef PRESENT
+    present_set_fake_refresh(pScreen->myNum, pvfb->vblankRate);
+#endif
+
     pvfb->closeScreen = pScreen->CloseScreen;
     pScreen->CloseScreen = vfbCloseScreen;
 
@@ -53,6 +53,12 @@ typedef struct _OFclosure {
     char *fontname;
     int fnamelen;
     FontPtr non_cachable_font;
+
+/* state of a request handed to the font thread, see dixfonts.c */
+    int thread_state;
+    int thread_err;
+    FontPtr thread_font;
+    struct _OFclosure *thread_next;
 } OFclosureRec;
 
 /* ListFontsWithInfo */
@@ -92,6 +98,8 @@ typedef struct _LFclosure {
     Bool haveSaved;
     char *savedName;
     int savedNameLen;
+    LFWIstateRec request;       /* as requested, for the ListFonts cache */
+    unsigned long cacheGeneration;      /* 0 if the reply isn't cached */
 } LFclosureRec;
 
 /* PolyText */
@@ -443,6 +443,9 @@ FixKeyState(DeviceEvent * /* event */ ,
 extern void
 RecalculateDeliverableEvents(WindowPtr /* pWin */ );
 
+extern void
+RecalculateInputInterest(WindowPtr /* pWin */ );
+
 extern _X_EXPORT int
 OtherClientGone(void */* value */ ,
                 XID /* id */ );
@@ -126,6 +126,10 @@ extern _X_EXPORT void dixGetGlyphs(FontPtr /*font */ ,
                                    unsigned long * /*glyphcount */ ,
                                    CharInfoPtr * /*glyphs */ );
 
+extern _X_EXPORT void LockFontLibrary(void);
+
+extern _X_EXPORT void UnlockFontLibrary(void);
+
 extern _X_EXPORT void QueryGlyphExtents(FontPtr /*pFont */ ,
                                         CharInfoPtr * /*charinfo */ ,
                                         unsigned long /*count */ ,
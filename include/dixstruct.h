@@ -109,6 +109,7 @@ typedef struct _Client {
 
     DeviceIntPtr clientPtr;
     ClientIdPtr clientIds;
+    unsigned long motionSerial; /* output serial of the last motion event */
 #if XTRANS_SEND_FDS
     int req_fds;
 #endif
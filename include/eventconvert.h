@@ -28,10 +28,19 @@
 #include "input.h"
 #include "events.h"
 #include "eventstr.h"
+#include "inputstr.h"
 
 _X_EXPORT int EventToCore(InternalEvent *event, xEvent **core, int *count);
 _X_EXPORT int EventToXI(InternalEvent *ev, xEvent **xi, int *count);
 _X_EXPORT int EventToXI2(InternalEvent *ev, xEvent **xi);
+_X_INTERNAL int EventToCoreArena(InternalEvent *event, xEvent **core,
+                                 int *count, EventConvertArenaPtr arena);
+_X_INTERNAL int EventToXIArena(InternalEvent *ev, xEvent **xi, int *count,
+                               EventConvertArenaPtr arena);
+_X_INTERNAL int EventToXI2Arena(InternalEvent *ev, xEvent **xi,
+                                EventConvertArenaPtr arena);
+_X_INTERNAL void FreeConvertedEvent(EventConvertArenaPtr arena, xEvent *event);
+_X_INTERNAL void FreeEventConvertArena(EventConvertArenaPtr arena);
 _X_INTERNAL int GetCoreType(enum EventType type);
 _X_INTERNAL int GetXIType(enum EventType type);
 _X_INTERNAL int GetXI2Type(enum EventType type);
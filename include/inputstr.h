@@ -248,6 +248,13 @@ typedef struct _SpriteRec {
 
     WindowPtr redirectWindow;
 
+    /* Until the window tree changes (hitStamp), the pointer stays within
+     * hitBox and the confinement is unchanged, XYToWindow's last trace is
+     * still correct and the tree isn't walked again. */
+    unsigned long hitStamp;
+    WindowPtr hitRedirect;
+    BoxRec hitBox;
+
 } SpriteRec;
 
 typedef struct _KeyClassRec {
@@ -530,6 +537,23 @@ typedef struct _SpriteInfoRec {
 #define KEYBOARD_OR_FLOAT       5       /* Keyboard master for this device or this device if floating */
 #define POINTER_OR_FLOAT        6       /* Pointer master for this device or this device if floating */
 
+/**
+ * Buffers for converted events, kept per device so steady-state event
+ * delivery doesn't go to the heap for every event.  Conversions nest
+ * (core, XI and XI2 versions of one event may be alive at once, and
+ * delivery may trigger further deliveries), hence several slots; once
+ * all are busy, conversion falls back to allocating.
+ */
+#define EVENT_CONVERT_SLOTS 4
+
+typedef struct _EventConvertArena {
+    struct {
+        void *data;
+        size_t size;            /* bytes allocated */
+        Bool inuse;
+    } slot[EVENT_CONVERT_SLOTS];
+} EventConvertArenaRec, *EventConvertArenaPtr;
+
 typedef struct _DeviceIntRec {
     DeviceRec public;
     DeviceIntPtr next;
@@ -601,6 +625,10 @@ typedef struct _DeviceIntRec {
     int xtest_master_id;
 
     struct _SyncCounter *idle_counter;
+
+    /* storage reused for converting this device's events to the wire
+     * format, see EventToXI2Arena() */
+    EventConvertArenaRec convertArena;
 } DeviceIntRec;
 
 typedef struct {
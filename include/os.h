@@ -119,6 +119,12 @@ extern _X_EXPORT void SetCriticalOutputPending(void);
 extern _X_EXPORT int WriteToClient(ClientPtr /*who */ , int /*count */ ,
                                    const void * /*buf */ );
 
+extern _X_EXPORT unsigned long PendingClientOutputSerial(ClientPtr /*who */ );
+
+extern _X_EXPORT void *PendingClientOutput(ClientPtr /*who */ ,
+                                           unsigned long /*serial */ ,
+                                           int /*count */ );
+
 extern _X_EXPORT void ResetOsBuffers(void);
 
 extern _X_EXPORT void InitConnectionLimits(void);
@@ -172,6 +178,7 @@ extern _X_EXPORT void AddClientOnOpenFD(int /* fd */ );
 
 extern _X_EXPORT CARD32 GetTimeInMillis(void);
 extern _X_EXPORT CARD64 GetTimeInMicros(void);
+extern _X_EXPORT CARD64 GetTimeInNanos(void);
 
 extern _X_EXPORT void AdjustWaitForDelay(void */*waitTime */ ,
                                          unsigned long /*newdelay */ );
@@ -180,6 +180,47 @@ dixLookupPrivateAddr(PrivatePtr *privates, const DevPrivateKey key)
     return (void **) dixGetPrivateAddr(privates, key);
 }
 
+/*
+ * Fixed private slots.
+ *
+ * A few pointer privates are fetched on nearly every rendering
+ * operation. Instead of living at a key offset, which moves as other
+ * keys are registered, these sit in pointer-sized slots just below the
+ * private storage of windows and pixmaps, so looking one up is a single
+ * load from a constant offset.
+ */
+#define PRIVATE_SLOT_FB_WINDOW_PIXMAP   0       /* PRIVATE_WINDOW */
+#define PRIVATE_SLOT_DAMAGE_WINDOW      1       /* PRIVATE_WINDOW */
+#define PRIVATE_WINDOW_SLOTS            2
+
+#define PRIVATE_SLOT_DAMAGE_PIXMAP      0       /* PRIVATE_PIXMAP */
+#define PRIVATE_PIXMAP_SLOTS            1
+
+static inline void **
+dixFixedPrivateAddr(PrivatePtr *privates, int slot)
+{
+    return (void **) (*privates) - 1 - slot;
+}
+
+static inline void *
+dixGetFixedPrivate(PrivatePtr *privates, int slot)
+{
+    return *dixFixedPrivateAddr(privates, slot);
+}
+
+static inline void
+dixSetFixedPrivate(PrivatePtr *privates, int slot, void *val)
+{
+    *dixFixedPrivateAddr(privates, slot) = val;
+}
+
+/*
+ * Bind a key to a fixed slot, so that code using the key with
+ * dixGetPrivate and friends sees the same pointer as the slot.
+ */
+extern _X_EXPORT Bool
+dixRegisterFixedPrivateKey(DevPrivateKey key, DevPrivateType type, int slot);
+
 extern _X_EXPORT Bool
 
 dixRegisterScreenPrivateKey(DevScreenPrivateKey key, ScreenPtr pScreen,
@@ -341,6 +382,15 @@ extern void
 extern _X_EXPORT void
  dixResetPrivates(void);
 
+/*
+ * Called once the server is about to accept clients. From then on, new
+ * keys may only be registered for types whose existing objects can all
+ * be resized, or which have no objects yet; anything else fails rather
+ * than corrupting live objects.
+ */
+extern _X_EXPORT void
+dixFreezePrivates(void);
+
 /*
  * Looks up the offset where the devPrivates field is located.
  *
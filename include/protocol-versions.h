@@ -44,7 +44,7 @@
 
 /* Damage */
 #define SERVER_DAMAGE_MAJOR_VERSION		1
-#define SERVER_DAMAGE_MINOR_VERSION		1
+#define SERVER_DAMAGE_MINOR_VERSION		2
 
 /* DRI3 */
 #define SERVER_DRI3_MAJOR_VERSION               1
@@ -77,7 +77,7 @@
 
 /* Record */
 #define SERVER_RECORD_MAJOR_VERSION		1
-#define SERVER_RECORD_MINOR_VERSION		13
+#define SERVER_RECORD_MINOR_VERSION		14
 
 /* Render */
 #define SERVER_RENDER_MAJOR_VERSION		0
@@ -141,6 +141,10 @@
 #define SERVER_XI_MAJOR_VERSION			2
 #define SERVER_XI_MINOR_VERSION			3
 
+/* XTest */
+#define SERVER_XTEST_MAJOR_VERSION		2
+#define SERVER_XTEST_MINOR_VERSION		3
+
 /* XKB */
 #define SERVER_XKB_MAJOR_VERSION		1
 #define SERVER_XKB_MINOR_VERSION		0
@@ -54,19 +54,21 @@ typedef double (*PointerAccelerationProfileFunc)
 /**
  * a motion history, with just enough information to
  * calc mean velocity and decide which motion was along
- * a more or less straight line
+ * a more or less straight line.
+ * Every field is an array indexed by tracker, so the passes over all
+ * trackers done for each motion event run over contiguous memory.
  */
-typedef struct _MotionTracker {
-    double dx, dy;              /* accumulated delta for each axis */
-    int time;                   /* time of creation */
-    int dir;                    /* initial direction bitfield */
-} MotionTracker, *MotionTrackerPtr;
+typedef struct _MotionTrackers {
+    double *dx, *dy;            /* accumulated delta for each axis */
+    int *time;                  /* time of creation */
+    int *dir;                   /* initial direction bitfield */
+} MotionTrackers, *MotionTrackersPtr;
 
 /**
  * Contains all data needed to implement mouse ballistics
  */
 typedef struct _DeviceVelocityRec {
-    MotionTrackerPtr tracker;
+    MotionTrackersPtr tracker;  /* header and arrays in one block */
     int num_tracker;
     int cur_tracker;            /* current index */
     double velocity;            /* velocity as guessed by algorithm */
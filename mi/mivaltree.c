@@ -186,6 +186,81 @@ miRegisterRedirectBorderClipProc(SetRedirectBorderClipProcPtr setBorderClip,
 				    HasBorder(w) && \
 				    (w)->backgroundState == ParentRelative)
 
+/*
+ * Check whether a marked window can keep the clips it has.  That is the
+ * case when nothing in its subtree has been moved, resized or reshaped,
+ * and its new universe is exactly its old borderClip: then every clip
+ * list below it would come out the same.  Typically these are windows
+ * near a window being dragged, which were marked for overlapping the
+ * affected area but end up with the same visible region.
+ */
+static Bool
+miClipsUnchanged(WindowPtr pWin, RegionPtr universe, VTKind kind)
+{
+    WindowPtr pChild;
+
+    if (kind == VTBroken || pWin->visibility == VisibilityNotViewable ||
+        !RegionEqual(universe, &pWin->borderClip))
+        return FALSE;
+
+    pChild = pWin;
+    while (1) {
+        if (pChild->viewable) {
+            if (pChild->valdata) {
+                if (pChild->valdata == UnmapValData ||
+                    pChild->visibility == VisibilityNotViewable ||
+                    pChild->redirectDraw != RedirectDrawNone ||
+                    pChild->valdata->before.resized ||
+                    pChild->valdata->before.borderVisible ||
+                    pChild->drawable.x !=
+                    pChild->valdata->before.oldAbsCorner.x ||
+                    pChild->drawable.y !=
+                    pChild->valdata->before.oldAbsCorner.y)
+                    return FALSE;
+            }
+            if (pChild->firstChild) {
+                pChild = pChild->firstChild;
+                continue;
+            }
+        }
+        while (!pChild->nextSib && (pChild != pWin))
+            pChild = pChild->parent;
+        if (pChild == pWin)
+            break;
+        pChild = pChild->nextSib;
+    }
+    return TRUE;
+}
+
+/*
+ * Finish validation of a subtree that miClipsUnchanged approved: nothing
+ * in it gets exposed.
+ */
+static void
+miKeepClips(WindowPtr pWin)
+{
+    WindowPtr pChild;
+
+    pChild = pWin;
+    while (1) {
+        if (pChild->viewable) {
+            if (pChild->valdata) {
+                RegionNull(&pChild->valdata->after.borderExposed);
+                RegionNull(&pChild->valdata->after.exposed);
+            }
+            if (pChild->firstChild) {
+                pChild = pChild->firstChild;
+                continue;
+            }
+        }
+        while (!pChild->nextSib && (pChild != pWin))
+            pChild = pChild->parent;
+        if (pChild == pWin)
+            break;
+        pChild = pChild->nextSib;
+    }
+}
+
 /*
  *-----------------------------------------------------------------------
  * miComputeClips --
@@ -436,8 +511,11 @@ miComputeClips(WindowPtr pParent,
                      */
                     RegionIntersect(&childUniverse,
                                     universe, &pChild->borderSize);
-                    miComputeClips(pChild, pScreen, &childUniverse, kind,
-                                   exposed);
+                    if (miClipsUnchanged(pChild, &childUniverse, kind))
+                        miKeepClips(pChild);
+                    else
+                        miComputeClips(pChild, pScreen, &childUniverse, kind,
+                                       exposed);
                 }
                 /*
                  * Once the child has been processed, we remove its extents
@@ -692,7 +770,10 @@ miValidateTree(WindowPtr pParent,       /* Parent to validate */
         if (pWin->viewable) {
             if (pWin->valdata) {
                 RegionIntersect(&childClip, &totalClip, &pWin->borderSize);
-                miComputeClips(pWin, pScreen, &childClip, kind, &exposed);
+                if (miClipsUnchanged(pWin, &childClip, kind))
+                    miKeepClips(pWin);
+                else
+                    miComputeClips(pWin, pScreen, &childClip, kind, &exposed);
                 if (overlap && !TreatAsTransparent(pWin)) {
                     RegionSubtract(&totalClip, &totalClip, &pWin->borderSize);
                 }
@@ -63,7 +63,7 @@
 #endif
 
 #define getPixmapDamageRef(pPixmap) ((DamagePtr *) \
-    dixLookupPrivateAddr(&(pPixmap)->devPrivates, damagePixPrivateKey))
+    dixFixedPrivateAddr(&(pPixmap)->devPrivates, PRIVATE_SLOT_DAMAGE_PIXMAP))
 
 #define pixmapDamage(pPixmap)		damagePixPriv(pPixmap)
 
@@ -80,6 +80,18 @@ static DevPrivateKeyRec damageWinPrivateKeyRec;
 
 #define damageWinPrivateKey (&damageWinPrivateKeyRec)
 
+/*
+ * The topmost window drawing into a pixmap other than the screen's,
+ * i.e. the composite-redirected window it was allocated for.
+ */
+static DevPrivateKeyRec damagePixOwnerPrivateKeyRec;
+
+#define damagePixOwnerPrivateKey (&damagePixOwnerPrivateKeyRec)
+#define getPixmapOwner(pPixmap) ((WindowPtr) \
+    dixLookupPrivate(&(pPixmap)->devPrivates, damagePixOwnerPrivateKey))
+#define setPixmapOwner(pPixmap, pWin) \
+    dixSetPrivate(&(pPixmap)->devPrivates, damagePixOwnerPrivateKey, pWin)
+
 static DamagePtr *
 getDrawableDamageRef(DrawablePtr pDrawable)
 {
@@ -117,7 +129,57 @@ getDrawableDamageRef(DrawablePtr pDrawable)
 
 #define winDamageRef(pWindow) \
     DamagePtr	*pPrev = (DamagePtr *) \
-	dixLookupPrivateAddr(&(pWindow)->devPrivates, damageWinPrivateKey)
+	dixFixedPrivateAddr(&(pWindow)->devPrivates, PRIVATE_SLOT_DAMAGE_WINDOW)
+
+/*
+ * Whether pRegion is a single box already inside pDamageRegion, in which
+ * case adding it changes nothing. Drawing tends to hit the same areas
+ * over and over, and this is much cheaper than a region union.
+ */
+static Bool
+damageRegionCovers(RegionPtr pDamageRegion, RegionPtr pRegion)
+{
+    return RegionNumRects(pRegion) == 1 &&
+        RegionContainsRect(pDamageRegion, RegionExtents(pRegion)) == rgnIN;
+}
+
+/*
+ * Collapse the damage to its extents once it has too many boxes, unless
+ * the boxes are so sparse that the extents would mostly be undamaged
+ * area, e.g. two small updates in opposite corners of the screen.
+ */
+static void
+damageLimitBoxes(DamagePtr pDamage)
+{
+    RegionPtr pRegion = &pDamage->damage;
+    BoxRec extents;
+    BoxPtr pBox;
+    uint64_t area = 0;
+    int nBox;
+
+    if (!pDamage->maxBoxes || RegionNumRects(pRegion) <= pDamage->maxBoxes)
+        return;
+
+    pBox = RegionRects(pRegion);
+    for (nBox = RegionNumRects(pRegion); nBox--; pBox++)
+        area += (uint64_t) (pBox->x2 - pBox->x1) * (pBox->y2 - pBox->y1);
+
+    extents = *RegionExtents(pRegion);
+    if ((uint64_t) (extents.x2 - extents.x1) * (extents.y2 - extents.y1) >
+        area * DAMAGE_COLLAPSE_RATIO)
+        return;
+
+    RegionReset(pRegion, &extents);
+}
+
+static void
+damageAccumulate(DamagePtr pDamage, RegionPtr pRegion)
+{
+    if (damageRegionCovers(&pDamage->damage, pRegion))
+        return;
+    RegionUnion(&pDamage->damage, &pDamage->damage, pRegion);
+    damageLimitBoxes(pDamage);
+}
 
 #if DAMAGE_DEBUG_ENABLE
 static void
@@ -254,7 +316,8 @@ damageRegionAppend(DrawablePtr pDrawable, RegionPtr pRegion, Bool clip,
             RegionTranslate(pDamageRegion, -draw_x, -draw_y);
 
         /* Store damage region if needed after submission. */
-        if (pDamage->reportAfter)
+        if (pDamage->reportAfter &&
+            !damageRegionCovers(&pDamage->pendingDamage, pDamageRegion))
             RegionUnion(&pDamage->pendingDamage,
                         &pDamage->pendingDamage, pDamageRegion);
 
@@ -263,7 +326,7 @@ damageRegionAppend(DrawablePtr pDrawable, RegionPtr pRegion, Bool clip,
             if (pDamage->damageReport)
                 DamageReportDamage(pDamage, pDamageRegion);
             else
-                RegionUnion(&pDamage->damage, &pDamage->damage, pDamageRegion);
+                damageAccumulate(pDamage, pDamageRegion);
         }
 
         /*
@@ -291,8 +354,7 @@ damageRegionProcessPending(DrawablePtr pDrawable)
             if (pDamage->damageReport)
                 DamageReportDamage(pDamage, &pDamage->pendingDamage);
             else
-                RegionUnion(&pDamage->damage, &pDamage->damage,
-                            &pDamage->pendingDamage);
+                damageAccumulate(pDamage, &pDamage->pendingDamage);
         }
 
         if (pDamage->reportAfter)
@@ -376,12 +438,21 @@ damageCreateGC(GCPtr pGC)
     wrap(pGCPriv, pGC, funcs, &damageGCFuncs);  \
     if (pGCPriv->ops) wrap(pGCPriv, pGC, ops, &damageGCOps)
 
+/*
+ * A GC validated against a drawable nobody is tracking damage on is left
+ * with the ops below damage, so drawing skips this layer entirely.
+ * damageInvalidateGCs makes such GCs validate again once the first
+ * damage shows up on the drawable.
+ */
 static void
 damageValidateGC(GCPtr pGC, unsigned long changes, DrawablePtr pDrawable)
 {
     DAMAGE_GC_FUNC_PROLOGUE(pGC);
     (*pGC->funcs->ValidateGC) (pGC, changes, pDrawable);
-    pGCPriv->ops = pGC->ops; /* just so it's not NULL */
+    if (getDrawableDamage(pDrawable))
+        pGCPriv->ops = pGC->ops;
+    else
+        pGCPriv->ops = NULL;
     DAMAGE_GC_FUNC_EPILOGUE(pGC);
 }
 
@@ -1513,6 +1584,75 @@ static GCOps damageGCOps = {
     damagePolyGlyphBlt, damagePushPixels,
 };
 
+typedef struct _damageInvalidate {
+    DamagePtr *pRef;
+} DamageInvalidateRec;
+
+static int
+damageInvalidateVisit(WindowPtr pWindow, void *data)
+{
+    DamageInvalidateRec *pVisit = data;
+
+    if (getDrawableDamageRef(&pWindow->drawable) != pVisit->pRef)
+        return WT_DONTWALKCHILDREN;
+    pWindow->drawable.serialNumber = NEXT_SERIAL_NUMBER;
+    return WT_WALKCHILDREN;
+}
+
+/*
+ * Damage is about to be added to the empty list at pRef, which pDrawable
+ * draws through. GCs validated against any drawable sharing that list
+ * may have skipped the damage wrappers, so bump their serial numbers:
+ * the drawable itself, the pixmap behind it and every window drawing
+ * into that pixmap. Windows sharing a pixmap form a subtree, so only the
+ * subtree under the highest such window is walked: for a pixmap, the
+ * root if it is the screen pixmap, else the window owning it, if any.
+ */
+static void
+damageInvalidateGCs(DrawablePtr pDrawable, DamagePtr *pRef)
+{
+    ScreenPtr pScreen = pDrawable->pScreen;
+    DamageInvalidateRec visit;
+    WindowPtr pWin;
+
+    pDrawable->serialNumber = NEXT_SERIAL_NUMBER;
+    if (pDrawable->type == DRAWABLE_WINDOW) {
+        pWin = (WindowPtr) pDrawable;
+        if (pScreen->GetWindowPixmap) {
+            PixmapPtr pPixmap = (*pScreen->GetWindowPixmap) (pWin);
+
+            if (pPixmap)
+                pPixmap->drawable.serialNumber = NEXT_SERIAL_NUMBER;
+        }
+        while (pWin->parent &&
+               getDrawableDamageRef(&pWin->parent->drawable) == pRef)
+            pWin = pWin->parent;
+    }
+    else if ((PixmapPtr) pDrawable == (*pScreen->GetScreenPixmap) (pScreen))
+        pWin = pScreen->root;
+    else
+        pWin = getPixmapOwner((PixmapPtr) pDrawable);
+
+    if (pWin) {
+        visit.pRef = pRef;
+        TraverseTree(pWin, damageInvalidateVisit, &visit);
+    }
+}
+
+/* Forgets pWindow as the owner of the pixmap it draws into */
+static void
+damageDisownPixmap(WindowPtr pWindow)
+{
+    ScreenPtr pScreen = pWindow->drawable.pScreen;
+    PixmapPtr pPixmap;
+
+    if (!pScreen->GetWindowPixmap)
+        return;
+    pPixmap = (*pScreen->GetWindowPixmap) (pWindow);
+    if (pPixmap && getPixmapOwner(pPixmap) == pWindow)
+        setPixmapOwner(pPixmap, NULL);
+}
+
 static void
 damageSetWindowPixmap(WindowPtr pWindow, PixmapPtr pPixmap)
 {
@@ -1530,12 +1670,21 @@ damageSetWindowPixmap(WindowPtr pWindow, PixmapPtr pPixmap)
             pDamage = pDamage->pNextWin;
         }
     }
+    damageDisownPixmap(pWindow);
     unwrap(pScrPriv, pScreen, SetWindowPixmap);
     (*pScreen->SetWindowPixmap) (pWindow, pPixmap);
     wrap(pScrPriv, pScreen, SetWindowPixmap, damageSetWindowPixmap);
+    if (pPixmap && pPixmap != (*pScreen->GetScreenPixmap) (pScreen) &&
+        (!pWindow->parent ||
+         (*pScreen->GetWindowPixmap) (pWindow->parent) != pPixmap))
+        setPixmapOwner(pPixmap, pWindow);
+    /* the new pixmap may be tracked where the old one wasn't */
+    pWindow->drawable.serialNumber = NEXT_SERIAL_NUMBER;
     if ((pDamage = damageGetWinPriv(pWindow))) {
         DamagePtr *pPrev = getPixmapDamageRef(pPixmap);
 
+        if (!*pPrev)
+            damageInvalidateGCs(&pWindow->drawable, pPrev);
         while (pDamage) {
             damageInsertDamage(pPrev, pDamage);
             pDamage = pDamage->pNextWin;
@@ -1555,6 +1704,7 @@ damageDestroyWindow(WindowPtr pWindow)
     while ((pDamage = damageGetWinPriv(pWindow))) {
         DamageDestroy(pDamage);
     }
+    damageDisownPixmap(pWindow);
     unwrap(pScrPriv, pScreen, DestroyWindow);
     ret = (*pScreen->DestroyWindow) (pWindow);
     wrap(pScrPriv, pScreen, DestroyWindow, damageDestroyWindow);
@@ -1589,11 +1739,15 @@ miDamageCreate(DamagePtr pDamage)
  * the serial numbers of the children to re-trigger validation.
  *
  * Since we can't know if a GC has been validated against one of the affected
- * children, just bump them all to be safe.
+ * children, just bump them all to be safe.  Children drawing into another
+ * pixmap (redirected ones) never see this damage, so their subtrees are
+ * skipped.
  */
 static int 
 damageRegisterVisit(WindowPtr pWin, void *data)
 {
+    if (getDrawableDamageRef(&pWin->drawable) != data)
+        return WT_DONTWALKCHILDREN;
     pWin->drawable.serialNumber = NEXT_SERIAL_NUMBER;
     return WT_WALKCHILDREN;
 }
@@ -1602,7 +1756,8 @@ void
 miDamageRegister(DrawablePtr pDrawable, DamagePtr pDamage)
 {
     if (pDrawable->type == DRAWABLE_WINDOW)
-        TraverseTree((WindowPtr)pDrawable, damageRegisterVisit, NULL);
+        TraverseTree((WindowPtr)pDrawable, damageRegisterVisit,
+                     getDrawableDamageRef(pDrawable));
     else
         pDrawable->serialNumber = NEXT_SERIAL_NUMBER;
 }
@@ -1611,7 +1766,8 @@ void
 miDamageUnregister(DrawablePtr pDrawable, DamagePtr pDamage)
 {
     if (pDrawable->type == DRAWABLE_WINDOW)
-        TraverseTree((WindowPtr)pDrawable, damageRegisterVisit, NULL);
+        TraverseTree((WindowPtr)pDrawable, damageRegisterVisit,
+                     getDrawableDamageRef(pDrawable));
     else
         pDrawable->serialNumber = NEXT_SERIAL_NUMBER;
 }
@@ -1645,10 +1801,15 @@ DamageSetup(ScreenPtr pScreen)
         (&damageGCPrivateKeyRec, PRIVATE_GC, sizeof(DamageGCPrivRec)))
         return FALSE;
 
-    if (!dixRegisterPrivateKey(&damagePixPrivateKeyRec, PRIVATE_PIXMAP, 0))
+    if (!dixRegisterFixedPrivateKey(&damagePixPrivateKeyRec, PRIVATE_PIXMAP,
+                                    PRIVATE_SLOT_DAMAGE_PIXMAP))
+        return FALSE;
+
+    if (!dixRegisterFixedPrivateKey(&damageWinPrivateKeyRec, PRIVATE_WINDOW,
+                                    PRIVATE_SLOT_DAMAGE_WINDOW))
         return FALSE;
 
-    if (!dixRegisterPrivateKey(&damageWinPrivateKeyRec, PRIVATE_WINDOW, 0))
+    if (!dixRegisterPrivateKey(&damagePixOwnerPrivateKeyRec, PRIVATE_PIXMAP, 0))
         return FALSE;
 
     pScrPriv = malloc(sizeof(DamageScrPrivRec));
@@ -1699,6 +1860,7 @@ DamageCreate(DamageReportFunc damageReport,
     pDamage->isWindow = FALSE;
     pDamage->pDrawable = 0;
     pDamage->reportAfter = FALSE;
+    pDamage->maxBoxes = 0;
 
     pDamage->damageReport = damageReport;
     pDamage->damageDestroy = damageDestroy;
@@ -1713,6 +1875,7 @@ void
 DamageRegister(DrawablePtr pDrawable, DamagePtr pDamage)
 {
     ScreenPtr pScreen = pDrawable->pScreen;
+    DamagePtr *pRef;
 
     damageScrPriv(pScreen);
 
@@ -1744,7 +1907,10 @@ DamageRegister(DrawablePtr pDrawable, DamagePtr pDamage)
     else
         pDamage->isWindow = FALSE;
     pDamage->pDrawable = pDrawable;
-    damageInsertDamage(getDrawableDamageRef(pDrawable), pDamage);
+    pRef = getDrawableDamageRef(pDrawable);
+    if (!*pRef)
+        damageInvalidateGCs(pDrawable, pRef);
+    damageInsertDamage(pRef, pDamage);
     (*pScrPriv->funcs.Register) (pDrawable, pDamage);
 }
 
@@ -1892,6 +2058,13 @@ DamageSetReportAfterOp(DamagePtr pDamage, Bool reportAfter)
     pDamage->reportAfter = reportAfter;
 }
 
+void
+DamageSetBoxLimit(DamagePtr pDamage, int maxBoxes)
+{
+    pDamage->maxBoxes = maxBoxes;
+    damageLimitBoxes(pDamage);
+}
+
 DamageScreenFuncsPtr
 DamageGetScreenFuncs(ScreenPtr pScreen)
 {
@@ -1908,21 +2081,24 @@ DamageReportDamage(DamagePtr pDamage, RegionPtr pDamageRegion)
 
     switch (pDamage->damageLevel) {
     case DamageReportRawRegion:
-        RegionUnion(&pDamage->damage, &pDamage->damage, pDamageRegion);
+        damageAccumulate(pDamage, pDamageRegion);
         (*pDamage->damageReport) (pDamage, pDamageRegion, pDamage->closure);
         break;
     case DamageReportDeltaRegion:
+        if (damageRegionCovers(&pDamage->damage, pDamageRegion))
+            break;
         RegionNull(&tmpRegion);
         RegionSubtract(&tmpRegion, pDamageRegion, &pDamage->damage);
         if (RegionNotEmpty(&tmpRegion)) {
             RegionUnion(&pDamage->damage, &pDamage->damage, pDamageRegion);
+            damageLimitBoxes(pDamage);
             (*pDamage->damageReport) (pDamage, &tmpRegion, pDamage->closure);
         }
         RegionUninit(&tmpRegion);
         break;
     case DamageReportBoundingBox:
         tmpBox = *RegionExtents(&pDamage->damage);
-        RegionUnion(&pDamage->damage, &pDamage->damage, pDamageRegion);
+        damageAccumulate(pDamage, pDamageRegion);
         if (!BOX_SAME(&tmpBox, RegionExtents(&pDamage->damage))) {
             (*pDamage->damageReport) (pDamage, &pDamage->damage,
                                       pDamage->closure);
@@ -1930,14 +2106,14 @@ DamageReportDamage(DamagePtr pDamage, RegionPtr pDamageRegion)
         break;
     case DamageReportNonEmpty:
         was_empty = !RegionNotEmpty(&pDamage->damage);
-        RegionUnion(&pDamage->damage, &pDamage->damage, pDamageRegion);
+        damageAccumulate(pDamage, pDamageRegion);
         if (was_empty && RegionNotEmpty(&pDamage->damage)) {
             (*pDamage->damageReport) (pDamage, &pDamage->damage,
                                       pDamage->closure);
         }
         break;
     case DamageReportNone:
-        RegionUnion(&pDamage->damage, &pDamage->damage, pDamageRegion);
+        damageAccumulate(pDamage, pDamageRegion);
         break;
     }
 }
@@ -110,6 +110,19 @@ extern _X_EXPORT void
 extern _X_EXPORT void
  DamageSetReportAfterOp(DamagePtr pDamage, Bool reportAfter);
 
+/*
+ * Past this many boxes, the accumulated damage is replaced by its
+ * extents, provided the extents are at most DAMAGE_COLLAPSE_RATIO times
+ * the damaged area. Suits consumers which repaint the damage and would
+ * rather touch a few extra pixels than walk thousands of tiny boxes.
+ */
+#define DAMAGE_BOX_LIMIT	64
+#define DAMAGE_COLLAPSE_RATIO	4
+
+/* Set the box limit of the accumulated damage, 0 for no limit. */
+extern _X_EXPORT void
+ DamageSetBoxLimit(DamagePtr pDamage, int maxBoxes);
+
 extern _X_EXPORT DamageScreenFuncsPtr DamageGetScreenFuncs(ScreenPtr);
 
 #endif                          /* _DAMAGE_H_ */
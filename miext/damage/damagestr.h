@@ -50,6 +50,7 @@ typedef struct _damage {
     RegionRec pendingDamage;    /* will be flushed post submission at the latest */
     ScreenPtr pScreen;
     PrivateRec *devPrivates;
+    int maxBoxes;               /* collapse damage to its extents past this, 0 for no limit */
 } DamageRec;
 
 typedef struct _damageScrPriv {
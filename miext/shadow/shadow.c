@@ -160,6 +160,7 @@ shadowSetup(ScreenPtr pScreen)
         free(pBuf);
         return FALSE;
     }
+    DamageSetBoxLimit(pBuf->pDamage, DAMAGE_BOX_LIMIT);
 
     wrap(pBuf, pScreen, CloseScreen);
     wrap(pBuf, pScreen, GetImage);
@@ -40,16 +40,28 @@
 
 typedef struct _SyncObject {
     ClientPtr client;           /* Owning client. 0 for system counters */
-    struct _SyncTriggerList *pTriglist; /* list of triggers */
+    struct _SyncTriggerList *pTriglist; /* list of triggers (fences) */
     XID id;                     /* resource ID */
     unsigned char type;         /* SYNC_* */
     Bool beingDestroyed;        /* in process of going away */
 } SyncObject;
 
+/* A counter keeps its triggers in one of these per test type, sorted by
+ * test value, rather than on the sync object's trigger list.
+ */
+typedef struct _SyncTriggerSet {
+    struct _SyncTrigger **triggers;
+    int num;
+    int size;
+} SyncTriggerSet;
+
+#define SYNC_NUM_TEST_TYPES	(XSyncNegativeComparison + 1)
+
 typedef struct _SyncCounter {
     SyncObject sync;            /* Common sync object data */
     CARD64 value;               /* counter value */
     struct _SysCounterInfo *pSysCounterInfo;    /* NULL if not a system counter */
+    SyncTriggerSet triggers[SYNC_NUM_TEST_TYPES];       /* by test type */
 } SyncCounter;
 
 struct _SyncFence {
@@ -73,6 +85,11 @@ struct _SyncTrigger {
         );
     void (*CounterDestroyed) (struct _SyncTrigger *     /*pTrigger */
         );
+    unsigned int set_type;      /* test type and value the trigger is */
+    CARD64 set_value;           /*   filed under on its counter */
+    struct _SyncFiring *firing; /* where it is among the triggers */
+    int firing_index;           /*   being fired, if anywhere */
+    unsigned int fire_generation;       /* last counter change handled */
 };
 
 typedef struct _SyncTriggerList {
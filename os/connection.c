@@ -731,7 +731,7 @@ ClientAuthorized(ClientPtr client,
     XdmcpOpenDisplay(priv->fd);
 #endif                          /* XDMCP */
 
-    XaceHook(XACE_AUTH_AVAIL, client, auth_id);
+    XaceHookAuthAvail(client, auth_id);
 
     /* At this point, if the client is authorized to change the access control
      * list, we should getpeername() information, and add the client to
@@ -1102,7 +1102,7 @@ OnlyListenToOneClient(ClientPtr client)
     OsCommPtr oc = (OsCommPtr) client->osPrivate;
     int rc, connection = oc->fd;
 
-    rc = XaceHook(XACE_SERVER_ACCESS, client, DixGrabAccess);
+    rc = XaceHookServerAccess(client, DixGrabAccess);
     if (rc != Success)
         return rc;
 
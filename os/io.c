@@ -97,6 +97,8 @@ typedef struct _connectionOutput {
     unsigned char *buf;
     int size;
     int count;
+    int tail;                   /* offset of the last chunk buffered */
+    unsigned long tailSerial;   /* serial of that chunk, 0 once flushed */
 } ConnectionOutput;
 
 static ConnectionInputPtr AllocateInputBuffer(void);
@@ -120,6 +122,7 @@ static Bool CriticalOutputPending;
 static int timesThisConnection = 0;
 static ConnectionInputPtr FreeInputs = (ConnectionInputPtr) NULL;
 static ConnectionOutputPtr FreeOutputs = (ConnectionOutputPtr) NULL;
+static unsigned long OutputSerial = 0;
 static OsCommPtr AvailableInput = (OsCommPtr) NULL;
 
 #define get_req_len(req,cli) ((cli)->swapped ? \
@@ -858,6 +861,8 @@ WriteToClient(ClientPtr who, int count, const void *__buf)
 
     NewOutputPending = TRUE;
     FD_SET(oc->fd, &OutputPending);
+    oco->tail = oco->count;
+    oco->tailSerial = ++OutputSerial ? OutputSerial : ++OutputSerial;
     memmove((char *) oco->buf + oco->count, buf, count);
     oco->count += count;
     if (padBytes) {
@@ -867,6 +872,42 @@ WriteToClient(ClientPtr who, int count, const void *__buf)
     return count;
 }
 
+/**
+ * @return a serial number for the chunk most recently handed to
+ * WriteToClient, as long as it is still waiting in the client's output
+ * buffer, or 0 if it has been flushed already.
+ */
+unsigned long
+PendingClientOutputSerial(ClientPtr who)
+{
+    OsCommPtr oc;
+
+    if (!who || who == serverClient || who->clientGone)
+        return 0;
+    oc = who->osPrivate;
+    return oc->output ? oc->output->tailSerial : 0;
+}
+
+/**
+ * Find the chunk written to the client with the given serial, so that it
+ * may be rewritten in place.
+ *
+ * @return the chunk's bytes if it is still the last chunk in the output
+ * buffer and has exactly count bytes, NULL otherwise.
+ */
+void *
+PendingClientOutput(ClientPtr who, unsigned long serial, int count)
+{
+    ConnectionOutputPtr oco;
+
+    if (!serial || serial != PendingClientOutputSerial(who))
+        return NULL;
+    oco = ((OsCommPtr) who->osPrivate)->output;
+    if (oco->count - oco->tail != count + padding_for_int32(count))
+        return NULL;
+    return oco->buf + oco->tail;
+}
+
  /********************
  * FlushClient()
  *    If the client isn't keeping up with us, then we try to continue
@@ -893,6 +934,7 @@ FlushClient(ClientPtr who, OsCommPtr oc, const void *__extraBuf, int extraCount)
 
     if (!oco)
 	return 0;
+    oco->tailSerial = 0;
     written = 0;
     padsize = padding_for_int32(extraCount);
     notWritten = oco->count + extraCount + padsize;
@@ -1070,6 +1112,7 @@ AllocateOutputBuffer(void)
     }
     oco->size = BUFSIZE;
     oco->count = 0;
+    oco->tailSerial = 0;
     return oco;
 }
 
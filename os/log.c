@@ -99,6 +99,10 @@ OR PERFORMANCE OF THIS SOFTWARE.
 #include "xf86bigfontsrv.h"
 #endif
 
+#ifdef FONT_THREAD
+#include <pthread.h>
+#endif
+
 #ifdef __clang__
 #pragma clang diagnostic ignored "-Wformat-nonliteral"
 #endif
@@ -119,6 +123,22 @@ static char *saveBuffer = NULL;
 static int bufferSize = 0, bufferUnused = 0, bufferPos = 0;
 static Bool needBuffer = TRUE;
 
+#ifdef FONT_THREAD
+/* libXfont logs through ErrorF from the font thread too.  Signal handlers
+ * only write(), and mustn't take the lock. */
+static pthread_mutex_t logLock = PTHREAD_MUTEX_INITIALIZER;
+
+#define LogLock() do { \
+    if (!inSignalContext) pthread_mutex_lock(&logLock); \
+} while (0)
+#define LogUnlock() do { \
+    if (!inSignalContext) pthread_mutex_unlock(&logLock); \
+} while (0)
+#else
+#define LogLock() do { } while (0)
+#define LogUnlock() do { } while (0)
+#endif
+
 #ifdef __APPLE__
 #include <AvailabilityMacros.h>
 
@@ -492,6 +512,7 @@ LogSWrite(int verb, const char *buf, size_t len, Bool end_line)
 {
     static Bool newline = TRUE;
 
+    LogLock();
     if (verb < 0 || logVerbosity >= verb)
         write(2, buf, len);
 
@@ -521,14 +542,17 @@ LogSWrite(int verb, const char *buf, size_t len, Bool end_line)
                 bufferSize += 1024;
                 bufferUnused += 1024;
                 saveBuffer = realloc(saveBuffer, bufferSize);
-                if (!saveBuffer)
+                if (!saveBuffer) {
+                    LogUnlock();
                     FatalError("realloc() failed while saving log messages\n");
+                }
             }
             bufferUnused -= len;
             memcpy(saveBuffer + bufferPos, buf, len);
             bufferPos += len;
         }
     }
+    LogUnlock();
 }
 
 void
@@ -435,6 +435,11 @@ GetTimeInMicros(void)
 {
     return (CARD64) GetTickCount() * 1000;
 }
+CARD64
+GetTimeInNanos(void)
+{
+    return (CARD64) GetTickCount() * 1000000;
+}
 #else
 CARD32
 GetTimeInMillis(void)
@@ -487,6 +492,28 @@ GetTimeInMicros(void)
     X_GETTIMEOFDAY(&tv);
     return (CARD64) tv.tv_sec * (CARD64)1000000000 + (CARD64) tv.tv_usec * 1000;
 }
+
+CARD64
+GetTimeInNanos(void)
+{
+    struct timeval tv;
+#ifdef MONOTONIC_CLOCK
+    struct timespec tp;
+    static clockid_t clockid;
+
+    if (!clockid) {
+        if (clock_gettime(CLOCK_MONOTONIC, &tp) == 0)
+            clockid = CLOCK_MONOTONIC;
+        else
+            clockid = ~0L;
+    }
+    if (clockid != ~0L && clock_gettime(clockid, &tp) == 0)
+        return (CARD64) tp.tv_sec * (CARD64)1000000000 + tp.tv_nsec;
+#endif
+
+    X_GETTIMEOFDAY(&tv);
+    return (CARD64) tv.tv_sec * (CARD64)1000000000 + (CARD64) tv.tv_usec * 1000;
+}
 #endif
 
 void
@@ -524,8 +551,10 @@ UseMsg(void)
     ErrorF("-c                     turns off key-click\n");
     ErrorF("c #                    key-click volume (0-100)\n");
     ErrorF("-cc int                default color visual class\n");
+    ErrorF("-compressmotion        coalesce motion events clients haven't read yet\n");
     ErrorF("-nocursor              disable the cursor\n");
     ErrorF("-core                  generate core dump on fatal error\n");
+    ErrorF("-damageinterval int    min msec between coalesced damage events\n");
     ErrorF("-dpi int               screen resolution in dots per inch\n");
 #ifdef DPMSExtension
     ErrorF("-dpms                  disables VESA DPMS monitor control\n");
@@ -714,6 +743,9 @@ ProcessCommandLine(int argc, char *argv[])
             else
                 UseMsg();
         }
+        else if (strcmp(argv[i], "-compressmotion") == 0) {
+            compressMotion = TRUE;
+        }
         else if (strcmp(argv[i], "-core") == 0) {
 #if !defined(WIN32) || !defined(__MINGW32__)
             struct rlimit core_limit;
@@ -727,6 +759,12 @@ ProcessCommandLine(int argc, char *argv[])
         else if (strcmp(argv[i], "-nocursor") == 0) {
             EnableCursor = FALSE;
         }
+        else if (strcmp(argv[i], "-damageinterval") == 0) {
+            if (++i < argc)
+                damageCoalesceInterval = atoi(argv[i]);
+            else
+                UseMsg();
+        }
         else if (strcmp(argv[i], "-dpi") == 0) {
             if (++i < argc)
                 monitorResolution = atoi(argv[i]);
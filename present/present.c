@@ -33,8 +33,16 @@
 #endif
 
 static uint64_t         present_event_id;
-static struct xorg_list present_exec_queue;
-static struct xorg_list present_flip_queue;
+
+/*
+ * Vblanks waiting for an event from the driver, both those waiting to
+ * execute and those waiting for a flip to complete, hashed by event
+ * id. Event ids are handed out sequentially, so the low bits make a
+ * fine hash.
+ */
+#define PRESENT_EVENT_HASH_SIZE 1024
+
+static struct xorg_list present_event_hash[PRESENT_EVENT_HASH_SIZE];
 
 #if 0
 #define DebugPresent(x) ErrorF x
@@ -42,6 +50,24 @@ static struct xorg_list present_flip_queue;
 #define DebugPresent(x)
 #endif
 
+static inline struct xorg_list *
+present_event_bucket(uint64_t event_id)
+{
+    return &present_event_hash[event_id & (PRESENT_EVENT_HASH_SIZE - 1)];
+}
+
+static present_vblank_ptr
+present_event_find(uint64_t event_id)
+{
+    present_vblank_ptr  vblank;
+
+    xorg_list_for_each_entry(vblank, present_event_bucket(event_id), event_queue) {
+        if (vblank->event_id == event_id)
+            return vblank;
+    }
+    return NULL;
+}
+
 /*
  * Copies the update region from a pixmap to the target drawable
  */
@@ -409,23 +435,22 @@ present_flip_notify(present_vblank_ptr vblank, uint64_t ust, uint64_t crtc_msc)
 void
 present_event_notify(uint64_t event_id, uint64_t ust, uint64_t msc)
 {
-    present_vblank_ptr  vblank, tmp;
+    present_vblank_ptr  vblank;
     int                 s;
 
     if (!event_id)
         return;
     DebugPresent(("\te %lld ust %lld msc %lld\n", event_id, ust, msc));
-    xorg_list_for_each_entry_safe(vblank, tmp, &present_exec_queue, event_queue) {
-        if (vblank->event_id == event_id) {
+    vblank = present_event_find(event_id);
+    if (vblank) {
+        /* Only vblanks waiting to execute are marked queued; the others
+         * are waiting for their flip to complete
+         */
+        if (vblank->queued)
             present_execute(vblank, ust, msc);
-            return;
-        }
-    }
-    xorg_list_for_each_entry_safe(vblank, tmp, &present_flip_queue, event_queue) {
-        if (vblank->event_id == event_id) {
+        else
             present_flip_notify(vblank, ust, msc);
-            return;
-        }
+        return;
     }
 
     for (s = 0; s < screenInfo.numScreens; s++) {
@@ -547,7 +572,7 @@ present_execute(present_vblank_ptr vblank, uint64_t ust, uint64_t crtc_msc)
              */
             screen_priv->flip_pending = vblank;
 
-            xorg_list_add(&vblank->event_queue, &present_flip_queue);
+            xorg_list_add(&vblank->event_queue, present_event_bucket(vblank->event_id));
             /* Try to flip
              */
             if (present_flip(vblank->crtc, vblank->event_id, vblank->target_msc, vblank->pixmap, vblank->sync_flip)) {
@@ -788,7 +813,7 @@ present_pixmap(WindowPtr window,
                       vblank->pixmap->drawable.id, vblank->window->drawable.id,
                       target_crtc));
 
-    xorg_list_add(&vblank->event_queue, &present_exec_queue);
+    xorg_list_add(&vblank->event_queue, present_event_bucket(vblank->event_id));
     vblank->queued = TRUE;
     if (target_msc >= crtc_msc) {
         ret = present_queue_vblank(screen, target_crtc, vblank->event_id, target_msc);
@@ -813,7 +838,7 @@ failure:
 void
 present_abort_vblank(ScreenPtr screen, RRCrtcPtr crtc, uint64_t event_id, uint64_t msc)
 {
-    present_vblank_ptr  vblank, tmp;
+    present_vblank_ptr  vblank;
 
     if (crtc == NULL)
         present_fake_abort_vblank(screen, event_id, msc);
@@ -824,18 +849,10 @@ present_abort_vblank(ScreenPtr screen, RRCrtcPtr crtc, uint64_t event_id, uint64
         (*screen_priv->info->abort_vblank) (crtc, event_id, msc);
     }
 
-    xorg_list_for_each_entry_safe(vblank, tmp, &present_exec_queue, event_queue) {
-        if (vblank->event_id == event_id) {
-            xorg_list_del(&vblank->event_queue);
-            vblank->queued = FALSE;
-            return;
-        }
-    }
-    xorg_list_for_each_entry_safe(vblank, tmp, &present_flip_queue, event_queue) {
-        if (vblank->event_id == event_id) {
-            xorg_list_del(&vblank->event_queue);
-            return;
-        }
+    vblank = present_event_find(event_id);
+    if (vblank) {
+        xorg_list_del(&vblank->event_queue);
+        vblank->queued = FALSE;
     }
 }
 
@@ -904,8 +921,10 @@ present_vblank_destroy(present_vblank_ptr vblank)
 Bool
 present_init(void)
 {
-    xorg_list_init(&present_exec_queue);
-    xorg_list_init(&present_flip_queue);
+    int i;
+
+    for (i = 0; i < PRESENT_EVENT_HASH_SIZE; i++)
+        xorg_list_init(&present_event_hash[i]);
     present_fake_queue_init();
     return TRUE;
 }
@@ -124,4 +124,11 @@ typedef void (*present_complete_notify_proc)(WindowPtr window,
 extern _X_EXPORT void
 present_register_complete_notify(present_complete_notify_proc proc);
 
+/* Set the refresh rate, in mHz, of the fake CRTC used for screen
+ * 'screen_num' when it has no hardware vblank source. May be called
+ * before the screen is initialized. 0 restores the default.
+ */
+extern _X_EXPORT void
+present_set_fake_refresh(int screen_num, uint32_t refresh_mhz);
+
 #endif /* _PRESENT_H_ */
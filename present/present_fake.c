@@ -27,22 +27,59 @@
 #include "present_priv.h"
 #include "list.h"
 
-static struct xorg_list fake_vblank_queue;
+/*
+ * The fake CRTC runs off the monotonic clock with nanosecond
+ * resolution: MSC n happens exactly at fake_base_ust + (n -
+ * fake_base_msc) * fake_interval, and that is the UST reported for it,
+ * so clients see evenly spaced vblanks no matter when the server gets
+ * around to delivering them.
+ *
+ * Pending fake vblanks are kept in a per-screen min-heap ordered by
+ * target MSC, with a single timer armed for the earliest one; every
+ * vblank due by the time it fires is delivered in that one wakeup. They
+ * are also hashed by event id so that aborting one doesn't need a
+ * search.
+ */
+#define FAKE_VBLANK_HASH_SIZE   256
+
+/* Deliveries later than this, but still within the frame, count as late */
+#define FAKE_VBLANK_LATE        2000000
+
+static struct xorg_list fake_vblank_hash[FAKE_VBLANK_HASH_SIZE];
+
+/* Requested refresh rates in mHz, 0 for the default */
+static uint32_t fake_refresh[MAXSCREENS];
 
 typedef struct present_fake_vblank {
     struct xorg_list            list;
     uint64_t                    event_id;
-    OsTimerPtr                  timer;
+    uint64_t                    msc;
+    int                         heap_index;
     ScreenPtr                   screen;
-} present_fake_vblank_rec, *present_fake_vblank_ptr;
+} present_fake_vblank_rec;
+
+/* Time of 'msc' in nanoseconds */
+static inline uint64_t
+present_fake_msc_to_ust(present_screen_priv_ptr screen_priv, uint64_t msc)
+{
+    return screen_priv->fake_base_ust +
+        (int64_t) (msc - screen_priv->fake_base_msc) * (int64_t) screen_priv->fake_interval;
+}
+
+/* Most recent MSC at 'now' nanoseconds */
+static inline uint64_t
+present_fake_current_msc(present_screen_priv_ptr screen_priv, uint64_t now)
+{
+    return screen_priv->fake_base_msc + (now - screen_priv->fake_base_ust) / screen_priv->fake_interval;
+}
 
 int
 present_fake_get_ust_msc(ScreenPtr screen, uint64_t *ust, uint64_t *msc)
 {
     present_screen_priv_ptr screen_priv = present_screen_priv(screen);
 
-    *ust = GetTimeInMicros();
-    *msc = (*ust + screen_priv->fake_interval / 2) / screen_priv->fake_interval;
+    *msc = present_fake_current_msc(screen_priv, GetTimeInNanos());
+    *ust = present_fake_msc_to_ust(screen_priv, *msc) / 1000;
     return Success;
 }
 
@@ -55,32 +92,185 @@ present_fake_notify(ScreenPtr screen, uint64_t event_id)
     present_event_notify(event_id, ust, msc);
 }
 
+/*
+ * Switch the fake CRTC to a new refresh interval, keeping the MSC
+ * continuous across the change
+ */
+static void
+present_fake_set_interval(present_screen_priv_ptr screen_priv, uint64_t interval)
+{
+    uint64_t                    msc;
+
+    if (screen_priv->fake_interval) {
+        msc = present_fake_current_msc(screen_priv, GetTimeInNanos());
+        screen_priv->fake_base_ust = present_fake_msc_to_ust(screen_priv, msc);
+        screen_priv->fake_base_msc = msc;
+    }
+    screen_priv->fake_interval = interval;
+}
+
+static inline struct xorg_list *
+present_fake_bucket(uint64_t event_id)
+{
+    return &fake_vblank_hash[event_id & (FAKE_VBLANK_HASH_SIZE - 1)];
+}
+
+static inline void
+present_fake_heap_set(present_screen_priv_ptr screen_priv, int i, present_fake_vblank_ptr fake_vblank)
+{
+    screen_priv->fake_queue[i] = fake_vblank;
+    fake_vblank->heap_index = i;
+}
+
+static void
+present_fake_heap_up(present_screen_priv_ptr screen_priv, int i)
+{
+    present_fake_vblank_ptr     fake_vblank = screen_priv->fake_queue[i];
+
+    while (i > 0) {
+        int                     parent = (i - 1) / 2;
+
+        if (screen_priv->fake_queue[parent]->msc <= fake_vblank->msc)
+            break;
+        present_fake_heap_set(screen_priv, i, screen_priv->fake_queue[parent]);
+        i = parent;
+    }
+    present_fake_heap_set(screen_priv, i, fake_vblank);
+}
+
+static void
+present_fake_heap_down(present_screen_priv_ptr screen_priv, int i)
+{
+    present_fake_vblank_ptr     fake_vblank = screen_priv->fake_queue[i];
+    int                         len = screen_priv->fake_queue_len;
+
+    for (;;) {
+        int                     child = 2 * i + 1;
+
+        if (child >= len)
+            break;
+        if (child + 1 < len &&
+            screen_priv->fake_queue[child + 1]->msc < screen_priv->fake_queue[child]->msc)
+            child++;
+        if (fake_vblank->msc <= screen_priv->fake_queue[child]->msc)
+            break;
+        present_fake_heap_set(screen_priv, i, screen_priv->fake_queue[child]);
+        i = child;
+    }
+    present_fake_heap_set(screen_priv, i, fake_vblank);
+}
+
+static Bool
+present_fake_heap_insert(present_screen_priv_ptr screen_priv, present_fake_vblank_ptr fake_vblank)
+{
+    if (screen_priv->fake_queue_len == screen_priv->fake_queue_size) {
+        int                     size = screen_priv->fake_queue_size ? screen_priv->fake_queue_size * 2 : 16;
+        present_fake_vblank_ptr *queue;
+
+        queue = realloc(screen_priv->fake_queue, size * sizeof (present_fake_vblank_ptr));
+        if (!queue)
+            return FALSE;
+        screen_priv->fake_queue = queue;
+        screen_priv->fake_queue_size = size;
+    }
+    present_fake_heap_set(screen_priv, screen_priv->fake_queue_len++, fake_vblank);
+    present_fake_heap_up(screen_priv, fake_vblank->heap_index);
+    return TRUE;
+}
+
+static void
+present_fake_heap_remove(present_screen_priv_ptr screen_priv, present_fake_vblank_ptr fake_vblank)
+{
+    int                         i = fake_vblank->heap_index;
+    present_fake_vblank_ptr     last = screen_priv->fake_queue[--screen_priv->fake_queue_len];
+
+    if (last == fake_vblank)
+        return;
+    present_fake_heap_set(screen_priv, i, last);
+    if (i > 0 && screen_priv->fake_queue[(i - 1) / 2]->msc > last->msc)
+        present_fake_heap_up(screen_priv, i);
+    else
+        present_fake_heap_down(screen_priv, i);
+}
+
+/*
+ * Milliseconds until the earliest queued vblank is due, rounded up so
+ * the timer never fires early, or 0 when nothing is queued. Never
+ * returns 0 for a queued vblank so that TimerSet doesn't run the
+ * callback from inside itself.
+ */
+static CARD32
+present_fake_next_delay(present_screen_priv_ptr screen_priv)
+{
+    int64_t                     delay;
+
+    if (screen_priv->fake_queue_len == 0)
+        return 0;
+    delay = present_fake_msc_to_ust(screen_priv, screen_priv->fake_queue[0]->msc) - GetTimeInNanos();
+    delay = (delay + 999999) / 1000000;
+    if (delay < 1)
+        delay = 1;
+    return delay;
+}
+
+static void
+present_fake_account(present_screen_priv_ptr screen_priv, uint64_t msc, uint64_t now)
+{
+    uint64_t                    latency = now - present_fake_msc_to_ust(screen_priv, msc);
+
+    screen_priv->fake_delivered++;
+    if (latency >= screen_priv->fake_interval)
+        screen_priv->fake_missed++;
+    else if (latency > FAKE_VBLANK_LATE)
+        screen_priv->fake_late++;
+    if (latency > screen_priv->fake_max_latency)
+        screen_priv->fake_max_latency = latency;
+}
+
 static CARD32
 present_fake_do_timer(OsTimerPtr timer,
                       CARD32 time,
                       void *arg)
 {
-    present_fake_vblank_ptr     fake_vblank = arg;
+    ScreenPtr                   screen = arg;
+    present_screen_priv_ptr     screen_priv = present_screen_priv(screen);
+    uint64_t                    now = GetTimeInNanos();
+    uint64_t                    msc = present_fake_current_msc(screen_priv, now);
+    present_fake_vblank_ptr     fake_vblank;
 
-    present_fake_notify(fake_vblank->screen, fake_vblank->event_id);
-    xorg_list_del(&fake_vblank->list);
-    free(fake_vblank);
-    return 0;
+    /* Deliver everything which is due now */
+    while (screen_priv->fake_queue_len) {
+        uint64_t                event_id;
+
+        fake_vblank = screen_priv->fake_queue[0];
+        if (fake_vblank->msc > msc)
+            break;
+        present_fake_heap_remove(screen_priv, fake_vblank);
+        xorg_list_del(&fake_vblank->list);
+        present_fake_account(screen_priv, fake_vblank->msc, now);
+        event_id = fake_vblank->event_id;
+        free(fake_vblank);
+        present_fake_notify(screen, event_id);
+    }
+    return present_fake_next_delay(screen_priv);
 }
 
 void
 present_fake_abort_vblank(ScreenPtr screen, uint64_t event_id, uint64_t msc)
 {
+    present_screen_priv_ptr     screen_priv = present_screen_priv(screen);
     present_fake_vblank_ptr     fake_vblank, tmp;
 
-    xorg_list_for_each_entry_safe(fake_vblank, tmp, &fake_vblank_queue, list) {
-        if (fake_vblank->event_id == event_id) {
-            TimerCancel(fake_vblank->timer);
+    xorg_list_for_each_entry_safe(fake_vblank, tmp, present_fake_bucket(event_id), list) {
+        if (fake_vblank->event_id == event_id && fake_vblank->screen == screen) {
+            present_fake_heap_remove(screen_priv, fake_vblank);
             xorg_list_del(&fake_vblank->list);
             free (fake_vblank);
             break;
         }
     }
+    if (screen_priv->fake_queue_len == 0)
+        TimerCancel(screen_priv->fake_timer);
 }
 
 int
@@ -89,12 +279,9 @@ present_fake_queue_vblank(ScreenPtr     screen,
                           uint64_t      msc)
 {
     present_screen_priv_ptr     screen_priv = present_screen_priv(screen);
-    uint64_t                    ust = msc * screen_priv->fake_interval;
-    uint64_t                    now = GetTimeInMicros();
-    INT32                       delay = ((int64_t) (ust - now)) / 1000;
     present_fake_vblank_ptr     fake_vblank;
 
-    if (delay <= 0) {
+    if (msc <= present_fake_current_msc(screen_priv, GetTimeInNanos())) {
         present_fake_notify(screen, event_id);
         return Success;
     }
@@ -105,36 +292,116 @@ present_fake_queue_vblank(ScreenPtr     screen,
 
     fake_vblank->screen = screen;
     fake_vblank->event_id = event_id;
-    fake_vblank->timer = TimerSet(NULL, 0, delay, present_fake_do_timer, fake_vblank);
-    if (!fake_vblank->timer) {
+    fake_vblank->msc = msc;
+    if (!present_fake_heap_insert(screen_priv, fake_vblank)) {
         free(fake_vblank);
         return BadAlloc;
     }
+    xorg_list_add(&fake_vblank->list, present_fake_bucket(event_id));
 
-    xorg_list_add(&fake_vblank->list, &fake_vblank_queue);
+    /* Re-arm the timer only when the new vblank is the earliest one */
+    if (fake_vblank->heap_index == 0) {
+        screen_priv->fake_timer = TimerSet(screen_priv->fake_timer, 0,
+                                           present_fake_next_delay(screen_priv),
+                                           present_fake_do_timer, screen);
+        if (!screen_priv->fake_timer) {
+            present_fake_heap_remove(screen_priv, fake_vblank);
+            xorg_list_del(&fake_vblank->list);
+            free(fake_vblank);
+            return BadAlloc;
+        }
+    }
 
     return Success;
 }
 
-void
-present_fake_screen_init(ScreenPtr screen)
+static uint64_t
+present_fake_default_interval(ScreenPtr screen)
 {
     present_screen_priv_ptr screen_priv = present_screen_priv(screen);
+    uint32_t                refresh = 0;
+
+    if (screen->myNum < MAXSCREENS)
+        refresh = fake_refresh[screen->myNum];
 
     /* For screens with hardware vblank support, the fake code
      * will be used for off-screen windows and while screens are blanked,
      * in which case we want a slow interval here
      *
-     * Otherwise, pretend that the screen runs at 60Hz
+     * Otherwise, pretend that the screen runs at 60Hz unless told
+     * otherwise
      */
     if (screen_priv->info && screen_priv->info->get_crtc)
-        screen_priv->fake_interval = 1000000;
-    else
-        screen_priv->fake_interval = 16667;
+        return 1000000000;
+    if (refresh)
+        return 1000000000000ULL / refresh;
+    return 16666667;
+}
+
+void
+present_set_fake_refresh(int screen_num, uint32_t refresh_mhz)
+{
+    ScreenPtr                   screen;
+    present_screen_priv_ptr     screen_priv;
+
+    if (screen_num < 0 || screen_num >= MAXSCREENS)
+        return;
+    fake_refresh[screen_num] = refresh_mhz;
+
+    /* Already running? Switch over right away */
+    if (screen_num >= screenInfo.numScreens ||
+        !dixPrivateKeyRegistered(&present_screen_private_key))
+        return;
+    screen = screenInfo.screens[screen_num];
+    screen_priv = present_screen_priv(screen);
+    if (!screen_priv)
+        return;
+    present_fake_set_interval(screen_priv, present_fake_default_interval(screen));
+    if (screen_priv->fake_queue_len)
+        screen_priv->fake_timer = TimerSet(screen_priv->fake_timer, 0,
+                                           present_fake_next_delay(screen_priv),
+                                           present_fake_do_timer, screen);
+}
+
+void
+present_fake_screen_init(ScreenPtr screen)
+{
+    present_screen_priv_ptr screen_priv = present_screen_priv(screen);
+
+    present_fake_set_interval(screen_priv, present_fake_default_interval(screen));
+}
+
+void
+present_fake_screen_fini(ScreenPtr screen)
+{
+    present_screen_priv_ptr screen_priv = present_screen_priv(screen);
+
+    while (screen_priv->fake_queue_len) {
+        present_fake_vblank_ptr fake_vblank = screen_priv->fake_queue[0];
+
+        present_fake_heap_remove(screen_priv, fake_vblank);
+        xorg_list_del(&fake_vblank->list);
+        free(fake_vblank);
+    }
+    if (screen_priv->fake_delivered)
+        LogMessageVerb(X_INFO, 4,
+                       "present: screen %d: %u fake vblanks, %u late, %u missed, "
+                       "max latency %llu us\n", screen->myNum,
+                       screen_priv->fake_delivered, screen_priv->fake_late,
+                       screen_priv->fake_missed,
+                       (unsigned long long) screen_priv->fake_max_latency / 1000);
+    free(screen_priv->fake_queue);
+    screen_priv->fake_queue = NULL;
+    screen_priv->fake_queue_size = 0;
+    TimerFree(screen_priv->fake_timer);
+    screen_priv->fake_timer = NULL;
 }
 
 void
 present_fake_queue_init(void)
 {
-    xorg_list_init(&fake_vblank_queue);
+    int i;
+
+    for (i = 0; i < FAKE_VBLANK_HASH_SIZE; i++)
+        xorg_list_init(&fake_vblank_hash[i]);
 }
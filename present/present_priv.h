@@ -41,6 +41,8 @@ extern DevPrivateKeyRec present_screen_private_key;
 
 typedef struct present_fence *present_fence_ptr;
 
+typedef struct present_fake_vblank *present_fake_vblank_ptr;
+
 typedef struct present_notify present_notify_rec, *present_notify_ptr;
 
 struct present_notify {
@@ -51,7 +53,7 @@ struct present_notify {
 
 struct present_vblank {
     struct xorg_list    window_list;
-    struct xorg_list    event_queue;
+    struct xorg_list    event_queue;    /* in present_event_hash */
     ScreenPtr           screen;
     WindowPtr           window;
     PixmapPtr           pixmap;
@@ -69,7 +71,7 @@ struct present_vblank {
     present_fence_ptr   wait_fence;
     present_notify_ptr  notifies;
     int                 num_notifies;
-    Bool                queued;         /* on present_exec_queue */
+    Bool                queued;         /* waiting to execute */
     Bool                flip;           /* planning on using flip */
     Bool                sync_flip;      /* do flip synchronous to vblank */
     Bool                abort_flip;     /* aborting this flip */
@@ -84,7 +86,24 @@ typedef struct present_screen_priv {
     present_vblank_ptr          flip_pending;
     uint64_t                    unflip_event_id;
 
-    uint32_t                    fake_interval;
+    /* Fake CRTC timing, in nanoseconds. MSC 'fake_base_msc' happened
+     * at 'fake_base_ust' and every 'fake_interval' after that
+     */
+    uint64_t                    fake_interval;
+    uint64_t                    fake_base_ust;
+    uint64_t                    fake_base_msc;
+
+    /* Fake vblank delivery statistics */
+    uint32_t                    fake_delivered;
+    uint32_t                    fake_late;      /* delivered in the right frame, but late */
+    uint32_t                    fake_missed;    /* delivered in a later frame */
+    uint64_t                    fake_max_latency;
+
+    /* Fake vblanks, a min-heap ordered by target MSC */
+    present_fake_vblank_ptr     *fake_queue;
+    int                         fake_queue_len;
+    int                         fake_queue_size;
+    OsTimerPtr                  fake_timer;
 
     /* Currently active flipped pixmap and fence */
     RRCrtcPtr                   flip_crtc;
@@ -235,6 +254,9 @@ present_fake_abort_vblank(ScreenPtr screen, uint64_t event_id, uint64_t msc);
 void
 present_fake_screen_init(ScreenPtr screen);
 
+void
+present_fake_screen_fini(ScreenPtr screen);
+
 void
 present_fake_queue_init(void);
 
@@ -58,6 +58,7 @@ present_close_screen(ScreenPtr screen)
     present_screen_priv_ptr screen_priv = present_screen_priv(screen);
 
     present_flip_destroy(screen);
+    present_fake_screen_fini(screen);
 
     unwrap(screen_priv, screen, CloseScreen);
     (*screen->CloseScreen) (screen);
@@ -49,6 +49,16 @@ and Jim Haggerty of Metheus.
 #include <stdio.h>
 #include <assert.h>
 
+#if XTRANS_SEND_FDS && defined(HAVE_MEMFD_CREATE)
+#include <fcntl.h>
+#ifdef F_ADD_SEALS
+#define RECORD_RING 1
+#include "ring.h"
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#endif
+
 #ifdef PANORAMIX
 #include "globals.h"
 #include "panoramiX.h"
@@ -65,12 +75,55 @@ static RESTYPE RTContext;       /* internal resource type for Record contexts */
  */
 #define REPLY_BUF_SIZE 1024
 
+#ifdef RECORD_RING
+/*  EnableContextRing (RECORD 1.14) enables a context in capture mode: instead
+ *  of streaming EnableContext replies, recorded protocol is appended to a
+ *  ring buffer in a sealed memfd that is passed to the recording client,
+ *  which stays free to send requests and disables the context when done.
+ *  The request isn't in recordproto yet, so its wire format is defined here.
+ *
+ *  The ring itself is in ring.c.
+ */
+#define X_RecordEnableContextRing	8
+
+typedef struct {
+    CARD8 reqType;
+    CARD8 recordReqType;
+    CARD16 length;
+    CARD32 context;
+    CARD32 size;                /* requested ring size in bytes, or 0 */
+} xRecordEnableContextRingReq;
+
+#define sz_xRecordEnableContextRingReq 12
+
+typedef struct {
+    BYTE type;
+    CARD8 nfd;
+    CARD16 sequenceNumber;
+    CARD32 length;
+    CARD32 size;                /* ring size in bytes, a power of two */
+    CARD32 dataOffset;          /* offset of the ring in the mapping */
+    CARD32 pad0;
+    CARD32 pad1;
+    CARD32 pad2;
+    CARD32 pad3;
+} xRecordEnableContextRingReply;
+
+#define sz_xRecordEnableContextRingReply 32
+#endif                          /* RECORD_RING */
+
 /* Record Context structure */
 
 typedef struct {
     XID id;                     /* resource id of context */
     ClientPtr pRecordingClient; /* client that has context enabled */
     struct _RecordClientsAndProtocolRec *pListOfRCAP;   /* all registered info */
+    struct _RecordClientsAndProtocolRec *pLookupRCAP;   /* last client lookup */
+    XID lookupClient;           /* client of the last lookup */
+    Bool lookupValid;           /* are the two above current? */
+#ifdef RECORD_RING
+    RecordRingPtr pRing;        /* ring buffer, if enabled in capture mode */
+#endif
     ClientPtr pBufClient;       /* client whose protocol is in replyBuffer */
     unsigned int continuedReply:1;      /* recording a reply that is split up? */
     char elemHeaders;           /* element header flags (time/seq no.) */
@@ -139,6 +192,8 @@ static int numEnabledRCAPs;
 static int RecordDeleteContext(void     *value,
                                XID      id);
 
+static void RecordDisableContext(RecordContextPtr pContext);
+
 /***************************************************************************/
 
 /* client private stuff */
@@ -236,6 +291,10 @@ RecordFlushReplyBuffer(RecordContextPtr pContext,
     if (!pContext->pRecordingClient || pContext->pRecordingClient->clientGone ||
         pContext->inFlush)
         return;
+#ifdef RECORD_RING
+    if (pContext->pRing)
+        return;
+#endif
     ++pContext->inFlush;
     if (pContext->numBufBytes)
         WriteToClient(pContext->pRecordingClient, pContext->numBufBytes,
@@ -248,6 +307,38 @@ RecordFlushReplyBuffer(RecordContextPtr pContext,
     --pContext->inFlush;
 }                               /* RecordFlushReplyBuffer */
 
+#ifdef RECORD_RING
+/* RecordRingElement
+ *
+ * The capture mode counterpart of RecordAProtocolElement, with the same
+ * arguments.  The element header is written at the start of an element,
+ * the element is published to the client when its last piece has been
+ * copied.  An element that doesn't fit is dropped with all its pieces.
+ */
+static void
+RecordRingElement(RecordContextPtr pContext, ClientPtr pClient,
+                  int category, void *data, int datalen, int padlen,
+                  int futurelen)
+{
+    RecordRingPtr pRing = pContext->pRing;
+
+    if (futurelen >= 0) {       /* start of new protocol element */
+        RecordRingElementRec elem;
+
+        elem.length = sizeof(elem) + pad_to_int32(datalen + futurelen);
+        elem.category = category;
+        elem.clientSwapped = pClient ? pClient->swapped : xFalse;
+        elem.pad = 0;
+        elem.serverTime = GetTimeInMillis();
+        elem.idBase = pClient ? pClient->clientAsMask : 0;
+        elem.recordedSequenceNumber = pClient ? pClient->sequence : 0;
+        if (!RecordRingStart(pRing, &elem))
+            return;
+    }
+    RecordRingAppend(pRing, data, datalen, padlen);
+}                               /* RecordRingElement */
+#endif                          /* RECORD_RING */
+
 /* RecordAProtocolElement
  *
  * Arguments:
@@ -288,6 +379,14 @@ RecordAProtocolElement(RecordContextPtr pContext, ClientPtr pClient,
     Bool gotServerTime = FALSE;
     int replylen;
 
+#ifdef RECORD_RING
+    if (pContext->pRing) {
+        RecordRingElement(pContext, pClient, category, data, datalen, padlen,
+                          futurelen);
+        return;
+    }
+#endif
+
     if (futurelen >= 0) {       /* start of new protocol element */
         xRecordEnableContextReply *pRep = (xRecordEnableContextReply *)
             pContext->replyBuffer;
@@ -410,7 +509,11 @@ RecordAProtocolElement(RecordContextPtr pContext, ClientPtr pClient,
  *	*pposition will be set to the index into the returned the RCAP's
  *	pClientIDs array that holds clientspec.
  *
- * Side Effects: none.
+ * Side Effects:
+ *	The result is remembered on the context, so that the lookups done
+ *	for every recorded request, reply and event of the same client
+ *	don't have to search the RCAPs again.  Anything that changes the
+ *	clients of a context's RCAPs must call RecordInvalidateLookup.
  */
 static RecordClientsAndProtocolPtr
 RecordFindClientOnContext(RecordContextPtr pContext,
@@ -418,6 +521,10 @@ RecordFindClientOnContext(RecordContextPtr pContext,
 {
     RecordClientsAndProtocolPtr pRCAP;
 
+    if (!pposition && pContext->lookupValid &&
+        pContext->lookupClient == clientspec)
+        return pContext->pLookupRCAP;
+
     for (pRCAP = pContext->pListOfRCAP; pRCAP; pRCAP = pRCAP->pNextRCAP) {
         int i;
 
@@ -425,13 +532,20 @@ RecordFindClientOnContext(RecordContextPtr pContext,
             if (pRCAP->pClientIDs[i] == clientspec) {
                 if (pposition)
                     *pposition = i;
-                return pRCAP;
+                break;
             }
         }
+        if (i < pRCAP->numClients)
+            break;
     }
-    return NULL;
+    pContext->pLookupRCAP = pRCAP;
+    pContext->lookupClient = clientspec;
+    pContext->lookupValid = TRUE;
+    return pRCAP;
 }                               /* RecordFindClientOnContext */
 
+#define RecordInvalidateLookup(_pContext) ((_pContext)->lookupValid = FALSE)
+
 /* RecordABigRequest
  *
  * Arguments:
@@ -1028,6 +1142,7 @@ RecordUninstallHooks(RecordClientsAndProtocolPtr pRCAP, XID oneclient)
 static void
 RecordDeleteClientFromRCAP(RecordClientsAndProtocolPtr pRCAP, int position)
 {
+    RecordInvalidateLookup(pRCAP->pContext);
     if (pRCAP->pContext->pRecordingClient)
         RecordUninstallHooks(pRCAP, pRCAP->pClientIDs[position]);
     if (position != pRCAP->numClients - 1)
@@ -1096,6 +1211,7 @@ RecordAddClientToRCAP(RecordClientsAndProtocolPtr pRCAP, XID clientspec)
         }
     }
     pRCAP->pClientIDs[pRCAP->numClients++] = clientspec;
+    RecordInvalidateLookup(pRCAP->pContext);
     if (pRCAP->pContext->pRecordingClient)
         RecordInstallHooks(pRCAP, clientspec);
 }                               /* RecordDeleteClientFromRCAP */
@@ -1795,6 +1911,7 @@ RecordRegisterClients(RecordContextPtr pContext, ClientPtr client,
 
     pRCAP->pNextRCAP = pContext->pListOfRCAP;
     pContext->pListOfRCAP = pRCAP;
+    RecordInvalidateLookup(pContext);
 
     if (pContext->pRecordingClient)     /* context enabled */
         RecordInstallHooks(pRCAP, 0);
@@ -1817,7 +1934,7 @@ RecordRegisterClients(RecordContextPtr pContext, ClientPtr client,
 static int
 ProcRecordQueryVersion(ClientPtr client)
 {
-    /* REQUEST(xRecordQueryVersionReq); */
+    REQUEST(xRecordQueryVersionReq);
     xRecordQueryVersionReply rep = {
         .type = X_Reply,
         .sequenceNumber = client->sequence,
@@ -1827,6 +1944,15 @@ ProcRecordQueryVersion(ClientPtr client)
     };
 
     REQUEST_SIZE_MATCH(xRecordQueryVersionReq);
+    /* Capture mode (1.14) is only announced to clients asking for it.  The
+     * ring is in server byte order, so swapped clients can't use it.
+     */
+    if (stuff->majorVersion != SERVER_RECORD_MAJOR_VERSION ||
+        stuff->minorVersion < SERVER_RECORD_MINOR_VERSION || client->swapped)
+        rep.minorVersion = SERVER_RECORD_MINOR_VERSION - 1;
+#ifndef RECORD_RING
+    rep.minorVersion = SERVER_RECORD_MINOR_VERSION - 1;
+#endif
     if (client->swapped) {
         swaps(&rep.sequenceNumber);
         swaps(&rep.majorVersion);
@@ -1862,6 +1988,12 @@ ProcRecordCreateContext(ClientPtr client)
     pContext->id = stuff->context;
     pContext->pRecordingClient = NULL;
     pContext->pListOfRCAP = NULL;
+    pContext->pLookupRCAP = NULL;
+    pContext->lookupClient = 0;
+    pContext->lookupValid = FALSE;
+#ifdef RECORD_RING
+    pContext->pRing = NULL;
+#endif
     pContext->elemHeaders = 0;
     pContext->bufCategory = 0;
     pContext->numBufBytes = 0;
@@ -2279,20 +2411,24 @@ ProcRecordGetContext(ClientPtr client)
     return err;
 }                               /* ProcRecordGetContext */
 
+/* RecordEnableContext
+ *
+ * Arguments:
+ *	pContext is the context to enable.
+ *	client is the client that will receive the recorded protocol.
+ *
+ * Returns: Success, or the error from installing the recording hooks.
+ *
+ * Side Effects:
+ *	Recording hooks are installed for each RCAP, the context is moved
+ *	to the front part of ppAllContexts and StartOfData is recorded.
+ */
 static int
-ProcRecordEnableContext(ClientPtr client)
+RecordEnableContext(RecordContextPtr pContext, ClientPtr client)
 {
-    RecordContextPtr pContext;
-
-    REQUEST(xRecordEnableContextReq);
     int i;
     RecordClientsAndProtocolPtr pRCAP;
 
-    REQUEST_SIZE_MATCH(xRecordGetContextReq);
-    VERIFY_CONTEXT(pContext, stuff->context, client);
-    if (pContext->pRecordingClient)
-        return BadMatch;        /* already enabled */
-
     /* install record hooks for each RCAP */
 
     for (pRCAP = pContext->pListOfRCAP; pRCAP; pRCAP = pRCAP->pNextRCAP) {
@@ -2310,10 +2446,6 @@ ProcRecordEnableContext(ClientPtr client)
         }
     }
 
-    /* Disallow further request processing on this connection until
-     * the context is disabled.
-     */
-    IgnoreClient(client);
     pContext->pRecordingClient = client;
 
     /* Don't allow the data connection to record itself; unregister it. */
@@ -2337,8 +2469,111 @@ ProcRecordEnableContext(ClientPtr client)
     RecordAProtocolElement(pContext, NULL, XRecordStartOfData, NULL, 0, 0, 0);
     RecordFlushReplyBuffer(pContext, NULL, 0, NULL, 0);
     return Success;
+}                               /* RecordEnableContext */
+
+static int
+ProcRecordEnableContext(ClientPtr client)
+{
+    RecordContextPtr pContext;
+    int err;
+
+    REQUEST(xRecordEnableContextReq);
+
+    REQUEST_SIZE_MATCH(xRecordGetContextReq);
+    VERIFY_CONTEXT(pContext, stuff->context, client);
+    if (pContext->pRecordingClient)
+        return BadMatch;        /* already enabled */
+
+    err = RecordEnableContext(pContext, client);
+    if (err != Success)
+        return err;
+
+    /* Disallow further request processing on this connection until
+     * the context is disabled.
+     */
+    IgnoreClient(client);
+    return Success;
 }                               /* ProcRecordEnableContext */
 
+#ifdef RECORD_RING
+static void
+RecordFreeRing(RecordRingPtr pRing)
+{
+    munmap(pRing->header, RECORD_RING_DATA + pRing->mask + 1);
+    free(pRing);
+}                               /* RecordFreeRing */
+
+static int
+ProcRecordEnableContextRing(ClientPtr client)
+{
+    RecordContextPtr pContext;
+    RecordRingPtr pRing;
+    CARD32 size;
+    void *map;
+    int fd, err;
+
+    REQUEST(xRecordEnableContextRingReq);
+    xRecordEnableContextRingReply rep = {
+        .type = X_Reply,
+        .nfd = 1,
+        .sequenceNumber = client->sequence,
+        .length = 0,
+        .dataOffset = RECORD_RING_DATA
+    };
+
+    REQUEST_SIZE_MATCH(xRecordEnableContextRingReq);
+    VERIFY_CONTEXT(pContext, stuff->context, client);
+    if (pContext->pRecordingClient)
+        return BadMatch;        /* already enabled */
+
+    if (stuff->size > RECORD_RING_MAX) {
+        client->errorValue = stuff->size;
+        return BadValue;
+    }
+    for (size = RECORD_RING_MIN;
+         size < (stuff->size ? stuff->size : RECORD_RING_DEFAULT); size <<= 1);
+
+    pRing = calloc(1, sizeof(RecordRingRec));
+    if (!pRing)
+        return BadAlloc;
+    fd = memfd_create("xorg-record", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) {
+        free(pRing);
+        return BadAlloc;
+    }
+    /* Seal the size so the client can't truncate the ring under us and
+     * fault the server when it writes */
+    if (ftruncate(fd, RECORD_RING_DATA + size) < 0 ||
+        fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0 ||
+        (map = mmap(NULL, RECORD_RING_DATA + size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED, fd, 0)) == MAP_FAILED) {
+        close(fd);
+        free(pRing);
+        return BadAlloc;
+    }
+    RecordRingInit(pRing, map, size);
+
+    /* StartOfData goes into the ring, where the client will find it */
+    pContext->pRing = pRing;
+    err = RecordEnableContext(pContext, client);
+    if (err != Success) {
+        pContext->pRing = NULL;
+        RecordFreeRing(pRing);
+        close(fd);
+        return err;
+    }
+
+    if (WriteFdToClient(client, fd, TRUE) < 0) {
+        RecordDisableContext(pContext);
+        close(fd);
+        return BadAlloc;
+    }
+    rep.size = size;
+    WriteToClient(client, sizeof(xRecordEnableContextRingReply), &rep);
+    return Success;
+}                               /* ProcRecordEnableContextRing */
+#endif                          /* RECORD_RING */
+
 /* RecordDisableContext
  *
  * Arguments:
@@ -2367,7 +2602,10 @@ RecordDisableContext(RecordContextPtr pContext)
         RecordAProtocolElement(pContext, NULL, XRecordEndOfData, NULL, 0, 0, 0);
         RecordFlushReplyBuffer(pContext, NULL, 0, NULL, 0);
         /* Re-enable request processing on this connection. */
-        AttendClient(pContext->pRecordingClient);
+#ifdef RECORD_RING
+        if (!pContext->pRing)
+#endif
+            AttendClient(pContext->pRecordingClient);
     }
 
     for (pRCAP = pContext->pListOfRCAP; pRCAP; pRCAP = pRCAP->pNextRCAP) {
@@ -2375,6 +2613,12 @@ RecordDisableContext(RecordContextPtr pContext)
     }
 
     pContext->pRecordingClient = NULL;
+#ifdef RECORD_RING
+    if (pContext->pRing) {
+        RecordFreeRing(pContext->pRing);
+        pContext->pRing = NULL;
+    }
+#endif
 
     /* move the newly disabled context to the rear part of ppAllContexts,
      * where all the disabled contexts are
@@ -2485,6 +2729,10 @@ ProcRecordDispatch(ClientPtr client)
         return ProcRecordDisableContext(client);
     case X_RecordFreeContext:
         return ProcRecordFreeContext(client);
+#ifdef RECORD_RING
+    case X_RecordEnableContextRing:
+        return ProcRecordEnableContextRing(client);
+#endif
     default:
         return BadRequest;
     }
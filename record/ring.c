@@ -0,0 +1,129 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <string.h>
+#include "ring.h"
+
+void
+RecordRingInit(RecordRingPtr pRing, void *map, CARD32 size)
+{
+    memset(pRing, 0, sizeof(*pRing));
+    pRing->header = map;
+    pRing->header->magic = RECORD_RING_MAGIC;
+    pRing->header->size = size;
+    pRing->header->dropped = 0;
+    pRing->header->head = 0;
+    pRing->header->tail = 0;
+    pRing->data = (char *) map + RECORD_RING_DATA;
+    pRing->mask = size - 1;
+}
+
+/* Copies len bytes, no more than the ring's size, from src to the ring at
+ * its unpublished head, wrapping around the end of the ring.  A NULL src
+ * writes zeros.
+ */
+static void
+RecordRingCopy(RecordRingPtr pRing, const void *src, CARD32 len)
+{
+    CARD32 offset = pRing->head & pRing->mask;
+    CARD32 n = min(len, pRing->mask + 1 - offset);
+
+    if (src) {
+        memcpy(pRing->data + offset, src, n);
+        memcpy(pRing->data, (const char *) src + n, len - n);
+    }
+    else {
+        memset(pRing->data + offset, 0, n);
+        memset(pRing->data, 0, len - n);
+    }
+    pRing->head += len;
+}
+
+static void
+RecordRingDrop(RecordRingPtr pRing)
+{
+    pRing->header->dropped++;
+    pRing->dropping = TRUE;
+}
+
+Bool
+RecordRingStart(RecordRingPtr pRing, RecordRingElementRec * elem)
+{
+    CARD32 size = pRing->mask + 1;
+    uint64_t tail, used;
+
+#ifdef __GNUC__
+    tail = __atomic_load_n(&pRing->header->tail, __ATOMIC_ACQUIRE);
+#else
+    tail = pRing->header->tail;
+#endif
+    /* A tail past head, or further back than the ring holds, is corrupt;
+     * trusting it would have us write past the end of the ring. */
+    used = pRing->head - tail;
+    if (used > size || elem->length < sizeof(*elem) ||
+        elem->length > size - used) {
+        RecordRingDrop(pRing);
+        return FALSE;
+    }
+
+    pRing->dropping = FALSE;
+    pRing->start = pRing->head;
+    RecordRingCopy(pRing, elem, sizeof(*elem));
+    pRing->remaining = elem->length - sizeof(*elem);
+    return TRUE;
+}
+
+void
+RecordRingAppend(RecordRingPtr pRing, const void *data, int datalen,
+                 int padlen)
+{
+    if (pRing->dropping)
+        return;
+
+    if (datalen < padlen || (CARD32) datalen > pRing->remaining) {
+        /* more than the element made room for: take it back out */
+        pRing->head = pRing->start;
+        RecordRingDrop(pRing);
+        return;
+    }
+
+    if (datalen) {
+        RecordRingCopy(pRing, data, datalen - padlen);
+        RecordRingCopy(pRing, NULL, padlen);
+        pRing->remaining -= datalen;
+    }
+
+    /* last piece: pad to a CARD32 boundary and publish */
+    if (pRing->remaining < 4) {
+        if (pRing->remaining)
+            RecordRingCopy(pRing, NULL, pRing->remaining);
+        pRing->remaining = 0;
+#ifdef __GNUC__
+        __atomic_store_n(&pRing->header->head, pRing->head, __ATOMIC_RELEASE);
+#else
+        pRing->header->head = pRing->head;
+#endif
+    }
+}
@@ -0,0 +1,97 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ *  The ring buffer behind RECORD's capture mode (EnableContextRing).
+ *
+ *  The mapping starts with a RecordRingHeaderRec; the ring data follows at
+ *  RECORD_RING_DATA.  The server advances head once an element is complete,
+ *  the client advances tail as it consumes them.  Both count bytes since
+ *  the ring was created, the offset into the ring is the count modulo its
+ *  size.  Elements that don't fit are dropped and counted.
+ *
+ *  The header is shared with the recording client, so the server never
+ *  trusts what it reads back from it: a tail that claims more than the
+ *  ring holds is taken as a corrupt ring and every element is dropped
+ *  until the client puts it right.
+ */
+
+#ifndef _RECORD_RING_H_
+#define _RECORD_RING_H_
+
+#include <stdint.h>
+#include <X11/Xmd.h>
+#include "misc.h"
+
+#define RECORD_RING_MAGIC	0x58524543      /* "XREC" */
+#define RECORD_RING_DATA	64
+#define RECORD_RING_DEFAULT	(1 << 20)
+#define RECORD_RING_MIN		(1 << 16)
+#define RECORD_RING_MAX		(1 << 26)
+
+typedef struct {
+    CARD32 magic;
+    CARD32 size;                /* ring size in bytes */
+    CARD32 dropped;             /* elements that didn't fit */
+    CARD32 pad;
+    uint64_t head;              /* bytes written, advanced by the server */
+    uint64_t tail;              /* bytes consumed, advanced by the client */
+} RecordRingHeaderRec;
+
+/* Each element starts with this header; length includes it and is a
+ * multiple of 4.  Byte order is the server's, recorded protocol is in the
+ * recorded client's byte order, as flagged by clientSwapped.
+ */
+typedef struct {
+    CARD32 length;
+    CARD8 category;
+    CARD8 clientSwapped;
+    CARD16 pad;
+    CARD32 serverTime;
+    CARD32 idBase;
+    CARD32 recordedSequenceNumber;
+} RecordRingElementRec;
+
+typedef struct _RecordRing {
+    RecordRingHeaderRec *header;        /* start of the mapping */
+    char *data;                 /* ring data */
+    CARD32 mask;                /* ring size - 1 */
+    uint64_t head;              /* bytes written, including unpublished */
+    uint64_t start;             /* head when the current element started */
+    CARD32 remaining;           /* bytes still due for the current element */
+    Bool dropping;              /* current element didn't fit */
+} RecordRingRec, *RecordRingPtr;
+
+/* Sets up pRing over map, RECORD_RING_DATA + size bytes, size a power of
+ * two. */
+extern void RecordRingInit(RecordRingPtr pRing, void *map, CARD32 size);
+
+/* Starts an element of elem->length bytes, header included, and copies
+ * the header.  Returns FALSE, and drops the element, if it doesn't fit. */
+extern Bool RecordRingStart(RecordRingPtr pRing, RecordRingElementRec * elem);
+
+/* Appends a piece of the current element: datalen bytes of which the last
+ * padlen are written as zeros.  The element is published once all of it
+ * has been appended.  Pieces of a dropped element are ignored. */
+extern void RecordRingAppend(RecordRingPtr pRing, const void *data,
+                             int datalen, int padlen);
+
+#endif                          /* _RECORD_RING_H_ */
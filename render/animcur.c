@@ -366,8 +366,8 @@ AnimCursorCreate(CursorPtr *cursors, CARD32 *deltas, int ncursor,
     pCursor->id = cid;
 
     /* security creation/labeling check */
-    rc = XaceHook(XACE_RESOURCE_ACCESS, client, cid, RT_CURSOR, pCursor,
-                  RT_NONE, NULL, DixCreateAccess);
+    rc = XaceHookResourceAccess(client, cid, RT_CURSOR, pCursor,
+                                RT_NONE, NULL, DixCreateAccess);
     if (rc != Success) {
         dixFiniPrivates(pCursor, PRIVATE_CURSOR);
         free(pCursor);
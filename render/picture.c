@@ -776,8 +776,9 @@ CreatePicture(Picture pid,
     pPicture->format = pFormat->format | (pDrawable->bitsPerPixel << 24);
 
     /* security creation/labeling check */
-    *error = XaceHook(XACE_RESOURCE_ACCESS, client, pid, PictureType, pPicture,
-                      RT_PIXMAP, pDrawable, DixCreateAccess | DixSetAttrAccess);
+    *error = XaceHookResourceAccess(client, pid, PictureType, pPicture,
+                                    RT_PIXMAP, pDrawable,
+                                    DixCreateAccess | DixSetAttrAccess);
     if (*error != Success)
         goto out;
 
@@ -939,8 +939,8 @@ ProcRenderCreateGlyphSet(ClientPtr client)
     if (!glyphSet)
         return BadAlloc;
     /* security creation/labeling check */
-    rc = XaceHook(XACE_RESOURCE_ACCESS, client, stuff->gsid, GlyphSetType,
-                  glyphSet, RT_NONE, NULL, DixCreateAccess);
+    rc = XaceHookResourceAccess(client, stuff->gsid, GlyphSetType,
+                                glyphSet, RT_NONE, NULL, DixCreateAccess);
     if (rc != Success)
         return rc;
     if (!AddResource(stuff->gsid, GlyphSetType, (void *) glyphSet))
@@ -1857,8 +1857,8 @@ ProcRenderCreateSolidFill(ClientPtr client)
     if (!pPicture)
         return error;
     /* security creation/labeling check */
-    error = XaceHook(XACE_RESOURCE_ACCESS, client, stuff->pid, PictureType,
-                     pPicture, RT_NONE, NULL, DixCreateAccess);
+    error = XaceHookResourceAccess(client, stuff->pid, PictureType,
+                                   pPicture, RT_NONE, NULL, DixCreateAccess);
     if (error != Success)
         return error;
     if (!AddResource(stuff->pid, PictureType, (void *) pPicture))
@@ -1896,8 +1896,8 @@ ProcRenderCreateLinearGradient(ClientPtr client)
     if (!pPicture)
         return error;
     /* security creation/labeling check */
-    error = XaceHook(XACE_RESOURCE_ACCESS, client, stuff->pid, PictureType,
-                     pPicture, RT_NONE, NULL, DixCreateAccess);
+    error = XaceHookResourceAccess(client, stuff->pid, PictureType,
+                                   pPicture, RT_NONE, NULL, DixCreateAccess);
     if (error != Success)
         return error;
     if (!AddResource(stuff->pid, PictureType, (void *) pPicture))
@@ -1934,8 +1934,8 @@ ProcRenderCreateRadialGradient(ClientPtr client)
     if (!pPicture)
         return error;
     /* security creation/labeling check */
-    error = XaceHook(XACE_RESOURCE_ACCESS, client, stuff->pid, PictureType,
-                     pPicture, RT_NONE, NULL, DixCreateAccess);
+    error = XaceHookResourceAccess(client, stuff->pid, PictureType,
+                                   pPicture, RT_NONE, NULL, DixCreateAccess);
     if (error != Success)
         return error;
     if (!AddResource(stuff->pid, PictureType, (void *) pPicture))
@@ -1971,8 +1971,8 @@ ProcRenderCreateConicalGradient(ClientPtr client)
     if (!pPicture)
         return error;
     /* security creation/labeling check */
-    error = XaceHook(XACE_RESOURCE_ACCESS, client, stuff->pid, PictureType,
-                     pPicture, RT_NONE, NULL, DixCreateAccess);
+    error = XaceHookResourceAccess(client, stuff->pid, PictureType,
+                                   pPicture, RT_NONE, NULL, DixCreateAccess);
     if (error != Success)
         return error;
     if (!AddResource(stuff->pid, PictureType, (void *) pPicture))
@@ -0,0 +1,199 @@
+/**
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+#include <stdint.h>
+#include "misc.h"
+#include "scrnintstr.h"
+#include "privates.h"
+#include "damage.h"
+#include "damagestr.h"
+
+#include <assert.h>
+
+/**
+ * Damage accumulation: boxes already inside the damage are skipped, and
+ * a box limit collapses the damage to its extents unless those are
+ * mostly undamaged.
+ */
+
+static ScreenRec screen;
+static int reports;
+static RegionRec reported;
+
+static void
+damage_report(DamagePtr pDamage, RegionPtr pRegion, void *closure)
+{
+    reports++;
+    RegionCopy(&reported, pRegion);
+}
+
+static void
+damage_box(DamagePtr pDamage, int x1, int y1, int x2, int y2)
+{
+    BoxRec box = { x1, y1, x2, y2 };
+    RegionRec region;
+
+    RegionInit(&region, &box, 1);
+    DamageReportDamage(pDamage, &region);
+    RegionUninit(&region);
+}
+
+/* a row of 10x10 boxes with 2 pixel gaps, mostly damaged */
+static void
+damage_row(DamagePtr pDamage, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+        damage_box(pDamage, i * 12, 0, i * 12 + 10, 10);
+}
+
+static void
+damage_init(void)
+{
+    dixResetPrivates();
+    memset(&screen, 0, sizeof(screen));
+    screenInfo.numScreens = 1;
+    screenInfo.screens[0] = &screen;
+    dixInitScreenSpecificPrivates(&screen);
+    if (!dixAllocatePrivates(&screen.devPrivates, PRIVATE_SCREEN))
+        FatalError("couldn't allocate screen privates");
+    if (!DamageSetup(&screen))
+        FatalError("couldn't set up damage");
+    RegionNull(&reported);
+}
+
+static void
+damage_contained(void)
+{
+    DamagePtr pDamage;
+    BoxRec box = { 10, 0, 15, 10 };
+
+    pDamage = DamageCreate(damage_report, NULL, DamageReportDeltaRegion,
+                           FALSE, &screen, NULL);
+    assert(pDamage);
+    reports = 0;
+
+    damage_box(pDamage, 0, 0, 10, 10);
+    assert(reports == 1);
+
+    /* inside the damage: nothing new, nothing reported */
+    damage_box(pDamage, 2, 2, 5, 5);
+    assert(reports == 1);
+    assert(RegionNumRects(DamageRegion(pDamage)) == 1);
+
+    /* overlapping: only the new part is reported */
+    damage_box(pDamage, 5, 0, 15, 10);
+    assert(reports == 2);
+    assert(RegionNumRects(&reported) == 1);
+    assert(!memcmp(RegionExtents(&reported), &box, sizeof(box)));
+
+    DamageDestroy(pDamage);
+}
+
+static void
+damage_collapse(void)
+{
+    DamagePtr pDamage;
+    BoxRec extents = { 0, 0, 58, 10 };
+    int i;
+
+    pDamage = DamageCreate(NULL, NULL, DamageReportNone,
+                           FALSE, &screen, NULL);
+    assert(pDamage);
+    DamageSetBoxLimit(pDamage, 4);
+
+    /* at the limit the region stays exact */
+    damage_row(pDamage, 4);
+    assert(RegionNumRects(DamageRegion(pDamage)) == 4);
+
+    /* past it, dense damage collapses to its extents */
+    damage_box(pDamage, 48, 0, 58, 10);
+    assert(RegionNumRects(DamageRegion(pDamage)) == 1);
+    assert(!memcmp(RegionExtents(DamageRegion(pDamage)), &extents,
+                   sizeof(extents)));
+
+    DamageEmpty(pDamage);
+
+    /* sparse damage stays exact past the limit */
+    for (i = 0; i < 6; i++)
+        damage_box(pDamage, i * 100, i * 100, i * 100 + 1, i * 100 + 1);
+    assert(RegionNumRects(DamageRegion(pDamage)) == 6);
+
+    /* setting a limit applies it straight away */
+    DamageEmpty(pDamage);
+    DamageSetBoxLimit(pDamage, 0);
+    damage_row(pDamage, 5);
+    assert(RegionNumRects(DamageRegion(pDamage)) == 5);
+    DamageSetBoxLimit(pDamage, 4);
+    assert(RegionNumRects(DamageRegion(pDamage)) == 1);
+
+    DamageDestroy(pDamage);
+}
+
+static void
+damage_delta_collapsed(void)
+{
+    DamagePtr pDamage;
+    BoxRec box = { 50, 5, 70, 15 };
+    BoxRec extents = { 0, 0, 58, 10 };
+    RegionRec expected, collapsed;
+
+    pDamage = DamageCreate(damage_report, NULL, DamageReportDeltaRegion,
+                           FALSE, &screen, NULL);
+    assert(pDamage);
+    DamageSetBoxLimit(pDamage, 4);
+    reports = 0;
+
+    damage_row(pDamage, 5);
+    assert(reports == 5);
+    assert(RegionNumRects(DamageRegion(pDamage)) == 1);
+
+    /* a gap between the boxes is now inside the damage */
+    damage_box(pDamage, 10, 0, 12, 10);
+    assert(reports == 5);
+
+    /* the delta is taken against the collapsed damage */
+    damage_box(pDamage, box.x1, box.y1, box.x2, box.y2);
+    assert(reports == 6);
+    RegionInit(&expected, &box, 1);
+    RegionInit(&collapsed, &extents, 1);
+    RegionSubtract(&expected, &expected, &collapsed);
+    assert(RegionEqual(&reported, &expected));
+    RegionUninit(&expected);
+    RegionUninit(&collapsed);
+
+    DamageDestroy(pDamage);
+}
+
+int
+main(int argc, char **argv)
+{
+    damage_init();
+    damage_contained();
+    damage_collapse();
+    damage_delta_collapsed();
+
+    return 0;
+}
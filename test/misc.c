@@ -26,7 +26,11 @@
 #endif
 
 #include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <X11/Xatom.h>
 #include "misc.h"
+#include "dix.h"
 #include "scrnintstr.h"
 
 ScreenInfo screenInfo;
@@ -155,11 +159,53 @@ dix_update_desktop_dimensions(void)
     assert_dimensions(-w2, -h2, w2, h2);
 }
 
+static void
+dix_atoms(void)
+{
+    char name[32];
+    Atom atom, first = None;
+    int i;
+
+    InitAtoms();
+    assert(!ValidAtom(None));
+    assert(ValidAtom(XA_LAST_PREDEFINED));
+    assert(!ValidAtom(XA_LAST_PREDEFINED + 1));
+    assert(strcmp(NameForAtom(XA_PRIMARY), "PRIMARY") == 0);
+    assert(MakeAtom("PRIMARY", 7, FALSE) == XA_PRIMARY);
+    assert(MakeAtom("PRIMARY", 7, TRUE) == XA_PRIMARY);
+    assert(MakeAtom("PRIM", 4, FALSE) == None);
+
+    /* enough to grow both the hash and the name table several times */
+    for (i = 0; i < 10000; i++) {
+        snprintf(name, sizeof(name), "test atom %d", i);
+        atom = MakeAtom(name, strlen(name), TRUE);
+        assert(atom == XA_LAST_PREDEFINED + 1 + i);
+        if (!first)
+            first = atom;
+    }
+    for (i = 0; i < 10000; i++) {
+        snprintf(name, sizeof(name), "test atom %d", i);
+        atom = MakeAtom(name, strlen(name), FALSE);
+        assert(atom == first + i);
+        assert(ValidAtom(atom));
+        assert(strcmp(NameForAtom(atom), name) == 0);
+    }
+
+    /* only len bytes of the string are significant */
+    assert(MakeAtom("test atom 12xyz", 12, FALSE) == first + 12);
+
+    InitAtoms();
+    assert(!ValidAtom(first));
+    assert(MakeAtom("test atom 0", 11, FALSE) == None);
+    assert(strcmp(NameForAtom(XA_WM_NAME), "WM_NAME") == 0);
+}
+
 int
 main(int argc, char **argv)
 {
     dix_version_compare();
     dix_update_desktop_dimensions();
+    dix_atoms();
 
     return 0;
 }
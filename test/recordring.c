@@ -0,0 +1,161 @@
+/**
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+#include <stdint.h>
+#include <string.h>
+#include "misc.h"
+#include "ring.h"
+
+#include <assert.h>
+
+/**
+ * The RECORD capture ring shares its header with the recording client, so
+ * whatever the client leaves there mustn't get the server to write
+ * outside the ring.
+ */
+
+#define RING_SIZE RECORD_RING_MIN
+
+static union {
+    RecordRingHeaderRec header;
+    char bytes[RECORD_RING_DATA + RING_SIZE + 64];
+} map;
+
+/* bytes past the end of the ring, which must never be written */
+#define GUARD ((unsigned char *) map.bytes + RECORD_RING_DATA + RING_SIZE)
+
+static void
+ring_init(RecordRingPtr pRing)
+{
+    memset(&map, 0xaa, sizeof(map));
+    RecordRingInit(pRing, &map, RING_SIZE);
+    assert(map.header.magic == RECORD_RING_MAGIC);
+    assert(map.header.size == RING_SIZE);
+}
+
+static void
+check_guard(void)
+{
+    int i;
+
+    for (i = 0; i < 64; i++)
+        assert(GUARD[i] == 0xaa);
+}
+
+static Bool
+add_element(RecordRingPtr pRing, CARD32 datalen)
+{
+    static char data[RING_SIZE * 2];
+    RecordRingElementRec elem = { 0 };
+
+    elem.length = sizeof(elem) + datalen;
+    if (!RecordRingStart(pRing, &elem))
+        return FALSE;
+    RecordRingAppend(pRing, data, datalen, 0);
+    return TRUE;
+}
+
+static void
+ring_elements(void)
+{
+    RecordRingRec ring;
+    uint64_t head;
+    int i;
+
+    ring_init(&ring);
+
+    /* fill the ring, then let the client consume half of it */
+    for (i = 0; add_element(&ring, 1000); i++);
+    assert(i == RING_SIZE / (1000 + sizeof(RecordRingElementRec)));
+    assert(map.header.dropped == 1);
+    assert(map.header.head == ring.head);
+
+    map.header.tail = map.header.head / 2;
+    assert(add_element(&ring, 1000));
+    assert(map.header.head == ring.head);
+
+    /* elements longer than the ring itself are never written */
+    map.header.tail = map.header.head;
+    head = map.header.head;
+    assert(!add_element(&ring, RING_SIZE));
+    assert(map.header.dropped == 2);
+    assert(map.header.head == head);
+
+    /* a piece longer than its element announced is taken back out */
+    {
+        RecordRingElementRec elem = { 0 };
+        static char data[4096];
+
+        elem.length = sizeof(elem) + 8;
+        assert(RecordRingStart(&ring, &elem));
+        RecordRingAppend(&ring, data, sizeof(data), 0);
+        assert(map.header.dropped == 3);
+        assert(ring.head == head);
+        assert(map.header.head == head);
+        assert(add_element(&ring, 16));
+    }
+    check_guard();
+}
+
+static void
+ring_bad_tail(void)
+{
+    RecordRingRec ring;
+    uint64_t head;
+    int i;
+
+    ring_init(&ring);
+    for (i = 0; i < 10; i++)
+        assert(add_element(&ring, 100));
+    head = map.header.head;
+
+    /* tail past head would make head - tail wrap around */
+    map.header.tail = head + 4;
+    assert(!add_element(&ring, RING_SIZE - 64));
+    assert(!add_element(&ring, 100));
+    assert(map.header.dropped == 2);
+    assert(map.header.head == head);
+    assert(ring.head == head);
+
+    /* and one further back than the ring holds */
+    map.header.tail = 0;
+    ring.head = head = RING_SIZE * 3;
+    assert(!add_element(&ring, 100));
+    assert(map.header.dropped == 3);
+    assert(ring.head == head);
+
+    /* back to normal once the client makes sense again */
+    map.header.tail = head;
+    assert(add_element(&ring, 100));
+    check_guard();
+}
+
+int
+main(int argc, char **argv)
+{
+    ring_elements();
+    ring_bad_tail();
+
+    return 0;
+}
@@ -0,0 +1,428 @@
+/**
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+#include <stdint.h>
+#include "misc.h"
+#include "dixstruct.h"
+#include "extinit.h"
+#include "syncsrv.h"
+#include "extnsionst.h"
+#include <X11/extensions/syncproto.h>
+
+#include <assert.h>
+
+/**
+ * Stress the counter trigger sets: fire a random walk of counter changes
+ * at a few thousand triggers and compare what fired, and the bracket
+ * values handed to the system counter, against a scan of all triggers.
+ */
+
+#define NUM_TRIGGERS 4096
+#define VALUE_RANGE 1024
+
+typedef struct {
+    SyncTrigger trigger;
+    Bool added;
+    int fired;
+    int expected;
+} TestTrigger;
+
+static TestTrigger triggers[NUM_TRIGGERS];
+static SyncCounter *counter;
+static CARD64 bracket_less, bracket_greater;
+static Bool has_less, has_greater;
+
+static int64_t
+value_of(CARD64 v)
+{
+    return ((int64_t) XSyncValueHigh32(v) << 32) | XSyncValueLow32(v);
+}
+
+static CARD64
+to_value(int64_t v)
+{
+    CARD64 value;
+
+    XSyncIntsToValue(&value, (unsigned int) v, (int) (v >> 32));
+    return value;
+}
+
+static Bool
+fires(int type, int64_t test, int64_t oldval, int64_t newval)
+{
+    switch (type) {
+    case XSyncPositiveComparison:
+        return newval >= test;
+    case XSyncNegativeComparison:
+        return newval <= test;
+    case XSyncPositiveTransition:
+        return oldval < test && newval >= test;
+    case XSyncNegativeTransition:
+        return oldval > test && newval <= test;
+    }
+    return FALSE;
+}
+
+static Bool
+check_trigger(SyncTrigger *pTrigger, CARD64 oldval)
+{
+    return fires(pTrigger->test_type, value_of(pTrigger->test_value),
+                 value_of(oldval), value_of(counter->value));
+}
+
+static void
+trigger_fired(SyncTrigger *pTrigger)
+{
+    ((TestTrigger *) pTrigger)->fired++;
+}
+
+static void
+counter_destroyed(SyncTrigger *pTrigger)
+{
+    ((TestTrigger *) pTrigger)->added = FALSE;
+}
+
+static void
+query_value(void *pCounter, CARD64 *pValue_return)
+{
+    *pValue_return = counter->value;
+}
+
+static void
+bracket_values(void *pCounter, CARD64 *pbracket_less,
+               CARD64 *pbracket_greater)
+{
+    has_less = pbracket_less != NULL;
+    has_greater = pbracket_greater != NULL;
+    if (has_less)
+        bracket_less = *pbracket_less;
+    if (has_greater)
+        bracket_greater = *pbracket_greater;
+}
+
+static void
+add_trigger(TestTrigger *t, int type, int64_t value)
+{
+    t->trigger.pSync = &counter->sync;
+    t->trigger.test_type = type;
+    t->trigger.test_value = to_value(value);
+    t->trigger.set_type = SYNC_NUM_TEST_TYPES;
+    t->trigger.CheckTrigger = check_trigger;
+    t->trigger.TriggerFired = trigger_fired;
+    t->trigger.CounterDestroyed = counter_destroyed;
+    assert(SyncAddTriggerToSyncObject(&t->trigger) == Success);
+    t->added = TRUE;
+}
+
+static void
+check_brackets(void)
+{
+    int64_t value = value_of(counter->value);
+    int64_t less = INT64_MIN, greater = INT64_MAX;
+    Bool want_less = FALSE, want_greater = FALSE;
+    int i;
+
+    for (i = 0; i < NUM_TRIGGERS; i++) {
+        int64_t test = value_of(triggers[i].trigger.test_value);
+        int type = triggers[i].trigger.test_type;
+
+        if (!triggers[i].added)
+            continue;
+
+        /* transitions at the value bracket the side they are crossed from */
+        if (test > value ||
+            (test == value && type == XSyncPositiveTransition)) {
+            if (test < greater) {
+                greater = test;
+                want_greater = TRUE;
+            }
+        }
+        if (test < value ||
+            (test == value && type == XSyncNegativeTransition)) {
+            if (test > less) {
+                less = test;
+                want_less = TRUE;
+            }
+        }
+    }
+
+    assert(has_less == want_less);
+    assert(has_greater == want_greater);
+    if (want_less)
+        assert(value_of(bracket_less) == less);
+    if (want_greater)
+        assert(value_of(bracket_greater) == greater);
+}
+
+static void
+change_counter(int64_t newval)
+{
+    int64_t oldval = value_of(counter->value);
+    int i;
+
+    for (i = 0; i < NUM_TRIGGERS; i++) {
+        TestTrigger *t = &triggers[i];
+
+        if (t->added &&
+            fires(t->trigger.test_type, value_of(t->trigger.test_value),
+                  oldval, newval))
+            t->expected++;
+    }
+
+    SyncChangeCounter(counter, to_value(newval));
+
+    for (i = 0; i < NUM_TRIGGERS; i++)
+        assert(triggers[i].fired == triggers[i].expected);
+    check_brackets();
+}
+
+static void
+random_walk(int steps)
+{
+    int64_t value = value_of(counter->value);
+
+    while (steps--) {
+        /* mostly small steps, so transitions are hit from both sides */
+        if (random() % 8)
+            value += random() % 33 - 16;
+        else
+            value = random() % VALUE_RANGE;
+        change_counter(value);
+    }
+}
+
+static void
+sync_init(void)
+{
+    static ClientRec server_client;
+
+    dixResetPrivates();
+    serverClient = &server_client;
+    InitClient(serverClient, 0, (void *) NULL);
+    if (!InitClientResources(serverClient)) /* for root resources */
+        FatalError("couldn't init server resources");
+    InitAtoms();
+    SyncExtensionInit();
+}
+
+static void
+sync_trigger_sets(void)
+{
+    int i;
+
+    counter = SyncCreateSystemCounter("TEST", to_value(0), to_value(1),
+                                      XSyncCounterUnrestricted,
+                                      query_value, bracket_values);
+    assert(counter);
+
+    srandom(0x5eed);
+    for (i = 0; i < NUM_TRIGGERS; i++)
+        add_trigger(&triggers[i], i % SYNC_NUM_TEST_TYPES,
+                    random() % VALUE_RANGE);
+    check_brackets();
+    random_walk(2000);
+
+    /* drop some triggers, move others to new values and types */
+    for (i = 0; i < NUM_TRIGGERS; i += 3) {
+        SyncDeleteTriggerFromSyncObject(&triggers[i].trigger);
+        triggers[i].added = FALSE;
+    }
+    for (i = 1; i < NUM_TRIGGERS; i += 3) {
+        SyncDeleteTriggerFromSyncObject(&triggers[i].trigger);
+        add_trigger(&triggers[i], random() % SYNC_NUM_TEST_TYPES,
+                    random() % VALUE_RANGE);
+    }
+    check_brackets();
+    random_walk(2000);
+
+    /* a trigger already on the counter is refiled under its new value */
+    triggers[2].trigger.test_value = to_value(VALUE_RANGE * 2);
+    assert(SyncAddTriggerToSyncObject(&triggers[2].trigger) == Success);
+    check_brackets();
+    random_walk(500);
+
+    SyncDestroySystemCounter(counter);
+    for (i = 0; i < NUM_TRIGGERS; i++)
+        assert(!triggers[i].added);
+}
+
+static int
+count_filed(SyncCounter *pCounter)
+{
+    int type, num = 0;
+
+    for (type = 0; type < SYNC_NUM_TEST_TYPES; type++)
+        num += pCounter->triggers[type].num;
+    return num;
+}
+
+/**
+ * An alarm with a delta is refiled under its next test value every time
+ * it fires.  Once it's destroyed the counter must not have it filed
+ * anywhere, or the next change fires a freed trigger.
+ */
+static void
+sync_delta_alarm(void)
+{
+    static HWEventQueueType input_check;
+    ExtensionEntry *ext = CheckExtension(SYNC_NAME);
+    SyncTriggerSet *pSet;
+    XID alarm = FakeClientID(0);
+    struct {
+        xSyncCreateAlarmReq req;
+        CARD32 values[7];
+    } create;
+
+    /* UpdateCurrentTime() looks for pending input */
+    SetInputCheck(&input_check, &input_check);
+
+    counter = SyncCreateSystemCounter("TEST-ALARM", to_value(0), to_value(1),
+                                      XSyncCounterUnrestricted,
+                                      query_value, bracket_values);
+    assert(counter);
+    assert(ext);
+
+    /* value 10, delta 5, owned by serverClient so no events are written */
+    create.req.reqType = ext->base;
+    create.req.syncReqType = X_SyncCreateAlarm;
+    create.req.length = sizeof(create) >> 2;
+    create.req.id = alarm;
+    create.req.valueMask = XSyncCACounter | XSyncCAValueType | XSyncCAValue |
+        XSyncCATestType | XSyncCADelta;
+    create.values[0] = counter->sync.id;
+    create.values[1] = XSyncAbsolute;
+    create.values[2] = 0;
+    create.values[3] = 10;
+    create.values[4] = XSyncPositiveComparison;
+    create.values[5] = 0;
+    create.values[6] = 5;
+    serverClient->requestBuffer = &create;
+    serverClient->req_len = create.req.length;
+    assert(ProcVector[ext->base] (serverClient) == Success);
+
+    pSet = &counter->triggers[XSyncPositiveComparison];
+    assert(count_filed(counter) == 1);
+    assert(value_of(pSet->triggers[0]->set_value) == 10);
+
+    /* fires once and moves on to 15 */
+    SyncChangeCounter(counter, to_value(12));
+    assert(count_filed(counter) == 1);
+    assert(value_of(pSet->triggers[0]->set_value) == 15);
+    assert(value_of(pSet->triggers[0]->test_value) == 15);
+    assert(has_greater && value_of(bracket_greater) == 15);
+
+    /* and again, past several deltas at once */
+    SyncChangeCounter(counter, to_value(31));
+    assert(count_filed(counter) == 1);
+    assert(value_of(pSet->triggers[0]->set_value) == 35);
+
+    FreeResource(alarm, RT_NONE);
+    assert(count_filed(counter) == 0);
+    assert(!has_greater);
+
+    SyncChangeCounter(counter, to_value(40));
+    SyncDestroySystemCounter(counter);
+}
+
+/* fires, then deletes the next trigger in the array */
+static void
+trigger_fired_delete(SyncTrigger *pTrigger)
+{
+    TestTrigger *t = (TestTrigger *) pTrigger + 1;
+
+    ((TestTrigger *) pTrigger)->fired++;
+    if (t < &triggers[NUM_TRIGGERS] && t->added) {
+        SyncDeleteTriggerFromSyncObject(&t->trigger);
+        t->added = FALSE;
+    }
+}
+
+/* fires, then changes the counter again from within the change */
+static void
+trigger_fired_change(SyncTrigger *pTrigger)
+{
+    ((TestTrigger *) pTrigger)->fired++;
+    SyncChangeCounter(counter, to_value(20));
+}
+
+/**
+ * Triggers deleted while a change of the counter fires them must not be
+ * fired, both when there are more of them than fit on the stack and when
+ * they were deleted from a nested change of the counter.
+ */
+static void
+sync_fire_deleting(void)
+{
+    int i;
+
+    counter = SyncCreateSystemCounter("TEST-DELETE", to_value(0),
+                                      to_value(1), XSyncCounterUnrestricted,
+                                      query_value, bracket_values);
+    assert(counter);
+    memset(triggers, 0, sizeof(triggers));
+
+    /* triggers at the same value fire in the order they were added */
+    for (i = 0; i < 100; i++) {
+        add_trigger(&triggers[i], XSyncPositiveComparison, 5);
+        triggers[i].trigger.TriggerFired = trigger_fired_delete;
+    }
+    SyncChangeCounter(counter, to_value(10));
+    for (i = 0; i < 100; i++) {
+        assert(triggers[i].fired == !(i & 1));
+        assert(triggers[i].added == !(i & 1));
+    }
+    for (i = 0; i < 100; i += 2) {
+        SyncDeleteTriggerFromSyncObject(&triggers[i].trigger);
+        triggers[i].added = FALSE;
+    }
+    assert(count_filed(counter) == 0);
+
+    /* 0 changes the counter again, where 1 deletes 2 before the first
+     * change gets to it */
+    SyncChangeCounter(counter, to_value(0));
+    memset(triggers, 0, 3 * sizeof(TestTrigger));
+    add_trigger(&triggers[0], XSyncPositiveTransition, 5);
+    triggers[0].trigger.TriggerFired = trigger_fired_change;
+    add_trigger(&triggers[1], XSyncPositiveComparison, 5);
+    triggers[1].trigger.TriggerFired = trigger_fired_delete;
+    add_trigger(&triggers[2], XSyncPositiveComparison, 5);
+    SyncChangeCounter(counter, to_value(10));
+    assert(triggers[0].fired == 1);
+    assert(triggers[1].fired == 2);
+    assert(triggers[2].fired == 0);
+    assert(count_filed(counter) == 2);
+
+    SyncDestroySystemCounter(counter);
+}
+
+int
+main(int argc, char **argv)
+{
+    sync_init();
+    sync_trigger_sets();
+    sync_delta_alarm();
+    sync_fire_deleting();
+
+    return 0;
+}
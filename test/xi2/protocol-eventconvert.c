@@ -33,6 +33,35 @@
 #include "inpututils.h"
 #include <X11/extensions/XI2proto.h>
 
+/* This test is linked with -wrap for malloc, calloc and realloc, so it
+ * can tell whether the conversions went to the heap. */
+static int alloc_count;
+
+extern void *__real_malloc(size_t size);
+extern void *__real_calloc(size_t nmemb, size_t size);
+extern void *__real_realloc(void *ptr, size_t size);
+
+void *
+__wrap_malloc(size_t size)
+{
+    alloc_count++;
+    return __real_malloc(size);
+}
+
+void *
+__wrap_calloc(size_t nmemb, size_t size)
+{
+    alloc_count++;
+    return __real_calloc(nmemb, size);
+}
+
+void *
+__wrap_realloc(void *ptr, size_t size)
+{
+    alloc_count++;
+    return __real_realloc(ptr, size);
+}
+
 static void
 test_values_XIRawEvent(RawDeviceEvent *in, xXIRawEvent * out, BOOL swap)
 {
@@ -1199,6 +1228,95 @@ test_convert_XIBarrierEvent(void)
     test_XIBarrierEvent(&in);
 }
 
+/* what delivering a focused event does: all three levels alive at once */
+static void
+convert_all_levels(EventConvertArenaPtr arena, InternalEvent *ev)
+{
+    xEvent *core, *xi, *xi2;
+    int count, rc;
+
+    rc = EventToXI2Arena(ev, &xi2, arena);
+    assert(rc == Success);
+    rc = EventToXIArena(ev, &xi, &count, arena);
+    assert(rc == Success || rc == BadMatch);
+    rc = EventToCoreArena(ev, &core, &count, arena);
+    assert(rc == Success || rc == BadMatch);
+
+    FreeConvertedEvent(arena, core);
+    FreeConvertedEvent(arena, xi);
+    FreeConvertedEvent(arena, xi2);
+}
+
+static void
+test_convert_arena(void)
+{
+    EventConvertArenaRec arena;
+    DeviceEvent motion, button, touch;
+    RawDeviceEvent raw;
+    xEvent *held[EVENT_CONVERT_SLOTS + 1];
+    int i, j, rc;
+
+    memset(&arena, 0, sizeof(arena));
+
+    memset(&motion, 0, sizeof(motion));
+    motion.header = ET_Internal;
+    motion.type = ET_Motion;
+    motion.length = sizeof(DeviceEvent);
+    motion.deviceid = 2;
+    motion.sourceid = 2;
+    for (i = 0; i < 8; i++) {
+        SetBit(motion.valuators.mask, i);
+        motion.valuators.data[i] = i * 10.5;
+    }
+
+    button = motion;
+    button.type = ET_ButtonPress;
+    button.detail.button = 1;
+
+    touch = motion;
+    touch.type = ET_TouchUpdate;
+    touch.touchid = 7;
+
+    memset(&raw, 0, sizeof(raw));
+    raw.header = ET_Internal;
+    raw.type = ET_RawMotion;
+    raw.length = sizeof(RawDeviceEvent);
+    raw.deviceid = 2;
+    raw.sourceid = 2;
+    for (i = 0; i < 8; i++) {
+        SetBit(raw.valuators.mask, i);
+        raw.valuators.data[i] = raw.valuators.data_raw[i] = i;
+    }
+
+    /* a burst, once to size the slots and then in steady state */
+    for (j = 0; j < 2; j++) {
+        alloc_count = 0;
+        for (i = 0; i < 1000; i++) {
+            convert_all_levels(&arena, (InternalEvent *) &motion);
+            convert_all_levels(&arena, (InternalEvent *) &button);
+            convert_all_levels(&arena, (InternalEvent *) &touch);
+            convert_all_levels(&arena, (InternalEvent *) &raw);
+        }
+    }
+    assert(alloc_count == 0);
+
+    /* once all slots are busy, conversion falls back to the heap */
+    for (i = 0; i <= EVENT_CONVERT_SLOTS; i++) {
+        rc = EventToXI2Arena((InternalEvent *) &motion, &held[i], &arena);
+        assert(rc == Success);
+    }
+    for (i = 0; i < EVENT_CONVERT_SLOTS; i++) {
+        assert(held[i] == arena.slot[i].data);
+        assert(held[EVENT_CONVERT_SLOTS] != arena.slot[i].data);
+    }
+    for (i = 0; i <= EVENT_CONVERT_SLOTS; i++)
+        FreeConvertedEvent(&arena, held[i]);
+    for (i = 0; i < EVENT_CONVERT_SLOTS; i++)
+        assert(!arena.slot[i].inuse);
+
+    FreeEventConvertArena(&arena);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -1208,6 +1326,7 @@ main(int argc, char **argv)
     test_convert_XIDeviceChangedEvent();
     test_convert_XITouchOwnershipEvent();
     test_convert_XIBarrierEvent();
+    test_convert_arena();
 
     return 0;
 }
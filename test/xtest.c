@@ -34,6 +34,12 @@
 #include "xkbsrv.h"
 #include "xserver-properties.h"
 #include "syncsrv.h"
+#include "extnsionst.h"
+#include "eventstr.h"
+#include "mi.h"
+#include "mipointer.h"
+#include "mipointrst.h"
+#include "xtestint.h"
 
 /**
  */
@@ -41,7 +47,22 @@
 /* from Xext/xtest.c */
 extern DeviceIntPtr xtestpointer, xtestkeyboard;
 
-/* Needed for the screen setup, otherwise we crash during sprite initialization */
+#define BATCH_MAX 5
+
+struct batch {
+    xXTestFakeInputBatchReq req;
+    xXTestBatchEvent ev[BATCH_MAX];
+};
+
+/* a window ID nobody owns */
+#define BATCH_BAD_WINDOW 0x00400001
+
+static ScreenRec screen;
+
+/*
+ * Injected events go through mi's pointer code, so the screen gets an
+ * miPointer with sprite and screen functions that do nothing.
+ */
 static Bool
 device_cursor_init(DeviceIntPtr dev, ScreenPtr screen)
 {
@@ -53,23 +74,73 @@ device_cursor_cleanup(DeviceIntPtr dev, ScreenPtr screen)
 {
 }
 
+static Bool
+sprite_realize_cursor(DeviceIntPtr dev, ScreenPtr screen, CursorPtr cursor)
+{
+    return TRUE;
+}
+
+static void
+sprite_set_cursor(DeviceIntPtr dev, ScreenPtr screen, CursorPtr cursor,
+                  int x, int y)
+{
+}
+
+static void
+sprite_move_cursor(DeviceIntPtr dev, ScreenPtr screen, int x, int y)
+{
+}
+
+static miPointerSpriteFuncRec sprite_funcs = {
+    sprite_realize_cursor,
+    sprite_realize_cursor,
+    sprite_set_cursor,
+    sprite_move_cursor,
+    device_cursor_init,
+    device_cursor_cleanup,
+};
+
+static Bool
+pointer_cursor_off_screen(ScreenPtr *screen, int *x, int *y)
+{
+    return FALSE;
+}
+
+static void
+pointer_cross_screen(ScreenPtr screen, int entering)
+{
+}
+
+static miPointerScreenFuncRec pointer_funcs = {
+    pointer_cursor_off_screen,
+    pointer_cross_screen,
+    miPointerWarpCursor,
+};
+
 static void
 xtest_init_devices(void)
 {
-    ScreenRec screen;
-    ClientRec server_client;
+    static ClientRec server_client;
 
     /* random stuff that needs initialization */
     memset(&screen, 0, sizeof(screen));
     screenInfo.numScreens = 1;
     screenInfo.screens[0] = &screen;
+    screenInfo.width = 640;
+    screenInfo.height = 480;
     screen.myNum = 0;
     screen.id = 100;
     screen.width = 640;
     screen.height = 480;
-    screen.DeviceCursorInitialize = device_cursor_init;
-    screen.DeviceCursorCleanup = device_cursor_cleanup;
     dixResetPrivates();
+    dixInitScreenSpecificPrivates(&screen);
+    if (!dixRegisterPrivateKey(&miPointerScreenKeyRec, PRIVATE_SCREEN, 0) ||
+        !dixAllocatePrivates(&screen.devPrivates, PRIVATE_SCREEN))
+        FatalError("couldn't allocate screen privates");
+    /* sets DeviceCursorInitialize, otherwise we crash during sprite
+     * initialization */
+    if (!miPointerInitialize(&screen, &sprite_funcs, &pointer_funcs, TRUE))
+        FatalError("couldn't init the pointer");
     serverClient = &server_client;
     InitClient(serverClient, 0, (void *) NULL);
     if (!InitClientResources(serverClient)) /* for root resources */
@@ -90,6 +161,10 @@ xtest_init_devices(void)
     assert(GetXTestDevice(inputInfo.pointer) == xtestpointer);
 
     assert(GetXTestDevice(inputInfo.keyboard) == xtestkeyboard);
+
+    /* there's no root window for InitializeSprite to put the pointer on */
+    ((miPointerPtr) dixLookupPrivate(&inputInfo.pointer->devPrivates,
+                                     miPointerPrivKey))->pScreen = &screen;
 }
 
 /**
@@ -122,11 +197,293 @@ xtest_properties(void)
     assert(rc == BadAccess);
 }
 
+static void
+batch_init(struct batch *b, ClientPtr client, int nev)
+{
+    ExtensionEntry *ext = CheckExtension(XTestExtensionName);
+
+    assert(ext);
+    assert(nev <= BATCH_MAX);
+
+    memset(b, 0, sizeof(*b));
+    b->req.reqType = ext->base;
+    b->req.xtReqType = X_XTestFakeInputBatch;
+    b->req.length = (sizeof(b->req) + nev * sizeof(xXTestBatchEvent)) >> 2;
+
+    memset(client, 0, sizeof(*client));
+    client->index = 1;
+    client->requestBuffer = b;
+    client->req_len = b->req.length;
+    client->clientPtr = inputInfo.pointer;
+}
+
+static int
+batch_dispatch(struct batch *b, ClientPtr client)
+{
+    if (client->swapped)
+        return SwappedProcVector[b->req.reqType] (client);
+    return ProcVector[b->req.reqType] (client);
+}
+
+/**
+ * Each event in a FakeInputBatch is checked against the XTest device it
+ * would be injected through.
+ */
+static void
+xtest_batch_validate(void)
+{
+    ClientRec client;
+    struct batch b;
+    XkbDescPtr xkb = xtestkeyboard->key->xkbInfo->desc;
+    int rc;
+
+    /* trailing bytes that don't make up a whole event */
+    batch_init(&b, &client, 1);
+    client.req_len++;
+    rc = batch_dispatch(&b, &client);
+    assert(rc == BadLength);
+
+    batch_init(&b, &client, 1);
+    b.ev[0].type = KeyPress;
+    b.ev[0].detail = xkb->min_key_code - 1;
+    rc = batch_dispatch(&b, &client);
+    assert(rc == BadValue);
+    assert(client.errorValue == xkb->min_key_code - 1);
+
+    if (xkb->max_key_code < 255) {
+        batch_init(&b, &client, 1);
+        b.ev[0].type = KeyRelease;
+        b.ev[0].detail = xkb->max_key_code + 1;
+        rc = batch_dispatch(&b, &client);
+        assert(rc == BadValue);
+        assert(client.errorValue == xkb->max_key_code + 1);
+    }
+
+    batch_init(&b, &client, 1);
+    b.ev[0].type = ButtonPress;
+    b.ev[0].detail = 0;
+    rc = batch_dispatch(&b, &client);
+    assert(rc == BadValue);
+    assert(client.errorValue == 0);
+
+    batch_init(&b, &client, 1);
+    b.ev[0].type = ButtonRelease;
+    b.ev[0].detail = xtestpointer->button->numButtons + 1;
+    rc = batch_dispatch(&b, &client);
+    assert(rc == BadValue);
+    assert(client.errorValue == xtestpointer->button->numButtons + 1);
+
+    batch_init(&b, &client, 1);
+    b.ev[0].type = MotionNotify;
+    b.ev[0].detail = 2;
+    rc = batch_dispatch(&b, &client);
+    assert(rc == BadValue);
+    assert(client.errorValue == 2);
+
+    batch_init(&b, &client, 1);
+    b.ev[0].type = MotionNotify;
+    b.ev[0].root = BATCH_BAD_WINDOW;
+    rc = batch_dispatch(&b, &client);
+    assert(rc == BadWindow);
+    assert(client.errorValue == BATCH_BAD_WINDOW);
+
+    /* only core input events can be faked */
+    batch_init(&b, &client, 1);
+    b.ev[0].type = EnterNotify;
+    rc = batch_dispatch(&b, &client);
+    assert(rc == BadValue);
+    assert(client.errorValue == EnterNotify);
+}
+
+/**
+ * One bad event rejects the whole batch before anything is injected.
+ * Injected events are turned into type 0 entries, so the request must
+ * come back untouched.
+ */
+static void
+xtest_batch_reject(void)
+{
+    ClientRec client;
+    struct batch b, orig;
+    XkbDescPtr xkb = xtestkeyboard->key->xkbInfo->desc;
+    int rc;
+
+    batch_init(&b, &client, 4);
+    b.ev[0].type = KeyPress;
+    b.ev[0].detail = xkb->min_key_code;
+    b.ev[1].type = KeyRelease;
+    b.ev[1].detail = xkb->min_key_code;
+    b.ev[2].type = ButtonPress;
+    b.ev[2].detail = 1;
+    b.ev[2].delay = 10;
+    b.ev[3].type = ButtonRelease;
+    b.ev[3].detail = 0;
+    orig = b;
+
+    rc = batch_dispatch(&b, &client);
+    assert(rc == BadValue);
+    assert(client.errorValue == 0);
+    assert(memcmp(&b, &orig, sizeof(b)) == 0);
+}
+
+#define DELIVERED_MAX 16
+
+static struct {
+    int type;
+    int deviceid;
+    uint32_t detail;
+    int root_x, root_y;
+} delivered[DELIVERED_MAX];
+static int ndelivered;
+
+/* Catches what would be processed, instead of the devices' processInputProc */
+static void
+batch_event_handler(int screenNum, InternalEvent *ie, DeviceIntPtr dev)
+{
+    DeviceEvent *ev = &ie->device_event;
+
+    if (ev->type < ET_KeyPress || ev->type > ET_Motion)
+        return;
+    assert(ndelivered < DELIVERED_MAX);
+    delivered[ndelivered].type = ev->type;
+    delivered[ndelivered].deviceid = ev->deviceid;
+    delivered[ndelivered].detail = ev->detail.button;
+    delivered[ndelivered].root_x = ev->root_x;
+    delivered[ndelivered].root_y = ev->root_y;
+    ndelivered++;
+}
+
+static void
+batch_set_handlers(mieqHandler handler)
+{
+    static const int types[] = {
+        ET_KeyPress, ET_KeyRelease, ET_ButtonPress, ET_ButtonRelease,
+        ET_Motion, ET_DeviceChanged, ET_RawKeyPress, ET_RawKeyRelease,
+        ET_RawButtonPress, ET_RawButtonRelease, ET_RawMotion,
+    };
+    int i;
+
+    for (i = 0; i < sizeof(types) / sizeof(types[0]); i++)
+        mieqSetHandler(types[i], handler);
+}
+
+/* Checks that event n came from the slave, followed by the master's copy */
+static void
+batch_check_delivered(int n, int type, DeviceIntPtr slave, uint32_t detail)
+{
+    assert(n + 1 < ndelivered);
+    assert(delivered[n].type == type);
+    assert(delivered[n].deviceid == slave->id);
+    assert(delivered[n].detail == detail);
+    assert(delivered[n + 1].type == type);
+    assert(delivered[n + 1].deviceid == GetMaster(slave, MASTER_ATTACHED)->id);
+    assert(delivered[n + 1].detail == detail);
+}
+
+/**
+ * A valid batch is injected in order through the XTest devices, and each
+ * injected event is turned into a type 0 entry.
+ */
+static void
+xtest_batch_inject(void)
+{
+    ClientRec client;
+    struct batch b;
+    XkbDescPtr xkb = xtestkeyboard->key->xkbInfo->desc;
+    miPointerPtr pointer = dixLookupPrivate(&inputInfo.pointer->devPrivates,
+                                            miPointerPrivKey);
+    int rc, i;
+
+    batch_init(&b, &client, 5);
+    b.ev[0].type = KeyPress;
+    b.ev[0].detail = xkb->min_key_code;
+    b.ev[1].type = KeyRelease;
+    b.ev[1].detail = xkb->min_key_code;
+    b.ev[2].type = ButtonPress;
+    b.ev[2].detail = 1;
+    b.ev[3].type = ButtonRelease;
+    b.ev[3].detail = 1;
+    b.ev[4].type = MotionNotify;
+    b.ev[4].detail = xFalse;
+    b.ev[4].rootX = 100;
+    b.ev[4].rootY = 200;
+
+    ndelivered = 0;
+    batch_set_handlers(batch_event_handler);
+    rc = batch_dispatch(&b, &client);
+    batch_set_handlers(NULL);
+    assert(rc == Success);
+
+    for (i = 0; i < 5; i++)
+        assert(b.ev[i].type == 0);
+
+    assert(ndelivered == 10);
+    batch_check_delivered(0, ET_KeyPress, xtestkeyboard, xkb->min_key_code);
+    batch_check_delivered(2, ET_KeyRelease, xtestkeyboard, xkb->min_key_code);
+    batch_check_delivered(4, ET_ButtonPress, xtestpointer, 1);
+    batch_check_delivered(6, ET_ButtonRelease, xtestpointer, 1);
+    batch_check_delivered(8, ET_Motion, xtestpointer, 0);
+    assert(delivered[8].root_x == 100);
+    assert(delivered[8].root_y == 200);
+    assert(pointer->x == 100);
+    assert(pointer->y == 200);
+}
+
+/**
+ * A swapped client's events are swapped in place before they're checked.
+ */
+static void
+xtest_batch_swapped(void)
+{
+    ClientRec client;
+    struct batch b;
+    int rc;
+
+    batch_init(&b, &client, 2);
+    client.swapped = TRUE;
+    b.ev[0].type = ButtonPress;
+    b.ev[0].detail = 1;
+    b.ev[0].delay = lswapl(20);
+    b.ev[1].type = MotionNotify;
+    b.ev[1].detail = xFalse;
+    b.ev[1].delay = lswapl(30);
+    b.ev[1].root = lswapl(BATCH_BAD_WINDOW);
+    b.ev[1].rootX = lswaps(100);
+    b.ev[1].rootY = lswaps(-200);
+    b.req.length = lswaps(b.req.length);
+
+    rc = batch_dispatch(&b, &client);
+    assert(rc == BadWindow);
+    assert(client.errorValue == BATCH_BAD_WINDOW);
+
+    assert(b.req.length == client.req_len);
+    assert(b.ev[0].type == ButtonPress);
+    assert(b.ev[0].delay == 20);
+    assert(b.ev[1].delay == 30);
+    assert(b.ev[1].root == BATCH_BAD_WINDOW);
+    assert(b.ev[1].rootX == 100);
+    assert(b.ev[1].rootY == -200);
+
+    /* a swapped bad length is still caught */
+    batch_init(&b, &client, 1);
+    client.swapped = TRUE;
+    client.req_len++;
+    b.req.length = lswaps(b.req.length + 1);
+    rc = batch_dispatch(&b, &client);
+    assert(rc == BadLength);
+}
+
 int
 main(int argc, char **argv)
 {
     xtest_init_devices();
     xtest_properties();
 
+    XTestExtensionInit();
+    xtest_batch_validate();
+    xtest_batch_reject();
+    xtest_batch_swapped();
+    xtest_batch_inject();
+
     return 0;
 }
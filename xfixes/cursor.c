@@ -354,8 +354,8 @@ ProcXFixesGetCursorImage(ClientPtr client)
     pCursor = CursorCurrent[PickPointer(client)->id];
     if (!pCursor)
         return BadCursor;
-    rc = XaceHook(XACE_RESOURCE_ACCESS, client, pCursor->id, RT_CURSOR,
-                  pCursor, RT_NONE, NULL, DixReadAccess);
+    rc = XaceHookResourceAccess(client, pCursor->id, RT_CURSOR,
+                                pCursor, RT_NONE, NULL, DixReadAccess);
     if (rc != Success)
         return rc;
     GetSpritePosition(PickPointer(client), &x, &y);
@@ -503,8 +503,9 @@ ProcXFixesGetCursorImageAndName(ClientPtr client)
     pCursor = CursorCurrent[PickPointer(client)->id];
     if (!pCursor)
         return BadCursor;
-    rc = XaceHook(XACE_RESOURCE_ACCESS, client, pCursor->id, RT_CURSOR,
-                  pCursor, RT_NONE, NULL, DixReadAccess | DixGetAttrAccess);
+    rc = XaceHookResourceAccess(client, pCursor->id, RT_CURSOR,
+                                pCursor, RT_NONE, NULL,
+                                DixReadAccess | DixGetAttrAccess);
     if (rc != Success)
         return rc;
     GetSpritePosition(PickPointer(client), &x, &y);
@@ -863,8 +864,8 @@ ProcXFixesHideCursor(ClientPtr client)
      * This is the first time this client has hid the cursor 
      * for this screen.
      */
-    ret = XaceHook(XACE_SCREEN_ACCESS, client, pWin->drawable.pScreen,
-                   DixHideAccess);
+    ret = XaceHookScreenAccess(client, pWin->drawable.pScreen,
+                               DixHideAccess);
     if (ret != Success)
         return ret;
 
@@ -921,8 +922,8 @@ ProcXFixesShowCursor(ClientPtr client)
         return BadMatch;
     }
 
-    rc = XaceHook(XACE_SCREEN_ACCESS, client, pWin->drawable.pScreen,
-                  DixShowAccess);
+    rc = XaceHookScreenAccess(client, pWin->drawable.pScreen,
+                              DixShowAccess);
     if (rc != Success)
         return rc;
 
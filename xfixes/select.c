@@ -122,9 +122,11 @@ XFixesSelectSelectionInput(ClientPtr pClient,
     void *val;
     int rc;
     SelectionEventPtr *prev, e;
+    Selection *pSel;
 
-    rc = XaceHook(XACE_SELECTION_ACCESS, pClient, selection, DixGetAttrAccess);
-    if (rc != Success)
+    /* Selections that nobody owns yet can still be watched */
+    rc = dixLookupSelection(&pSel, selection, pClient, DixGetAttrAccess);
+    if (rc != Success && rc != BadMatch)
         return rc;
 
     for (prev = &selectionEvents; (e = *prev); prev = &e->next) {
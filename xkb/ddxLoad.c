@@ -32,6 +32,9 @@ THE USE OR PERFORMANCE OF THIS SOFTWARE.
 
 #include <stdio.h>
 #include <ctype.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <utime.h>
 #include <X11/X.h>
 #include <X11/Xos.h>
 #include <X11/Xproto.h>
@@ -44,6 +47,8 @@ THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #include <xkbsrv.h>
 #include <X11/extensions/XI.h>
 #include "xkb.h"
+#include "list.h"
+#include "xsha1.h"
 
         /*
          * If XKM_OUTPUT_DIR specifies a path without a leading slash, it is
@@ -96,17 +101,385 @@ typedef struct XkbCompContext {
     char *buf;
     char tmpname[PATH_MAX];
     const char *xkmfile;
+    char cached[PATH_MAX];
 } XkbCompContextRec, *XkbCompContextPtr;
 
+        /*
+         * Compiled keymaps are cached by content.  The xkbcomp input is
+         * hashed together with the identity of the xkbcomp binary and of
+         * every file in the xkb data directories it may include from, and
+         * the xkm produced for it is
+         * kept as server-<hash>.xkm in the output directory, where later
+         * servers will find it without running xkbcomp.  Only the
+         * XKB_KEYMAP_FILE_CACHE_SIZE most recently used of those are kept.
+         * The identity of xkbcomp and the data files is taken once per
+         * server generation, not for every keymap.  Parsed keymaps are
+         * also kept in memory for the rest of the server generation;
+         * devices with the same keymap each get a copy of the cached one.
+         */
+#define XKB_KEYMAP_CACHE_SIZE	4
+#define XKB_KEYMAP_FILE_CACHE_SIZE	16
+#define XKB_KEYMAP_HASH_LEN	40
+
+typedef struct _XkbKeymapCache {
+    struct xorg_list entry;
+    char hash[XKB_KEYMAP_HASH_LEN + 1];
+    unsigned want;
+    unsigned need;
+    unsigned provided;
+    XkbDescPtr xkb;
+} XkbKeymapCacheRec, *XkbKeymapCachePtr;
+
+static struct xorg_list xkbKeymapCache;
+static unsigned long xkbKeymapCacheGeneration;
+
+static const char *xkbKeymapDataDirs[] = {
+    "keycodes", "types", "compat", "symbols", "geometry"
+};
+
+#define XKB_KEYMAP_DIR_DEPTH	4
+
+#define XKB_KEYMAP_NUM_STAMPS \
+    (1 + sizeof(xkbKeymapDataDirs) / sizeof(xkbKeymapDataDirs[0]))
+
+/* fingerprints of xkbcomp and the data dirs, and what they were taken for */
+static uint64_t xkbKeymapStamps[XKB_KEYMAP_NUM_STAMPS];
+static unsigned long xkbKeymapStampGeneration;
+static char *xkbKeymapStampBase, *xkbKeymapStampBin;
+
+static void
+XkbCompPath(char *path, size_t size)
+{
+    const char *bindir = XkbBinDirectory ? XkbBinDirectory : "";
+    const char *sep = "";
+    int ld = strlen(bindir);
+    int lps = strlen(PATHSEPARATOR);
+
+    if ((ld >= lps) && (strcmp(bindir + ld - lps, PATHSEPARATOR) != 0))
+        sep = PATHSEPARATOR;
+    if (snprintf(path, size, "%s%sxkbcomp", bindir, sep) >= size)
+        path[0] = '\0';
+}
+
+/*
+ * Fingerprint a file by name, size, inode and times.  Edits in place
+ * change the mtime and ctime, replacing the file changes the inode.
+ */
+static uint64_t
+XkbKeymapHashFile(const char *path, const struct stat *st)
+{
+    uint64_t stamp[4] = {
+        st->st_size, st->st_ino, st->st_mtime, st->st_ctime
+    };
+    uint64_t h = 0xcbf29ce484222325ULL;
+    const unsigned char *p;
+    size_t i;
+
+    for (p = (const unsigned char *) path; *p; p++)
+        h = (h ^ *p) * 0x100000001b3ULL;
+    p = (const unsigned char *) stamp;
+    for (i = 0; i < sizeof(stamp); i++)
+        h = (h ^ p[i]) * 0x100000001b3ULL;
+    return h;
+}
+
+/*
+ * Sum the fingerprints of all files below dir.  Summing keeps the result
+ * independent of the order readdir returns entries in.
+ */
+static uint64_t
+XkbKeymapHashDir(const char *dir, int depth)
+{
+    char path[PATH_MAX];
+    struct dirent *ent;
+    struct stat st;
+    uint64_t sum = 0;
+    DIR *d;
+
+    if (depth > XKB_KEYMAP_DIR_DEPTH || !(d = opendir(dir)))
+        return sum;
+    while ((ent = readdir(d)) != NULL) {
+        if (ent->d_name[0] == '.')
+            continue;
+        if (snprintf(path, sizeof(path), "%s/%s", dir, ent->d_name) >=
+            sizeof(path) || stat(path, &st) != 0)
+            continue;
+        if (S_ISDIR(st.st_mode))
+            sum += XkbKeymapHashDir(path, depth + 1);
+        else
+            sum += XkbKeymapHashFile(path, &st);
+    }
+    closedir(d);
+    return sum;
+}
+
+/*
+ * The xkbcomp binary stands in for its version: an upgrade replaces it.
+ * Without a bin directory, xkbcomp is whichever one the shell finds.
+ */
+static uint64_t
+XkbKeymapHashComp(void)
+{
+    char comp[PATH_MAX];
+    struct stat st;
+#ifndef WIN32
+    char path[PATH_MAX];
+    const char *dirs, *end;
+#endif
+
+    XkbCompPath(comp, sizeof(comp));
+#ifndef WIN32
+    if (!strchr(comp, '/') && (dirs = getenv("PATH"))) {
+        for (; *dirs; dirs = *end ? end + 1 : end) {
+            end = strchr(dirs, ':');
+            if (!end)
+                end = dirs + strlen(dirs);
+            if (snprintf(path, sizeof(path), "%.*s/%s", (int) (end - dirs),
+                         dirs, comp) < sizeof(path) && stat(path, &st) == 0)
+                return XkbKeymapHashFile(path, &st);
+        }
+        return 0;
+    }
+#endif
+    return stat(comp, &st) == 0 ? XkbKeymapHashFile(comp, &st) : 0;
+}
+
+static Bool
+XkbKeymapSameDir(const char *dir, const char *stamped)
+{
+    return dir && stamped ? strcmp(dir, stamped) == 0 : dir == stamped;
+}
+
+/*
+ * Fingerprint xkbcomp and the data dirs, unless that was done already
+ * this server generation for the same directories.  Walking the data
+ * dirs means a stat for each of their files.
+ */
+static void
+XkbKeymapStamp(void)
+{
+    char path[PATH_MAX];
+    int i;
+
+    if (xkbKeymapStampGeneration == serverGeneration &&
+        XkbKeymapSameDir(XkbBaseDirectory, xkbKeymapStampBase) &&
+        XkbKeymapSameDir(XkbBinDirectory, xkbKeymapStampBin))
+        return;
+
+    xkbKeymapStamps[0] = XkbKeymapHashComp();
+    for (i = 1; i < XKB_KEYMAP_NUM_STAMPS; i++) {
+        xkbKeymapStamps[i] = 0;
+        if (snprintf(path, sizeof(path), "%s/%s", XkbBaseDirectory,
+                     xkbKeymapDataDirs[i - 1]) < sizeof(path))
+            xkbKeymapStamps[i] = XkbKeymapHashDir(path, 0);
+    }
+
+    free(xkbKeymapStampBase);
+    free(xkbKeymapStampBin);
+    xkbKeymapStampBase = XkbBaseDirectory ? strdup(XkbBaseDirectory) : NULL;
+    xkbKeymapStampBin = XkbBinDirectory ? strdup(XkbBinDirectory) : NULL;
+    /* take them again next time if we couldn't note what they were for */
+    if ((XkbBaseDirectory && !xkbKeymapStampBase) ||
+        (XkbBinDirectory && !xkbKeymapStampBin))
+        xkbKeymapStampGeneration = 0;
+    else
+        xkbKeymapStampGeneration = serverGeneration;
+}
+
+static Bool
+XkbKeymapHash(const char *src, size_t len, char *hashRtrn)
+{
+    void *ctx;
+    unsigned char sha1[20];
+    char path[PATH_MAX];
+    int i, ok;
+
+    if (!XkbBaseDirectory)
+        return FALSE;
+
+    XkbKeymapStamp();
+
+    ctx = x_sha1_init();
+    if (!ctx)
+        return FALSE;
+
+    ok = x_sha1_update(ctx, (void *) src, len);
+    ok &= x_sha1_update(ctx, (void *) XkbBaseDirectory,
+                        strlen(XkbBaseDirectory));
+    XkbCompPath(path, sizeof(path));
+    ok &= x_sha1_update(ctx, path, strlen(path));
+    ok &= x_sha1_update(ctx, xkbKeymapStamps, sizeof(xkbKeymapStamps));
+    if (!x_sha1_final(ctx, sha1) || !ok)
+        return FALSE;
+
+    for (i = 0; i < sizeof(sha1); i++)
+        snprintf(hashRtrn + 2 * i, 3, "%02x", sha1[i]);
+    return TRUE;
+}
+
+/* Whether name is that of a cached xkm, server-<hash>.xkm */
+static Bool
+XkbKeymapIsCacheFile(const char *name)
+{
+    int i;
+
+    if (strncmp(name, "server-", 7) != 0)
+        return FALSE;
+    name += 7;
+    for (i = 0; i < XKB_KEYMAP_HASH_LEN; i++) {
+        if (!isxdigit((unsigned char) name[i]))
+            return FALSE;
+    }
+    return strcmp(name + XKB_KEYMAP_HASH_LEN, ".xkm") == 0;
+}
+
+/*
+ * Remove the least recently used cached xkms from the directory of
+ * fileName, so that at most XKB_KEYMAP_FILE_CACHE_SIZE remain.  Using a
+ * cached xkm touches it, so the modification time tells which one that is.
+ */
+static void
+XkbKeymapCacheEvict(const char *fileName)
+{
+    char dir[PATH_MAX], path[PATH_MAX], oldest[PATH_MAX];
+    const char *sep = strrchr(fileName, PATHSEPARATOR[0]);
+    struct dirent *ent;
+    struct stat st;
+    time_t oldest_time;
+    int n;
+    DIR *d;
+
+    if (!sep || sep - fileName >= sizeof(dir))
+        return;
+    memcpy(dir, fileName, sep - fileName);
+    dir[sep - fileName] = '\0';
+
+    do {
+        if (!(d = opendir(dir)))
+            return;
+        n = 0;
+        oldest_time = 0;
+        while ((ent = readdir(d)) != NULL) {
+            if (!XkbKeymapIsCacheFile(ent->d_name) ||
+                snprintf(path, sizeof(path), "%s%s%s", dir, PATHSEPARATOR,
+                         ent->d_name) >= sizeof(path) ||
+                stat(path, &st) != 0 || !S_ISREG(st.st_mode))
+                continue;
+#ifndef WIN32
+            /* the directory may be shared, leave other users' files be */
+            if (st.st_uid != geteuid())
+                continue;
+#endif
+            if (n++ == 0 || st.st_mtime < oldest_time) {
+                oldest_time = st.st_mtime;
+                strcpy(oldest, path);
+            }
+        }
+        closedir(d);
+    } while (n > XKB_KEYMAP_FILE_CACHE_SIZE && unlink(oldest) == 0);
+}
+
+static void
+XkbKeymapCacheFlush(void)
+{
+    XkbKeymapCachePtr cache, tmp;
+
+    if (!xkbKeymapCacheGeneration) {
+        xorg_list_init(&xkbKeymapCache);
+        xkbKeymapCacheGeneration = serverGeneration;
+        return;
+    }
+
+    xorg_list_for_each_entry_safe(cache, tmp, &xkbKeymapCache, entry) {
+        xorg_list_del(&cache->entry);
+        XkbFreeKeyboard(cache->xkb, XkbAllComponentsMask, TRUE);
+        free(cache);
+    }
+    xkbKeymapCacheGeneration = serverGeneration;
+}
+
+static XkbDescPtr
+XkbKeymapDup(XkbDescPtr src)
+{
+    XkbDescPtr xkb = XkbAllocKeyboard();
+
+    if (!xkb)
+        return NULL;
+    if (!XkbCopyKeymap(xkb, src)) {
+        XkbFreeKeyboard(xkb, XkbAllComponentsMask, TRUE);
+        return NULL;
+    }
+    xkb->defined = src->defined;
+    xkb->flags = src->flags;
+    xkb->device_spec = src->device_spec;
+    return xkb;
+}
+
+static unsigned
+XkbKeymapCacheLookup(const char *hash, unsigned want, unsigned need,
+                     XkbDescPtr *xkbRtrn)
+{
+    XkbKeymapCachePtr cache;
+
+    /* keymaps hold atoms, which don't survive a server reset */
+    if (xkbKeymapCacheGeneration != serverGeneration)
+        XkbKeymapCacheFlush();
+
+    xorg_list_for_each_entry(cache, &xkbKeymapCache, entry) {
+        if (cache->want != want || cache->need != need ||
+            strcmp(cache->hash, hash) != 0)
+            continue;
+        *xkbRtrn = XkbKeymapDup(cache->xkb);
+        if (!*xkbRtrn)
+            return 0;
+        xorg_list_del(&cache->entry);
+        xorg_list_add(&cache->entry, &xkbKeymapCache);
+        DebugF("[xkb] Reusing parsed keymap %s\n", hash);
+        return cache->provided;
+    }
+    return 0;
+}
+
+static void
+XkbKeymapCacheStore(const char *hash, unsigned want, unsigned need,
+                    unsigned provided, XkbDescPtr xkb)
+{
+    XkbKeymapCachePtr cache;
+    int n = 0;
+
+    xorg_list_for_each_entry(cache, &xkbKeymapCache, entry)
+        n++;
+    if (n >= XKB_KEYMAP_CACHE_SIZE) {
+        cache = xorg_list_last_entry(&xkbKeymapCache, XkbKeymapCacheRec,
+                                     entry);
+        xorg_list_del(&cache->entry);
+        XkbFreeKeyboard(cache->xkb, XkbAllComponentsMask, TRUE);
+    }
+    else {
+        cache = calloc(1, sizeof(XkbKeymapCacheRec));
+        if (!cache)
+            return;
+    }
+
+    cache->xkb = XkbKeymapDup(xkb);
+    if (!cache->xkb) {
+        free(cache);
+        return;
+    }
+    strcpy(cache->hash, hash);
+    cache->want = want;
+    cache->need = need;
+    cache->provided = provided;
+    xorg_list_add(&cache->entry, &xkbKeymapCache);
+}
+
 static Bool
 StartXkbComp(XkbCompContextPtr ctx)
 {
     char xkm_output_dir[PATH_MAX];
 
-    const char *emptystring = "";
+    char xkbcomp[PATH_MAX];
     char *xkbbasedirflag = NULL;
-    const char *xkbbindir = emptystring;
-    const char *xkbbindirsep = emptystring;
 
 #ifdef WIN32
     ctx->xkmfile = ctx->tmpname;
@@ -129,21 +502,12 @@ StartXkbComp(XkbCompContextPtr ctx)
             xkbbasedirflag = NULL;
     }
 
-    if (XkbBinDirectory != NULL) {
-        int ld = strlen(XkbBinDirectory);
-        int lps = strlen(PATHSEPARATOR);
-
-        xkbbindir = XkbBinDirectory;
-
-        if ((ld >= lps) && (strcmp(xkbbindir + ld - lps, PATHSEPARATOR) != 0)) {
-            xkbbindirsep = PATHSEPARATOR;
-        }
-    }
+    XkbCompPath(xkbcomp, sizeof(xkbcomp));
 
     if (asprintf(&ctx->buf,
-                 "\"%s%sxkbcomp\" -w %d %s -xkm \"%s\" "
+                 "\"%s\" -w %d %s -xkm \"%s\" "
                  "-em1 %s -emp %s -eml %s \"%s%s.xkm\"",
-                 xkbbindir, xkbbindirsep,
+                 xkbcomp,
                  ((xkbDebugFlags < 2) ? 1 :
                   ((xkbDebugFlags > 10) ? 10 : (int) xkbDebugFlags)),
                  xkbbasedirflag ? xkbbasedirflag : "", ctx->xkmfile,
@@ -207,48 +571,40 @@ FinishXkbComp(XkbCompContextPtr ctx)
     return FALSE;
 }
 
-static Bool
-XkbDDXCompileKeymapByNames(XkbDescPtr xkb,
-                           XkbComponentNamesPtr names,
-                           unsigned want,
-                           unsigned need, XkbCompContextPtr ctx)
+static void
+XkbDDXConfigFileName(const char *mapName, char *fileNameRtrn,
+                     int fileNameRtrnLen)
 {
-    if (StartXkbComp(ctx)) {
-#ifdef DEBUG
-        if (xkbDebugFlags) {
-            ErrorF("[xkb] XkbDDXCompileKeymapByNames compiling keymap:\n");
-            XkbWriteXKBKeymapForNames(stderr, names, xkb, want, need);
-        }
+    char xkm_output_dir[PATH_MAX];
+
+    fileNameRtrn[0] = '\0';
+    OutputDirectory(xkm_output_dir, sizeof(xkm_output_dir));
+    if ((XkbBaseDirectory != NULL) && (xkm_output_dir[0] != '/')
+#ifdef WIN32
+        && (!isalpha(xkm_output_dir[0]) || xkm_output_dir[1] != ':')
 #endif
-        XkbWriteXKBKeymapForNames(ctx->out, names, xkb, want, need);
+        ) {
+        if (snprintf(fileNameRtrn, fileNameRtrnLen, "%s/%s%s.xkm",
+                     XkbBaseDirectory, xkm_output_dir, mapName)
+            >= fileNameRtrnLen)
+            fileNameRtrn[0] = '\0';
+    }
+    else {
+        if (snprintf(fileNameRtrn, fileNameRtrnLen, "%s%s.xkm",
+                     xkm_output_dir, mapName) >= fileNameRtrnLen)
+            fileNameRtrn[0] = '\0';
     }
-
-    return FinishXkbComp(ctx);
 }
 
 static FILE *
 XkbDDXOpenConfigFile(char *mapName, char *fileNameRtrn, int fileNameRtrnLen)
 {
-    char buf[PATH_MAX], xkm_output_dir[PATH_MAX];
+    char buf[PATH_MAX];
     FILE *file;
 
     buf[0] = '\0';
     if (mapName != NULL) {
-        OutputDirectory(xkm_output_dir, sizeof(xkm_output_dir));
-        if ((XkbBaseDirectory != NULL) && (xkm_output_dir[0] != '/')
-#ifdef WIN32
-            && (!isalpha(xkm_output_dir[0]) || xkm_output_dir[1] != ':')
-#endif
-            ) {
-            if (snprintf(buf, PATH_MAX, "%s/%s%s.xkm", XkbBaseDirectory,
-                         xkm_output_dir, mapName) >= PATH_MAX)
-                buf[0] = '\0';
-        }
-        else {
-            if (snprintf(buf, PATH_MAX, "%s%s.xkm", xkm_output_dir, mapName)
-                >= PATH_MAX)
-                buf[0] = '\0';
-        }
+        XkbDDXConfigFileName(mapName, buf, PATH_MAX);
         if (buf[0] != '\0')
             file = fopen(buf, "rb");
         else
@@ -262,12 +618,53 @@ XkbDDXOpenConfigFile(char *mapName, char *fileNameRtrn, int fileNameRtrnLen)
     return file;
 }
 
+/*
+ * Open a previously cached xkm.  The output directory may be shared, so
+ * only trust files that we could have written ourselves.
+ */
+static FILE *
+XkbDDXOpenCachedKeymap(char *mapName, char *fileNameRtrn, int fileNameRtrnLen)
+{
+    FILE *file;
+#ifndef WIN32
+    struct stat st;
+#endif
+
+    file = XkbDDXOpenConfigFile(mapName, fileNameRtrn, fileNameRtrnLen);
+    if (file == NULL)
+        return NULL;
+#ifndef WIN32
+    if (fstat(fileno(file), &st) != 0 || !S_ISREG(st.st_mode) ||
+        st.st_uid != geteuid() || (st.st_mode & (S_IWGRP | S_IWOTH))) {
+        fclose(file);
+        return NULL;
+    }
+#endif
+    return file;
+}
+
+static unsigned
+ReadXKM(FILE *file, const char *fileName, unsigned want, unsigned need,
+        XkbDescPtr *xkbRtrn)
+{
+    unsigned missing;
+
+    missing = XkmReadFile(file, need, want, xkbRtrn);
+    if (*xkbRtrn == NULL) {
+        LogMessage(X_ERROR, "Error loading keymap %s\n", fileName);
+        return 0;
+    }
+    DebugF("Loaded XKB keymap %s, defined=0x%x\n", fileName,
+           (*xkbRtrn)->defined);
+    return (need | want) & (~missing);
+}
+
 static unsigned
 LoadXKM(unsigned want, unsigned need, XkbCompContextPtr ctx, XkbDescPtr *xkbRtrn)
 {
     FILE *file;
-    char fileName[PATH_MAX];
-    unsigned missing;
+    char fileName[PATH_MAX], cacheName[PATH_MAX];
+    unsigned provided;
 
     file = XkbDDXOpenConfigFile(ctx->keymap, fileName, PATH_MAX);
     if (file == NULL) {
@@ -275,20 +672,71 @@ LoadXKM(unsigned want, unsigned need, XkbCompContextPtr ctx, XkbDescPtr *xkbRtrn
                    fileName);
         return 0;
     }
-    missing = XkmReadFile(file, need, want, xkbRtrn);
-    if (*xkbRtrn == NULL) {
-        LogMessage(X_ERROR, "Error loading keymap %s\n", fileName);
-        fclose(file);
-        (void) unlink(fileName);
-        return 0;
-    }
-    else {
-        DebugF("Loaded XKB keymap %s, defined=0x%x\n", fileName,
-               (*xkbRtrn)->defined);
-    }
+    provided = ReadXKM(file, fileName, want, need, xkbRtrn);
     fclose(file);
+
+    /* Keep a good xkm around for the next server with the same keymap */
+    if (*xkbRtrn != NULL && ctx->cached[0] != '\0') {
+        XkbDDXConfigFileName(ctx->cached, cacheName, PATH_MAX);
+        if (cacheName[0] != '\0' && rename(fileName, cacheName) == 0) {
+            XkbKeymapCacheEvict(cacheName);
+            return provided;
+        }
+    }
     (void) unlink(fileName);
-    return (need | want) & (~missing);
+    return provided;
+}
+
+/*
+ * Turn xkbcomp input into a keymap, going through the in-memory and
+ * on-disk caches before resorting to running xkbcomp.
+ */
+static unsigned
+XkbDDXLoadKeymapFromSource(const char *src, size_t len,
+                           unsigned want, unsigned need, XkbDescPtr *xkbRtrn)
+{
+    XkbCompContextRec ctx;
+    char hash[XKB_KEYMAP_HASH_LEN + 1];
+    char fileName[PATH_MAX];
+    Bool cacheable;
+    unsigned provided = 0;
+    FILE *file;
+
+    *xkbRtrn = NULL;
+    ctx.cached[0] = '\0';
+
+    cacheable = XkbKeymapHash(src, len, hash);
+    if (cacheable) {
+        provided = XkbKeymapCacheLookup(hash, want, need, xkbRtrn);
+        if (*xkbRtrn)
+            return provided;
+
+        snprintf(ctx.cached, sizeof(ctx.cached), "server-%s", hash);
+        file = XkbDDXOpenCachedKeymap(ctx.cached, fileName, PATH_MAX);
+        if (file) {
+            provided = ReadXKM(file, fileName, want, need, xkbRtrn);
+            fclose(file);
+            if (*xkbRtrn) {
+                DebugF("[xkb] Using cached keymap %s\n", fileName);
+                /* keep it from being evicted as unused */
+                (void) utime(fileName, NULL);
+            }
+        }
+    }
+
+    if (!*xkbRtrn) {
+        if (StartXkbComp(&ctx))
+            fwrite(src, len, 1, ctx.out);
+        if (!FinishXkbComp(&ctx)) {
+            LogMessage(X_ERROR, "XKB: Couldn't compile keymap\n");
+            return 0;
+        }
+        provided = LoadXKM(want, need, &ctx, xkbRtrn);
+    }
+
+    if (cacheable && *xkbRtrn)
+        XkbKeymapCacheStore(hash, want, need, provided, *xkbRtrn);
+    return provided;
 }
 
 unsigned
@@ -299,7 +747,11 @@ XkbDDXLoadKeymapByNames(DeviceIntPtr keybd,
                         XkbDescPtr *xkbRtrn, char *nameRtrn, int nameRtrnLen)
 {
     XkbDescPtr xkb;
-    XkbCompContextRec ctx;
+    FILE *out;
+    char *src = NULL;
+    size_t len = 0;
+    Bool written;
+    unsigned provided;
 
     *xkbRtrn = NULL;
     if ((keybd == NULL) || (keybd->key == NULL) ||
@@ -314,12 +766,42 @@ XkbDDXLoadKeymapByNames(DeviceIntPtr keybd,
                    keybd->name ? keybd->name : "(unnamed keyboard)");
         return 0;
     }
-    else if (!XkbDDXCompileKeymapByNames(xkb, names, want, need, &ctx)) {
+
+    /* The xkbcomp input doubles as the cache key, so build it up front */
+#ifndef WIN32
+    out = open_memstream(&src, &len);
+#else
+    out = tmpfile();
+#endif
+    if (!out) {
+        LogMessage(X_ERROR, "XKB: Couldn't compile keymap\n");
+        return 0;
+    }
+#ifdef DEBUG
+    if (xkbDebugFlags) {
+        ErrorF("[xkb] XkbDDXLoadKeymapByNames compiling keymap:\n");
+        XkbWriteXKBKeymapForNames(stderr, names, xkb, want, need);
+    }
+#endif
+    written = XkbWriteXKBKeymapForNames(out, names, xkb, want, need);
+#ifdef WIN32
+    if (written && fflush(out) == 0 && (len = ftell(out)) != (size_t) -1 &&
+        (src = malloc(len + 1)) != NULL) {
+        rewind(out);
+        written = fread(src, 1, len, out) == len;
+    }
+    else
+        written = FALSE;
+#endif
+    if (fclose(out) != 0 || !written) {
         LogMessage(X_ERROR, "XKB: Couldn't compile keymap\n");
+        free(src);
         return 0;
     }
 
-    return LoadXKM(want, need, &ctx, xkbRtrn);
+    provided = XkbDDXLoadKeymapFromSource(src, len, want, need, xkbRtrn);
+    free(src);
+    return provided;
 }
 
 static unsigned
@@ -329,19 +811,8 @@ XkbDDXLoadKeymapFromString(DeviceIntPtr keybd,
 			   unsigned need,
 			   XkbDescPtr *xkbRtrn)
 {
-    XkbCompContextRec ctx;
-
-    *xkbRtrn = NULL;
-
-    if (StartXkbComp(&ctx))
-	fwrite(keymap, keymap_length, 1, ctx.out);
-
-    if (!FinishXkbComp(&ctx)) {
-        LogMessage(X_ERROR, "XKB: Couldn't compile keymap\n");
-        return 0;
-    }
-
-    return LoadXKM(want, need, &ctx, xkbRtrn);
+    return XkbDDXLoadKeymapFromSource(keymap, keymap_length, want, need,
+                                      xkbRtrn);
 }
 
 Bool
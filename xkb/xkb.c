@@ -547,7 +547,7 @@ ProcXkbBell(ClientPtr client)
         for (other = inputInfo.devices; other; other = other->next) {
             if ((other != dev) && other->key && !IsMaster(other) &&
                 GetMaster(other, MASTER_KEYBOARD) == dev) {
-                rc = XaceHook(XACE_DEVICE_ACCESS, client, other, DixBellAccess);
+                rc = XaceHookDeviceAccess(client, other, DixBellAccess);
                 if (rc == Success)
                     _XkbBell(client, other, pWin, stuff->bellClass,
                              stuff->bellID, stuff->pitch, stuff->duration,
@@ -2633,8 +2633,8 @@ ProcXkbSetMap(ClientPtr client)
         for (other = inputInfo.devices; other; other = other->next) {
             if ((other != dev) && other->key && !IsMaster(other) &&
                 GetMaster(other, MASTER_KEYBOARD) == dev) {
-                rc = XaceHook(XACE_DEVICE_ACCESS, client, other,
-                              DixManageAccess);
+                rc = XaceHookDeviceAccess(client, other,
+                                          DixManageAccess);
                 if (rc == Success) {
                     rc = _XkbSetMapChecks(client, other, stuff, tmp);
                     if (rc != Success)
@@ -2655,8 +2655,8 @@ ProcXkbSetMap(ClientPtr client)
         for (other = inputInfo.devices; other; other = other->next) {
             if ((other != dev) && other->key && !IsMaster(other) &&
                 GetMaster(other, MASTER_KEYBOARD) == dev) {
-                rc = XaceHook(XACE_DEVICE_ACCESS, client, other,
-                              DixManageAccess);
+                rc = XaceHookDeviceAccess(client, other,
+                                          DixManageAccess);
                 if (rc == Success)
                     _XkbSetMap(client, other, stuff, tmp);
                 /* ignore rc. if the SetMap failed although the check above
@@ -2984,8 +2984,8 @@ ProcXkbSetCompatMap(ClientPtr client)
         for (other = inputInfo.devices; other; other = other->next) {
             if ((other != dev) && other->key && !IsMaster(other) &&
                 GetMaster(other, MASTER_KEYBOARD) == dev) {
-                rc = XaceHook(XACE_DEVICE_ACCESS, client, other,
-                              DixManageAccess);
+                rc = XaceHookDeviceAccess(client, other,
+                                          DixManageAccess);
                 if (rc == Success) {
                     /* dry-run */
                     rc = _XkbSetCompatMap(client, other, stuff, data, TRUE);
@@ -3006,8 +3006,8 @@ ProcXkbSetCompatMap(ClientPtr client)
         for (other = inputInfo.devices; other; other = other->next) {
             if ((other != dev) && other->key && !IsMaster(other) &&
                 GetMaster(other, MASTER_KEYBOARD) == dev) {
-                rc = XaceHook(XACE_DEVICE_ACCESS, client, other,
-                              DixManageAccess);
+                rc = XaceHookDeviceAccess(client, other,
+                                          DixManageAccess);
                 if (rc == Success) {
                     rc = _XkbSetCompatMap(client, other, stuff, data, FALSE);
                     if (rc != Success)
@@ -3267,8 +3267,8 @@ ProcXkbSetIndicatorMap(ClientPtr client)
         for (other = inputInfo.devices; other; other = other->next) {
             if ((other != dev) && other->key && !IsMaster(other) &&
                 GetMaster(other, MASTER_KEYBOARD) == dev) {
-                rc = XaceHook(XACE_DEVICE_ACCESS, client, other,
-                              DixSetAttrAccess);
+                rc = XaceHookDeviceAccess(client, other,
+                                          DixSetAttrAccess);
                 if (rc == Success)
                     _XkbSetIndicatorMap(client, other, stuff->which, from);
             }
@@ -3536,7 +3536,7 @@ ProcXkbSetNamedIndicator(ClientPtr client)
             if ((other != dev) && !IsMaster(other) &&
                 GetMaster(other, MASTER_KEYBOARD) == dev && (other->kbdfeed ||
                                                              other->leds) &&
-                (XaceHook(XACE_DEVICE_ACCESS, client, other, DixSetAttrAccess)
+                (XaceHookDeviceAccess(client, other, DixSetAttrAccess)
                  == Success)) {
                 rc = _XkbCreateIndicatorMap(other, stuff->indicator,
                                             stuff->ledClass, stuff->ledID, &map,
@@ -3560,7 +3560,7 @@ ProcXkbSetNamedIndicator(ClientPtr client)
             if ((other != dev) && !IsMaster(other) &&
                 GetMaster(other, MASTER_KEYBOARD) == dev && (other->kbdfeed ||
                                                              other->leds) &&
-                (XaceHook(XACE_DEVICE_ACCESS, client, other, DixSetAttrAccess)
+                (XaceHookDeviceAccess(client, other, DixSetAttrAccess)
                  == Success)) {
                 _XkbSetNamedIndicator(client, other, stuff);
             }
@@ -4364,8 +4364,8 @@ ProcXkbSetNames(ClientPtr client)
             if ((other != dev) && other->key && !IsMaster(other) &&
                 GetMaster(other, MASTER_KEYBOARD) == dev) {
 
-                rc = XaceHook(XACE_DEVICE_ACCESS, client, other,
-                              DixManageAccess);
+                rc = XaceHookDeviceAccess(client, other,
+                                          DixManageAccess);
                 if (rc == Success) {
                     rc = _XkbSetNamesCheck(client, other, stuff, tmp);
                     if (rc != Success)
@@ -4388,8 +4388,8 @@ ProcXkbSetNames(ClientPtr client)
             if ((other != dev) && other->key && !IsMaster(other) &&
                 GetMaster(other, MASTER_KEYBOARD) == dev) {
 
-                rc = XaceHook(XACE_DEVICE_ACCESS, client, other,
-                              DixManageAccess);
+                rc = XaceHookDeviceAccess(client, other,
+                                          DixManageAccess);
                 if (rc == Success)
                     _XkbSetNames(client, other, stuff);
             }
@@ -5462,8 +5462,8 @@ ProcXkbSetGeometry(ClientPtr client)
         for (other = inputInfo.devices; other; other = other->next) {
             if ((other != dev) && other->key && !IsMaster(other) &&
                 GetMaster(other, MASTER_KEYBOARD) == dev) {
-                rc = XaceHook(XACE_DEVICE_ACCESS, client, other,
-                              DixManageAccess);
+                rc = XaceHookDeviceAccess(client, other,
+                                          DixManageAccess);
                 if (rc == Success)
                     _XkbSetGeometry(client, other, stuff);
             }
@@ -6636,8 +6636,8 @@ ProcXkbSetDeviceInfo(ClientPtr client)
                  GetMaster(other, MASTER_KEYBOARD) == dev) &&
                 ((stuff->deviceSpec == XkbUseCoreKbd && other->key) ||
                  (stuff->deviceSpec == XkbUseCorePtr && other->button))) {
-                rc = XaceHook(XACE_DEVICE_ACCESS, client, other,
-                              DixManageAccess);
+                rc = XaceHookDeviceAccess(client, other,
+                                          DixManageAccess);
                 if (rc == Success) {
                     rc = _XkbSetDeviceInfoCheck(client, other, stuff);
                     if (rc != Success)
@@ -6661,8 +6661,8 @@ ProcXkbSetDeviceInfo(ClientPtr client)
                  GetMaster(other, MASTER_KEYBOARD) == dev) &&
                 ((stuff->deviceSpec == XkbUseCoreKbd && other->key) ||
                  (stuff->deviceSpec == XkbUseCorePtr && other->button))) {
-                rc = XaceHook(XACE_DEVICE_ACCESS, client, other,
-                              DixManageAccess);
+                rc = XaceHookDeviceAccess(client, other,
+                                          DixManageAccess);
                 if (rc == Success) {
                     rc = _XkbSetDeviceInfo(client, other, stuff);
                     if (rc != Success)
@@ -6687,7 +6687,7 @@ ProcXkbSetDebuggingFlags(ClientPtr client)
     REQUEST(xkbSetDebuggingFlagsReq);
     REQUEST_AT_LEAST_SIZE(xkbSetDebuggingFlagsReq);
 
-    rc = XaceHook(XACE_SERVER_ACCESS, client, DixDebugAccess);
+    rc = XaceHookServerAccess(client, DixDebugAccess);
     if (rc != Success)
         return rc;
 